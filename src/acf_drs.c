@@ -0,0 +1,364 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <XPLMDataAccess.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+
+#include "dbg_log.h"
+#include "xraas2.h"
+
+#include "acf_drs.h"
+
+/*
+ * Aircraft-specific dataref bindings. Some third party aircraft expose
+ * their GPWS override switches and FMS landing speeds through their own
+ * datarefs. These are described in data/acf_drs.cfg, which is read once
+ * per aircraft load by acf_drs_resolve. The datarefs of the blocks
+ * matching the loaded aircraft are looked up right then and the handles
+ * are cached, so the flight loop never looks anything up by name.
+ *
+ * The file consists of aircraft blocks. Lines starting with '#' are
+ * comments. Each block starts with an "icao" keyword and is followed by
+ * any number of these keywords:
+ *
+ *	icao <ICAOs>		Starts a block matching any of the listed
+ *				(comma-separated) aircraft ICAO codes.
+ *	author <name>		Restricts the block to aircraft with this
+ *				author (spaces must be written as %20).
+ *	terr_ovrd <dr> <val>	GPWS terrain override switch. The override
+ *				is active when the integer dataref `dr'
+ *				equals `val', or if `val' is "nonzero",
+ *				when the dataref is non-zero.
+ *	flaps_ovrd <dr> <val>	GPWS flaps override switch, as above.
+ *	vapp <dr>		Integer dataref holding the FMS Vapp.
+ *	vref <dr>		Integer dataref holding the FMS Vref.
+ *
+ * Each override is taken from the first matching block which binds it
+ * to an existing dataref. The landing speed sources of the first matching
+ * block binding any are tried in the order in which they appear, the
+ * first one holding a valid speed wins.
+ */
+
+#define	ACF_DRS_CFG		"acf_drs.cfg"
+#define	MAX_ENTS		8
+#define	MAX_LAND_SPD		4
+#define	DR_NAME_LEN		128
+
+typedef enum {
+	ROLE_TERR_OVRD,
+	ROLE_FLAPS_OVRD,
+	ROLE_VAPP,
+	ROLE_VREF
+} role_t;
+
+typedef struct {
+	role_t		role;
+	char		dr[DR_NAME_LEN];
+	bool_t		nonzero;
+	int		value;
+} ent_t;
+
+typedef struct {
+	bool_t		valid;
+	char		icaos[128];
+	char		author[64];
+	size_t		n_ents;
+	ent_t		ents[MAX_ENTS];
+} blk_t;
+
+typedef struct {
+	XPLMDataRef	dr;
+	bool_t		nonzero;
+	int		value;
+} ovrd_t;
+
+static struct {
+	ovrd_t		terr;
+	ovrd_t		flaps;
+	size_t		n_land_spd;
+	struct {
+		XPLMDataRef	dr;
+		bool_t		vref;
+	} land_spd[MAX_LAND_SPD];
+} bind;
+
+static bool_t
+blk_match(const blk_t *blk, const char *icao, const char *author)
+{
+	char icaos[sizeof (blk->icaos)];
+
+	if (*blk->author != 0 && strcmp(blk->author, author) != 0)
+		return (B_FALSE);
+	strlcpy(icaos, blk->icaos, sizeof (icaos));
+	for (char *p = strtok(icaos, ","); p != NULL; p = strtok(NULL, ",")) {
+		if (strcmp(p, icao) == 0)
+			return (B_TRUE);
+	}
+	return (B_FALSE);
+}
+
+static void
+bind_ovrd(ovrd_t *ovrd, const ent_t *ent)
+{
+	if (ovrd->dr != NULL)
+		return;
+	ovrd->dr = XPLMFindDataRef(ent->dr);
+	ovrd->nonzero = ent->nonzero;
+	ovrd->value = ent->value;
+	if (ovrd->dr != NULL)
+		dbg_log(startup, 1, "acf_drs: bound %s", ent->dr);
+}
+
+/*
+ * Binds whatever the just finished block provides, if it matches.
+ */
+static void
+blk_done(const blk_t *blk, const char *icao, const char *author)
+{
+	bool_t land_spd_bound = (bind.n_land_spd != 0);
+
+	if (!blk->valid || !blk_match(blk, icao, author))
+		return;
+
+	for (size_t i = 0; i < blk->n_ents; i++) {
+		const ent_t *ent = &blk->ents[i];
+		XPLMDataRef dr;
+
+		switch (ent->role) {
+		case ROLE_TERR_OVRD:
+			bind_ovrd(&bind.terr, ent);
+			break;
+		case ROLE_FLAPS_OVRD:
+			bind_ovrd(&bind.flaps, ent);
+			break;
+		case ROLE_VAPP:
+		case ROLE_VREF:
+			if (land_spd_bound ||
+			    bind.n_land_spd == MAX_LAND_SPD ||
+			    (dr = XPLMFindDataRef(ent->dr)) == NULL)
+				break;
+			bind.land_spd[bind.n_land_spd].dr = dr;
+			bind.land_spd[bind.n_land_spd].vref =
+			    (ent->role == ROLE_VREF);
+			bind.n_land_spd++;
+			dbg_log(startup, 1, "acf_drs: bound %s", ent->dr);
+			break;
+		}
+	}
+}
+
+static ent_t *
+new_ent(blk_t *blk, role_t role, const char *keyword)
+{
+	ent_t *ent;
+
+	if (!blk->valid) {
+		logMsg("Error parsing %s: \"%s\" must be preceded by \"icao\".",
+		    ACF_DRS_CFG, keyword);
+		return (NULL);
+	}
+	if (blk->n_ents == MAX_ENTS) {
+		logMsg("Error parsing %s: too many datarefs in block for "
+		    "\"%s\".", ACF_DRS_CFG, blk->icaos);
+		return (NULL);
+	}
+	ent = &blk->ents[blk->n_ents++];
+	memset(ent, 0, sizeof (*ent));
+	ent->role = role;
+
+	return (ent);
+}
+
+/*
+ * Parses data/acf_drs.cfg and binds the datarefs of the blocks which
+ * match `icao' & `author'. On error, nothing is bound, since we can't
+ * trust any of the file.
+ */
+static void
+parse_and_bind(FILE *fp, const char *icao, const char *author)
+{
+	char buf[DR_NAME_LEN];
+	blk_t blk;
+
+	memset(&blk, 0, sizeof (blk));
+
+#define	PARSE_STR(str, keyword) \
+	do { \
+		if (fscanf(fp, "%127s", buf) != 1) { \
+			logMsg("Error parsing %s: expected string following " \
+			    "\"%s\".", ACF_DRS_CFG, keyword); \
+			goto errout; \
+		} \
+		unescape_percent(buf); \
+		strlcpy((str), buf, sizeof (str)); \
+	} while (0)
+
+	while (fscanf(fp, "%127s", buf) == 1) {
+		ent_t *ent;
+
+		if (buf[0] == '#') {
+			int c;
+			while ((c = fgetc(fp)) != '\n' && c != EOF)
+				;
+			continue;
+		}
+		if (strcmp(buf, "icao") == 0) {
+			blk_done(&blk, icao, author);
+			memset(&blk, 0, sizeof (blk));
+			blk.valid = B_TRUE;
+			PARSE_STR(blk.icaos, "icao");
+		} else if (strcmp(buf, "author") == 0) {
+			if (!blk.valid) {
+				logMsg("Error parsing %s: \"author\" must be "
+				    "preceded by \"icao\".", ACF_DRS_CFG);
+				goto errout;
+			}
+			PARSE_STR(blk.author, "author");
+		} else if (strcmp(buf, "terr_ovrd") == 0 ||
+		    strcmp(buf, "flaps_ovrd") == 0) {
+			char keyword[16], val[16];
+
+			strlcpy(keyword, buf, sizeof (keyword));
+			if ((ent = new_ent(&blk, strcmp(keyword,
+			    "terr_ovrd") == 0 ? ROLE_TERR_OVRD :
+			    ROLE_FLAPS_OVRD, keyword)) == NULL)
+				goto errout;
+			PARSE_STR(ent->dr, keyword);
+			PARSE_STR(val, keyword);
+			if (strcmp(val, "nonzero") == 0) {
+				ent->nonzero = B_TRUE;
+			} else if (sscanf(val, "%d", &ent->value) != 1) {
+				logMsg("Error parsing %s: expected integer or "
+				    "\"nonzero\" following \"%s %s\".",
+				    ACF_DRS_CFG, keyword, ent->dr);
+				goto errout;
+			}
+		} else if (strcmp(buf, "vapp") == 0 ||
+		    strcmp(buf, "vref") == 0) {
+			char keyword[16];
+
+			strlcpy(keyword, buf, sizeof (keyword));
+			if ((ent = new_ent(&blk, strcmp(keyword, "vref") == 0 ?
+			    ROLE_VREF : ROLE_VAPP, keyword)) == NULL)
+				goto errout;
+			PARSE_STR(ent->dr, keyword);
+		} else {
+			logMsg("Error parsing %s: unknown keyword \"%s\".",
+			    ACF_DRS_CFG, buf);
+			goto errout;
+		}
+	}
+#undef	PARSE_STR
+	blk_done(&blk, icao, author);
+
+	return;
+errout:
+	memset(&bind, 0, sizeof (bind));
+}
+
+/*
+ * Resolves the aircraft-specific datarefs of the aircraft with ICAO code
+ * `icao' and author `author', replacing any previous bindings. Must be
+ * called once the aircraft's plugins have had a chance to register their
+ * datarefs.
+ */
+void
+acf_drs_resolve(const char *icao, const char *author)
+{
+	char *filename = mkpathname(xraas_plugindir, "data", ACF_DRS_CFG,
+	    NULL);
+	FILE *fp = fopen(filename, "r");
+
+	memset(&bind, 0, sizeof (bind));
+	if (fp == NULL) {
+		dbg_log(startup, 1, "acf_drs: no %s", filename);
+		free(filename);
+		return;
+	}
+	parse_and_bind(fp, icao, author);
+	fclose(fp);
+	free(filename);
+
+	dbg_log(startup, 1, "acf_drs: %s/%s terr_ovrd: %d flaps_ovrd: %d "
+	    "land_spd: %d", icao, author, bind.terr.dr != NULL,
+	    bind.flaps.dr != NULL, (int)bind.n_land_spd);
+}
+
+void
+acf_drs_fini(void)
+{
+	memset(&bind, 0, sizeof (bind));
+}
+
+static bool_t
+ovrd_get(const ovrd_t *ovrd, bool_t *active)
+{
+	int val;
+
+	if (ovrd->dr == NULL)
+		return (B_FALSE);
+	val = XPLMGetDatai(ovrd->dr);
+	*active = (ovrd->nonzero ? val != 0 : val == ovrd->value);
+
+	return (B_TRUE);
+}
+
+/*
+ * Returns B_FALSE if the aircraft has no bound terrain override switch,
+ * otherwise sets `ovrd' to the switch's state and returns B_TRUE.
+ */
+bool_t
+acf_drs_terr_ovrd(bool_t *ovrd)
+{
+	return (ovrd_get(&bind.terr, ovrd));
+}
+
+/*
+ * Same as acf_drs_terr_ovrd, but for the flaps override switch.
+ */
+bool_t
+acf_drs_flaps_ovrd(bool_t *ovrd)
+{
+	return (ovrd_get(&bind.flaps, ovrd));
+}
+
+/*
+ * Returns the first bound landing speed which is at least `min_spd'
+ * and sets `vref' if it is a Vref (as opposed to a Vapp). Returns NAN if
+ * no bound landing speed has been set yet.
+ */
+double
+acf_drs_land_spd(double min_spd, bool_t *vref)
+{
+	for (size_t i = 0; i < bind.n_land_spd; i++) {
+		int val = XPLMGetDatai(bind.land_spd[i].dr);
+
+		if (val >= min_spd) {
+			*vref = bind.land_spd[i].vref;
+			return (val);
+		}
+	}
+	return (NAN);
+}
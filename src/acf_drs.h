@@ -0,0 +1,38 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_ACF_DRS_H_
+#define	_XRAAS_ACF_DRS_H_
+
+#include <acfutils/types.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+void acf_drs_resolve(const char *icao, const char *author);
+void acf_drs_fini(void);
+
+bool_t acf_drs_terr_ovrd(bool_t *ovrd);
+bool_t acf_drs_flaps_ovrd(bool_t *ovrd);
+double acf_drs_land_spd(double min_spd, bool_t *vref);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_ACF_DRS_H_ */
@@ -0,0 +1,228 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/avl.h>
+#include <acfutils/helpers.h>
+
+#include "dbg_log.h"
+
+#include "acf_meta.h"
+
+/*
+ * Extracts the properties in acf_meta_t out of an .acf file in a single
+ * pass. Modern .acf files are many megabytes in size, so we read them in
+ * large chunks and stop as soon as we've seen every property we need.
+ * Results are cached by path and are only re-read if the file's size or
+ * modification time change, so reloading the same aircraft is free.
+ */
+
+#define	SCAN_BUF_SZ		(64 << 10)
+#define	PROP_PREFIX		"P acf/"
+#define	PROP_HELO		"_fly_like_a_helo "
+#define	PROP_STUDIO		"_studio "
+
+enum {
+	FOUND_HELO =	1 << 0,
+	FOUND_STUDIO =	1 << 1,
+	FOUND_ALL =	FOUND_HELO | FOUND_STUDIO
+};
+
+typedef struct {
+	char		*path;
+	off_t		size;
+	time_t		mtime;
+	acf_meta_t	meta;
+	avl_node_t	node;
+} acf_meta_cache_t;
+
+static bool_t inited = B_FALSE;
+static avl_tree_t cache;
+
+static int
+cache_compar(const void *a, const void *b)
+{
+	const acf_meta_cache_t *ca = a, *cb = b;
+	int res = strcmp(ca->path, cb->path);
+
+	if (res < 0)
+		return (-1);
+	if (res > 0)
+		return (1);
+	return (0);
+}
+
+/*
+ * Checks if `line' (of length `len', without the newline) sets property
+ * `prop' and if so, returns a pointer to the property's value.
+ */
+static const char *
+prop_value(const char *line, size_t len, const char *prop)
+{
+	size_t pfx_len = strlen(PROP_PREFIX), prop_len = strlen(prop);
+
+	if (len < pfx_len + prop_len ||
+	    memcmp(line, PROP_PREFIX, pfx_len) != 0 ||
+	    memcmp(&line[pfx_len], prop, prop_len) != 0)
+		return (NULL);
+	return (&line[pfx_len + prop_len]);
+}
+
+static void
+scan_line(const char *line, size_t len, acf_meta_t *meta, unsigned *found)
+{
+	const char *val;
+
+	/* strip trailing whitespace, including CR of CRLF line endings */
+	while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ' ||
+	    line[len - 1] == '\t'))
+		len--;
+
+	if ((val = prop_value(line, len, PROP_HELO)) != NULL) {
+		meta->is_helo = (val < line + len && *val == '1');
+		*found |= FOUND_HELO;
+	} else if ((val = prop_value(line, len, PROP_STUDIO)) != NULL) {
+		size_t val_len = MIN((size_t)(line + len - val),
+		    sizeof (meta->studio) - 1);
+
+		memcpy(meta->studio, val, val_len);
+		meta->studio[val_len] = 0;
+		*found |= FOUND_STUDIO;
+	}
+}
+
+static bool_t
+acf_scan(const char *acf_path, acf_meta_t *meta)
+{
+	FILE *fp = fopen(acf_path, "rb");
+	char *buf;
+	size_t fill = 0;
+	unsigned found = 0;
+	bool_t skip_line = B_FALSE;
+
+	memset(meta, 0, sizeof (*meta));
+	if (fp == NULL)
+		return (B_FALSE);
+	buf = malloc(SCAN_BUF_SZ);
+
+	while (found != FOUND_ALL) {
+		size_t n = fread(&buf[fill], 1, SCAN_BUF_SZ - fill, fp);
+		size_t start = 0;
+		char *nl;
+
+		fill += n;
+		while (found != FOUND_ALL && (nl = memchr(&buf[start], '\n',
+		    fill - start)) != NULL) {
+			size_t len = nl - &buf[start];
+
+			if (!skip_line)
+				scan_line(&buf[start], len, meta, &found);
+			skip_line = B_FALSE;
+			start += len + 1;
+		}
+		if (n == 0) {
+			/* EOF, last line might lack a newline */
+			if (!skip_line && start < fill)
+				scan_line(&buf[start], fill - start, meta,
+				    &found);
+			break;
+		}
+		if (start == 0 && fill == SCAN_BUF_SZ) {
+			/* overlong line, none of our properties */
+			skip_line = B_TRUE;
+			fill = 0;
+			continue;
+		}
+		memmove(buf, &buf[start], fill - start);
+		fill -= start;
+	}
+
+	free(buf);
+	fclose(fp);
+
+	return (B_TRUE);
+}
+
+/*
+ * Retrieves the metadata of the .acf file at `acf_path', scanning the file
+ * only if it isn't in our cache, or has changed since it was cached.
+ * Returns B_FALSE if the file can't be read (`meta' is then zeroed).
+ */
+bool_t
+acf_meta_get(const char *acf_path, acf_meta_t *meta)
+{
+	struct stat st;
+	acf_meta_cache_t srch, *ent;
+	avl_index_t where;
+
+	if (!inited) {
+		avl_create(&cache, cache_compar, sizeof (acf_meta_cache_t),
+		    offsetof(acf_meta_cache_t, node));
+		inited = B_TRUE;
+	}
+
+	if (stat(acf_path, &st) != 0) {
+		memset(meta, 0, sizeof (*meta));
+		return (B_FALSE);
+	}
+
+	srch.path = (char *)acf_path;
+	ent = avl_find(&cache, &srch, &where);
+	if (ent != NULL && ent->size == st.st_size &&
+	    ent->mtime == st.st_mtime) {
+		*meta = ent->meta;
+		return (B_TRUE);
+	}
+
+	if (!acf_scan(acf_path, meta))
+		return (B_FALSE);
+	dbg_log(startup, 2, "scanned %s: helo: %d studio: \"%s\"", acf_path,
+	    meta->is_helo, meta->studio);
+
+	if (ent == NULL) {
+		ent = calloc(1, sizeof (*ent));
+		ent->path = strdup(acf_path);
+		avl_insert(&cache, ent, where);
+	}
+	ent->size = st.st_size;
+	ent->mtime = st.st_mtime;
+	ent->meta = *meta;
+
+	return (B_TRUE);
+}
+
+void
+acf_meta_fini(void)
+{
+	acf_meta_cache_t *ent;
+	void *cookie = NULL;
+
+	if (!inited)
+		return;
+	while ((ent = avl_destroy_nodes(&cache, &cookie)) != NULL) {
+		free(ent->path);
+		free(ent);
+	}
+	avl_destroy(&cache);
+	inited = B_FALSE;
+}
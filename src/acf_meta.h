@@ -0,0 +1,43 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_ACF_META_H_
+#define	_XRAAS_ACF_META_H_
+
+#include <acfutils/types.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * Properties of an .acf file which X-RAAS needs and which aren't
+ * available via datarefs.
+ */
+typedef struct {
+	bool_t	is_helo;	/* P acf/_fly_like_a_helo 1 */
+	char	studio[256];	/* P acf/_studio, "" if not set */
+} acf_meta_t;
+
+bool_t acf_meta_get(const char *acf_path, acf_meta_t *meta);
+void acf_meta_fini(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_ACF_META_H_ */
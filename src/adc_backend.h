@@ -0,0 +1,62 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_ADC_BACKEND_H_
+#define	_XRAAS_ADC_BACKEND_H_
+
+#include <acfutils/geom.h>
+#include <acfutils/types.h>
+
+#include "airdata.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * An air data backend. adc_init picks one backend out of the registry in
+ * airdata.c, either the one named by the `adc_backend' config option, or
+ * the first one whose init succeeds (aircraft-specific ones are probed
+ * before the X-Plane default). To add a new backend, implement this
+ * interface and add it to the registry.
+ *
+ * init:	Probes for & initializes the backend. Returns B_FALSE if the
+ *		backend isn't usable (e.g. its aircraft isn't loaded).
+ * fini:	Releases all backend resources.
+ * collect:	Fills in `adc' for the current flight loop. Returns B_FALSE
+ *		if the air data is currently unavailable or unreliable.
+ * gpwc_rwy_data: Optional (may be NULL), see adc_gpwc_rwy_data.
+ * auto_probe:	If B_FALSE, the backend is only used when explicitly
+ *		selected by name.
+ */
+typedef struct {
+	const char	*name;
+	bool_t		(*init)(void);
+	void		(*fini)(void);
+	bool_t		(*collect)(adc_t *adc);
+	bool_t		(*gpwc_rwy_data)(geo_pos3_t *thr_pos, double *len,
+			    double *width, double *trk);
+	bool_t		auto_probe;
+} adc_backend_t;
+
+extern const adc_backend_t adc_replay_backend;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_ADC_BACKEND_H_ */
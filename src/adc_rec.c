@@ -0,0 +1,426 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <XPLMUtilities.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/dr.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+#include <acfutils/thread.h>
+
+#include "adc_trace.h"
+#include "dbg_log.h"
+#include "xraas2.h"
+#include "xraas_cfg.h"
+
+#include "adc_rec.h"
+
+/*
+ * Air data recorder. While recording, every sample adc_collect produces
+ * is written out, along with the values of the X-RAAS override datarefs,
+ * as an air data trace which the replay backend (adc_backend = replay)
+ * can play back to reproduce the flight exactly. Recording is started &
+ * stopped with the "xraas/adc_rec/start" & "xraas/adc_rec/stop" commands,
+ * by writing 1 or 0 to the "xraas/adc_rec/active" dataref, or right from
+ * the start with `adc_rec = true' in X-RAAS.cfg.
+ *
+ * Recordings go into Output/X-RAAS/adc_rec, split into chunks of
+ * ADC_REC_CHUNK_SAMPLES samples (<start date>_<chunk>.txt). Each chunk is
+ * a complete trace and concatenated chunks replay as one. Values which
+ * didn't change since the previous sample are written as "=", so the
+ * mostly static columns (gear, FMS data, overrides) cost two bytes per
+ * sample. The header records the config_hash of the configuration in use.
+ *
+ * The flight loop only copies samples into a ring of ADC_REC_RING_SZ
+ * samples, a background thread formats and writes them. If the writer
+ * falls behind and the ring fills up, samples are dropped (and a comment
+ * saying so is written to the trace).
+ */
+
+#define	ADC_REC_DIR		"adc_rec"
+#define	ADC_REC_RING_SZ		64
+#define	ADC_REC_CHUNK_SAMPLES	7200	/* an hour at our exec interval */
+#define	ADC_REC_NAME_LEN	64
+#define	ADC_REC_VAL_LEN		32
+
+typedef struct {
+	adc_t		adc;
+	double		ovrds[ADC_REC_MAX_OVRDS];
+	unsigned	n_dropped;	/* samples dropped just before this */
+} rec_sample_t;
+
+static struct {
+	bool_t		inited;
+	int		active;
+	dr_t		active_dr;
+	XPLMCommandRef	start_cmd;
+	XPLMCommandRef	stop_cmd;
+
+	bool_t		running;
+	thread_t	thread;
+	mutex_t		lock;
+	condvar_t	cv;
+
+	/* protected by lock */
+	bool_t		shutdown;
+	bool_t		failed;
+	rec_sample_t	ring[ADC_REC_RING_SZ];
+	unsigned	head;
+	unsigned	n_ring;
+	unsigned	n_dropped;	/* since the last queued sample */
+
+	/* constant while recording */
+	char		*basename;
+	size_t		n_ovrds;
+	char		ovrd_names[ADC_REC_MAX_OVRDS][ADC_REC_NAME_LEN];
+	uint64_t	cfg_hash;
+
+	/* only touched by the writer thread while recording */
+	FILE		*fp;
+	char		*path;
+	unsigned	chunk;
+	unsigned	n_chunk;
+	unsigned	n_written;
+	unsigned	n_dropped_total;
+	char		prev[ADC_TRACE_MAX_COLS][ADC_REC_VAL_LEN];
+} rec;
+
+static void
+close_chunk(void)
+{
+	if (rec.fp != NULL) {
+		fclose(rec.fp);
+		rec.fp = NULL;
+	}
+	free(rec.path);
+	rec.path = NULL;
+}
+
+static bool_t
+open_chunk(void)
+{
+	char suffix[16];
+
+	close_chunk();
+	snprintf(suffix, sizeof (suffix), "_%03u.txt", rec.chunk++);
+	rec.path = malloc(strlen(rec.basename) + strlen(suffix) + 1);
+	strcpy(rec.path, rec.basename);
+	strcat(rec.path, suffix);
+	rec.n_chunk = 0;
+
+	if ((rec.fp = fopen(rec.path, "w")) == NULL) {
+		logMsg("Error creating air data recording %s: %s", rec.path,
+		    strerror(errno));
+		return (B_FALSE);
+	}
+	fprintf(rec.fp, "# X-RAAS air data recording, chunk %u\n"
+	    ADC_TRACE_CFG_HASH "%016llx\n", rec.chunk - 1,
+	    (unsigned long long)rec.cfg_hash);
+	for (size_t i = 0; i < adc_trace_num_fields; i++)
+		fprintf(rec.fp, "%s%s", i != 0 ? " " : "",
+		    adc_trace_fields[i].name);
+	for (size_t i = 0; i < rec.n_ovrds; i++)
+		fprintf(rec.fp, " %s", rec.ovrd_names[i]);
+	fputc('\n', rec.fp);
+	dbg_log(adc, 1, "recording to %s", rec.path);
+
+	return (B_TRUE);
+}
+
+static void
+format_val(const trace_field_t *tf, const adc_t *adc,
+    char buf[ADC_REC_VAL_LEN])
+{
+	const void *field = (const void *)((uintptr_t)adc + tf->off);
+
+	/* %.17g & %.9g are needed for doubles & floats to round-trip */
+	switch (tf->type) {
+	case TF_DOUBLE:
+		snprintf(buf, ADC_REC_VAL_LEN, "%.17g", *(double *)field);
+		break;
+	case TF_FLOAT:
+		snprintf(buf, ADC_REC_VAL_LEN, "%.9g", *(float *)field);
+		break;
+	case TF_INT:
+		snprintf(buf, ADC_REC_VAL_LEN, "%d", *(int *)field);
+		break;
+	case TF_BOOL:
+		snprintf(buf, ADC_REC_VAL_LEN, "%d", *(bool_t *)field != 0);
+		break;
+	case TF_SIZE:
+		snprintf(buf, ADC_REC_VAL_LEN, "%lu",
+		    (unsigned long)*(size_t *)field);
+		break;
+	case TF_STR8:
+		if (*(char *)field == 0)
+			strlcpy(buf, ADC_TRACE_EMPTY_STR, ADC_REC_VAL_LEN);
+		else
+			snprintf(buf, ADC_REC_VAL_LEN, "%.7s", (char *)field);
+		break;
+	}
+}
+
+static void
+write_col(unsigned col, const char *val)
+{
+	if (col != 0)
+		fputc(' ', rec.fp);
+	if (rec.n_chunk != 0 && strcmp(rec.prev[col], val) == 0) {
+		fputs(ADC_TRACE_REPEAT_STR, rec.fp);
+	} else {
+		fputs(val, rec.fp);
+		strlcpy(rec.prev[col], val, sizeof (rec.prev[col]));
+	}
+}
+
+static bool_t
+write_sample(const rec_sample_t *sample)
+{
+	char val[ADC_REC_VAL_LEN];
+	unsigned col = 0;
+
+	if ((rec.fp == NULL || rec.n_chunk == ADC_REC_CHUNK_SAMPLES) &&
+	    !open_chunk())
+		return (B_FALSE);
+
+	if (sample->n_dropped != 0) {
+		fprintf(rec.fp, "# recorder fell behind, dropped %u samples\n",
+		    sample->n_dropped);
+		rec.n_dropped_total += sample->n_dropped;
+	}
+	for (size_t i = 0; i < adc_trace_num_fields; i++) {
+		format_val(&adc_trace_fields[i], &sample->adc, val);
+		write_col(col++, val);
+	}
+	for (size_t i = 0; i < rec.n_ovrds; i++) {
+		snprintf(val, sizeof (val), "%.9g", sample->ovrds[i]);
+		write_col(col++, val);
+	}
+	fputc('\n', rec.fp);
+	if (ferror(rec.fp)) {
+		logMsg("Error writing air data recording %s: %s", rec.path,
+		    strerror(errno));
+		return (B_FALSE);
+	}
+	rec.n_chunk++;
+	rec.n_written++;
+
+	return (B_TRUE);
+}
+
+static void
+rec_thread(void *unused)
+{
+	rec_sample_t sample;
+
+	UNUSED(unused);
+
+	mutex_enter(&rec.lock);
+	for (;;) {
+		bool_t ok;
+
+		while (rec.n_ring == 0 && !rec.shutdown)
+			cv_wait(&rec.cv, &rec.lock);
+		if (rec.n_ring == 0)
+			break;
+		sample = rec.ring[rec.head];
+		rec.head = (rec.head + 1) % ADC_REC_RING_SZ;
+		rec.n_ring--;
+		mutex_exit(&rec.lock);
+
+		ok = write_sample(&sample);
+
+		mutex_enter(&rec.lock);
+		if (!ok) {
+			rec.failed = B_TRUE;
+			break;
+		}
+	}
+	mutex_exit(&rec.lock);
+	close_chunk();
+}
+
+static bool_t
+rec_start(const adc_rec_ovrd_t *ovrds, size_t n_ovrds)
+{
+	char *dir, filename[32];
+	time_t now = time(NULL);
+
+	ASSERT(!rec.running);
+	VERIFY3U(adc_trace_num_fields + n_ovrds, <=, ADC_TRACE_MAX_COLS);
+
+#ifdef	XRAAS_IS_EMBEDDED
+	dir = mkpathname(xraas_plugindir, ADC_REC_DIR, NULL);
+#else	/* !XRAAS_IS_EMBEDDED */
+	dir = mkpathname(xraas_xpdir, "Output", "X-RAAS", ADC_REC_DIR, NULL);
+#endif	/* !XRAAS_IS_EMBEDDED */
+	if (!create_directory_recursive(dir)) {
+		free(dir);
+		return (B_FALSE);
+	}
+	strftime(filename, sizeof (filename), "%Y-%m-%d_%H%M%S",
+	    localtime(&now));
+	rec.basename = mkpathname(dir, filename, NULL);
+	free(dir);
+
+	rec.n_ovrds = n_ovrds;
+	for (size_t i = 0; i < n_ovrds; i++) {
+		strlcpy(rec.ovrd_names[i], ovrds[i].name,
+		    sizeof (rec.ovrd_names[i]));
+	}
+	rec.cfg_hash = config_hash(xraas_state);
+
+	rec.shutdown = B_FALSE;
+	rec.failed = B_FALSE;
+	rec.head = 0;
+	rec.n_ring = 0;
+	rec.n_dropped = 0;
+	rec.chunk = 0;
+	rec.n_written = 0;
+	rec.n_dropped_total = 0;
+	mutex_init(&rec.lock);
+	cv_init(&rec.cv);
+	VERIFY(thread_create(&rec.thread, rec_thread, NULL));
+	rec.running = B_TRUE;
+	logMsg("Air data recording started: %s_*.txt", rec.basename);
+
+	return (B_TRUE);
+}
+
+static void
+rec_stop(void)
+{
+	ASSERT(rec.running);
+
+	mutex_enter(&rec.lock);
+	rec.shutdown = B_TRUE;
+	cv_broadcast(&rec.cv);
+	mutex_exit(&rec.lock);
+	thread_join(&rec.thread);
+
+	/* whatever the thread didn't get to is lost */
+	rec.n_dropped_total += rec.n_dropped;
+	for (unsigned i = 0; i < rec.n_ring; i++) {
+		rec.n_dropped_total += 1 +
+		    rec.ring[(rec.head + i) % ADC_REC_RING_SZ].n_dropped;
+	}
+	mutex_destroy(&rec.lock);
+	cv_destroy(&rec.cv);
+	logMsg("Air data recording stopped: %u samples in %u chunks, %u "
+	    "dropped", rec.n_written, rec.chunk, rec.n_dropped_total);
+	free(rec.basename);
+	rec.basename = NULL;
+	rec.running = B_FALSE;
+}
+
+static int
+rec_cmd_cb(XPLMCommandRef cmd, XPLMCommandPhase phase, void *refcon)
+{
+	UNUSED(refcon);
+	if (phase == xplm_CommandBegin)
+		rec.active = (cmd == rec.start_cmd);
+	return (1);
+}
+
+void
+adc_rec_init(void)
+{
+	ASSERT(!rec.inited);
+
+	rec.active = xraas_state->config.adc_rec;
+	dr_create_i(&rec.active_dr, &rec.active, B_TRUE,
+	    "xraas/adc_rec/active");
+	rec.start_cmd = XPLMCreateCommand("xraas/adc_rec/start",
+	    "Starts recording X-RAAS' air data input");
+	rec.stop_cmd = XPLMCreateCommand("xraas/adc_rec/stop",
+	    "Stops recording X-RAAS' air data input");
+	XPLMRegisterCommandHandler(rec.start_cmd, rec_cmd_cb, 0, NULL);
+	XPLMRegisterCommandHandler(rec.stop_cmd, rec_cmd_cb, 0, NULL);
+	rec.inited = B_TRUE;
+}
+
+void
+adc_rec_fini(void)
+{
+	if (!rec.inited)
+		return;
+	if (rec.running)
+		rec_stop();
+	XPLMUnregisterCommandHandler(rec.start_cmd, rec_cmd_cb, 0, NULL);
+	XPLMUnregisterCommandHandler(rec.stop_cmd, rec_cmd_cb, 0, NULL);
+	dr_delete(&rec.active_dr);
+	rec.active = 0;
+	rec.inited = B_FALSE;
+}
+
+/*
+ * Called with every new air data sample and the current values of the
+ * datarefs to record with it (always the same ones, in the same order).
+ * Also starts & stops the recording as requested.
+ */
+void
+adc_rec_sample(const adc_t *adc, const adc_rec_ovrd_t *ovrds,
+    size_t n_ovrds)
+{
+	bool_t failed;
+
+	ASSERT3U(n_ovrds, <=, ADC_REC_MAX_OVRDS);
+
+	if (!rec.inited)
+		return;
+	if (rec.running && !rec.active)
+		rec_stop();
+	if (!rec.running) {
+		if (!rec.active)
+			return;
+		if (!rec_start(ovrds, n_ovrds)) {
+			rec.active = 0;
+			return;
+		}
+	}
+	ASSERT3U(n_ovrds, ==, rec.n_ovrds);
+
+	mutex_enter(&rec.lock);
+	failed = rec.failed;
+	if (!failed && rec.n_ring == ADC_REC_RING_SZ) {
+		rec.n_dropped++;
+	} else if (!failed) {
+		rec_sample_t *sample =
+		    &rec.ring[(rec.head + rec.n_ring) % ADC_REC_RING_SZ];
+
+		sample->adc = *adc;
+		for (size_t i = 0; i < n_ovrds; i++)
+			sample->ovrds[i] = ovrds[i].value;
+		sample->n_dropped = rec.n_dropped;
+		rec.n_dropped = 0;
+		rec.n_ring++;
+		cv_signal(&rec.cv);
+	}
+	mutex_exit(&rec.lock);
+
+	if (failed) {
+		rec_stop();
+		rec.active = 0;
+	}
+}
@@ -0,0 +1,46 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_ADC_REC_H_
+#define	_XRAAS_ADC_REC_H_
+
+#include <stdlib.h>
+
+#include "airdata.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define	ADC_REC_MAX_OVRDS	24
+
+/* A dataref recorded along with the air data, e.g. an X-RAAS override. */
+typedef struct {
+	const char	*name;
+	double		value;
+} adc_rec_ovrd_t;
+
+void adc_rec_init(void);
+void adc_rec_fini(void);
+void adc_rec_sample(const adc_t *adc, const adc_rec_ovrd_t *ovrds,
+    size_t n_ovrds);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_ADC_REC_H_ */
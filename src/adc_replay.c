@@ -0,0 +1,497 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <XPLMDataAccess.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+
+#include "adc_backend.h"
+#include "adc_trace.h"
+#include "dbg_log.h"
+#include "xraas2.h"
+#include "xraas_cfg.h"
+
+/*
+ * Trace-replay air data backend. Selected with `adc_backend = replay' in
+ * X-RAAS.cfg, it feeds the monitors from a recorded air data trace
+ * (`adc_replay_file') instead of the simulator, one sample per flight
+ * loop. Relative trace paths are relative to the X-Plane folder.
+ *
+ * A trace is a text file. Lines starting with '#' are comments. The
+ * first other line names the columns (see adc_trace_fields below), every
+ * following line holds one sample with one whitespace-separated value
+ * per column. Columns may appear in any order and may be omitted, in
+ * which case the field stays 0 (or NAN for the FMS-supplied fields and
+ * the ILS data). Unless there is an n_gear column, the n_gear field is
+ * the number of gearN columns. Without a sim_time column, samples are
+ * timed by the sim's clock. Empty strings are written as "-" and a value
+ * of "=" repeats the column's value from the previous sample. Once the
+ * trace runs out, collect fails, so X-RAAS treats the air data as faulted.
+ *
+ * Columns named like a dataref (i.e. containing a '/') name writable int
+ * or float datarefs, such as the "xraas/override" ones. Their values are
+ * written to the dataref before the sample is passed on, so a trace can
+ * also reproduce what the avionics told X-RAAS. A "# config_hash" comment
+ * records the hash of the configuration the trace was recorded with (see
+ * config_hash), we warn if it doesn't match ours. A column header line
+ * may be repeated (e.g. when recorder chunks are concatenated), it
+ * redefines the columns of the samples following it.
+ */
+
+typedef struct {
+	const trace_field_t	*tf;	/* NULL for dataref columns */
+	XPLMDataRef		dr;
+	bool_t			dr_float;
+} col_t;
+
+#define	TF(name, field, type) { name, type, offsetof(adc_t, field) }
+#define	TF_GEAR(n) \
+	TF("gear" #n, gear[n], TF_FLOAT), \
+	TF("gear_type" #n, gear_type[n], TF_INT)
+const trace_field_t adc_trace_fields[] = {
+	TF("sim_time", sim_time, TF_DOUBLE),
+	TF("baro_alt", baro_alt, TF_DOUBLE),
+	TF("baro_set", baro_set, TF_DOUBLE),
+	TF("baro_sl", baro_sl, TF_DOUBLE),
+	TF("rad_alt", rad_alt, TF_DOUBLE),
+	TF("lat", lat, TF_DOUBLE),
+	TF("lon", lon, TF_DOUBLE),
+	TF("elev", elev, TF_DOUBLE),
+	TF("hdg", hdg, TF_DOUBLE),
+	TF("pitch", pitch, TF_DOUBLE),
+	TF("cas", cas, TF_DOUBLE),
+	TF("gs", gs, TF_DOUBLE),
+	TF("trans_alt", trans_alt, TF_INT),
+	TF("trans_lvl", trans_lvl, TF_INT),
+	TF("nw_offset", nw_offset, TF_FLOAT),
+	TF("flaprqst", flaprqst, TF_DOUBLE),
+	TF("n_gear", n_gear, TF_SIZE),
+	/* one TF_GEAR for each of the NUM_GEAR gear legs */
+	TF_GEAR(0), TF_GEAR(1), TF_GEAR(2), TF_GEAR(3), TF_GEAR(4),
+	TF_GEAR(5), TF_GEAR(6), TF_GEAR(7), TF_GEAR(8), TF_GEAR(9),
+	TF("takeoff_flaps_min", takeoff_flaps_min, TF_DOUBLE),
+	TF("takeoff_flaps_max", takeoff_flaps_max, TF_DOUBLE),
+	TF("landing_flaps_min", landing_flaps_min, TF_DOUBLE),
+	TF("landing_flaps_max", landing_flaps_max, TF_DOUBLE),
+	TF("vref", vref, TF_DOUBLE),
+	TF("vapp", vapp, TF_DOUBLE),
+	TF("ils_active", ils_info.active, TF_BOOL),
+	TF("ils_freq", ils_info.freq, TF_DOUBLE),
+	TF("ils_id", ils_info.id, TF_STR8),
+	TF("ils_hdef", ils_info.hdef, TF_DOUBLE),
+	TF("ils_vdef", ils_info.vdef, TF_DOUBLE)
+};
+const size_t adc_trace_num_fields = ARRAY_NUM_ELEM(adc_trace_fields);
+#undef	TF
+#undef	TF_GEAR
+
+static struct {
+	FILE			*fp;
+	char			*path;
+	unsigned		line_nr;
+	unsigned		n_samples;
+	size_t			n_cols;
+	col_t			cols[ADC_TRACE_MAX_COLS];
+	/* template with the defaults for omitted columns */
+	adc_t			dflt;
+	/* previous sample, for ADC_TRACE_REPEAT_STR */
+	adc_t			prev;
+	bool_t			cfg_warned;
+} replay;
+
+static void
+check_cfg_hash(const char *comment)
+{
+	unsigned long long hash;
+
+	if (replay.cfg_warned || strncmp(comment, ADC_TRACE_CFG_HASH,
+	    strlen(ADC_TRACE_CFG_HASH)) != 0 ||
+	    sscanf(&comment[strlen(ADC_TRACE_CFG_HASH)], "%llx", &hash) != 1)
+		return;
+	if (hash != config_hash(xraas_state)) {
+		logMsg("WARNING: air data trace %s was recorded with a "
+		    "different X-RAAS configuration, the replay may not "
+		    "reproduce the recorded flight.", replay.path);
+		replay.cfg_warned = B_TRUE;
+	}
+}
+
+/*
+ * Splits `line' in place into whitespace-separated tokens. Returns the
+ * number of tokens, or -1 if there are more than `max'.
+ */
+static int
+tokenize(char *line, char **toks, int max)
+{
+	int n = 0;
+
+	for (char *p = line;;) {
+		while (isspace((unsigned char)*p))
+			p++;
+		if (*p == 0)
+			return (n);
+		if (n == max)
+			return (-1);
+		toks[n++] = p;
+		while (*p != 0 && !isspace((unsigned char)*p))
+			p++;
+		if (*p != 0)
+			*p++ = 0;
+	}
+}
+
+/*
+ * Reads the next non-comment line into `buf' and tokenizes it. Returns
+ * the number of tokens, 0 at EOF, or -1 on error.
+ */
+static int
+read_line(char buf[ADC_TRACE_MAX_LINE_LEN], char **toks)
+{
+	while (fgets(buf, ADC_TRACE_MAX_LINE_LEN, replay.fp) != NULL) {
+		int n;
+
+		replay.line_nr++;
+		if (strchr(buf, '\n') == NULL && !feof(replay.fp)) {
+			logMsg("Error reading air data trace %s: line %u "
+			    "too long.", replay.path, replay.line_nr);
+			return (-1);
+		}
+		if (buf[0] == '#') {
+			check_cfg_hash(buf);
+			continue;
+		}
+		if ((n = tokenize(buf, toks, ADC_TRACE_MAX_COLS)) < 0) {
+			logMsg("Error reading air data trace %s: too many "
+			    "columns on line %u.", replay.path,
+			    replay.line_nr);
+			return (-1);
+		}
+		if (n != 0)
+			return (n);
+	}
+	return (0);
+}
+
+static bool_t
+parse_dr_col(const char *name, col_t *col)
+{
+	XPLMDataTypeID type;
+
+	col->dr = XPLMFindDataRef(name);
+	if (col->dr == NULL || !XPLMCanWriteDataRef(col->dr)) {
+		logMsg("Error reading air data trace %s: column \"%s\" on "
+		    "line %u isn't a writable dataref.", replay.path, name,
+		    replay.line_nr);
+		return (B_FALSE);
+	}
+	type = XPLMGetDataRefTypes(col->dr);
+	if (type & xplmType_Int) {
+		col->dr_float = B_FALSE;
+	} else if (type & (xplmType_Float | xplmType_Double)) {
+		col->dr_float = B_TRUE;
+	} else {
+		logMsg("Error reading air data trace %s: dataref \"%s\" on "
+		    "line %u isn't an int or float.", replay.path, name,
+		    replay.line_nr);
+		return (B_FALSE);
+	}
+	return (B_TRUE);
+}
+
+static const trace_field_t *
+find_field(const char *name)
+{
+	for (size_t i = 0; i < adc_trace_num_fields; i++) {
+		if (strcmp(adc_trace_fields[i].name, name) == 0)
+			return (&adc_trace_fields[i]);
+	}
+	return (NULL);
+}
+
+/*
+ * Tells a (repeated) column header apart from a sample.
+ */
+static bool_t
+is_col_name(const char *tok)
+{
+	return (strchr(tok, '/') != NULL || find_field(tok) != NULL);
+}
+
+/*
+ * Parses the column header held in `toks'.
+ */
+static bool_t
+parse_hdr(char **toks, int n)
+{
+	bool_t have_n_gear = B_FALSE;
+	size_t n_gear = 0;
+
+	memset(&replay.dflt, 0, sizeof (replay.dflt));
+	replay.dflt.takeoff_flaps_min = NAN;
+	replay.dflt.takeoff_flaps_max = NAN;
+	replay.dflt.landing_flaps_min = NAN;
+	replay.dflt.landing_flaps_max = NAN;
+	replay.dflt.vref = NAN;
+	replay.dflt.vapp = NAN;
+	replay.dflt.ils_info.freq = NAN;
+	replay.dflt.ils_info.hdef = NAN;
+	replay.dflt.ils_info.vdef = NAN;
+
+	for (int i = 0; i < n; i++) {
+		const trace_field_t *tf;
+
+		memset(&replay.cols[i], 0, sizeof (replay.cols[i]));
+		if (strchr(toks[i], '/') != NULL) {
+			if (!parse_dr_col(toks[i], &replay.cols[i]))
+				return (B_FALSE);
+			continue;
+		}
+		if ((tf = find_field(toks[i])) == NULL) {
+			logMsg("Error reading air data trace %s: unknown "
+			    "column \"%s\" on line %u.", replay.path, toks[i],
+			    replay.line_nr);
+			return (B_FALSE);
+		}
+		replay.cols[i].tf = tf;
+		if (strcmp(tf->name, "n_gear") == 0)
+			have_n_gear = B_TRUE;
+		else if (strncmp(tf->name, "gear", 4) == 0 &&
+		    isdigit((unsigned char)tf->name[4]))
+			n_gear++;
+	}
+	if (!have_n_gear)
+		replay.dflt.n_gear = n_gear;
+	replay.n_cols = n;
+	replay.prev = replay.dflt;
+
+	return (B_TRUE);
+}
+
+static size_t
+tf_size(const trace_field_t *tf)
+{
+	switch (tf->type) {
+	case TF_DOUBLE:
+		return (sizeof (double));
+	case TF_FLOAT:
+		return (sizeof (float));
+	case TF_INT:
+		return (sizeof (int));
+	case TF_BOOL:
+		return (sizeof (bool_t));
+	case TF_SIZE:
+		return (sizeof (size_t));
+	case TF_STR8:
+		return (8);
+	default:
+		VERIFY(0);
+		return (0);
+	}
+}
+
+static bool_t
+parse_val(const trace_field_t *tf, const char *str, adc_t *adc)
+{
+	void *field = (void *)((uintptr_t)adc + tf->off);
+	char *end;
+
+	errno = 0;
+	switch (tf->type) {
+	case TF_DOUBLE:
+		*(double *)field = strtod(str, &end);
+		break;
+	case TF_FLOAT:
+		*(float *)field = strtod(str, &end);
+		break;
+	case TF_INT:
+		*(int *)field = strtol(str, &end, 10);
+		break;
+	case TF_BOOL:
+		*(bool_t *)field = (strtol(str, &end, 10) != 0);
+		break;
+	case TF_SIZE:
+		*(size_t *)field = strtoul(str, &end, 10);
+		break;
+	case TF_STR8:
+		if (strcmp(str, ADC_TRACE_EMPTY_STR) == 0)
+			*(char *)field = 0;
+		else
+			strlcpy(field, str, 8);
+		return (B_TRUE);
+	}
+
+	return (errno == 0 && end != str && *end == 0);
+}
+
+static bool_t
+set_dr_col(const col_t *col, const char *str)
+{
+	char *end;
+	double val;
+
+	errno = 0;
+	val = strtod(str, &end);
+	if (errno != 0 || end == str || *end != 0)
+		return (B_FALSE);
+	if (col->dr_float)
+		XPLMSetDataf(col->dr, val);
+	else
+		XPLMSetDatai(col->dr, val);
+
+	return (B_TRUE);
+}
+
+static bool_t
+replay_init(void)
+{
+	const char *file = xraas_state->config.adc_replay_file;
+	char buf[ADC_TRACE_MAX_LINE_LEN];
+	char *toks[ADC_TRACE_MAX_COLS];
+	int n;
+
+	memset(&replay, 0, sizeof (replay));
+	if (*file == 0) {
+		logMsg("Air data trace replay requires adc_replay_file to be "
+		    "set.");
+		return (B_FALSE);
+	}
+	if (file[0] == '/' || file[0] == '\\' ||
+	    (isalpha((unsigned char)file[0]) && file[1] == ':'))
+		replay.path = strdup(file);
+	else
+		replay.path = mkpathname(xraas_xpdir, file, NULL);
+
+	replay.fp = fopen(replay.path, "r");
+	if (replay.fp == NULL) {
+		logMsg("Error opening air data trace %s: %s", replay.path,
+		    strerror(errno));
+		free(replay.path);
+		replay.path = NULL;
+		return (B_FALSE);
+	}
+	if ((n = read_line(buf, toks)) == 0) {
+		logMsg("Error reading air data trace %s: missing column "
+		    "header.", replay.path);
+	}
+	if (n <= 0 || !parse_hdr(toks, n)) {
+		fclose(replay.fp);
+		free(replay.path);
+		memset(&replay, 0, sizeof (replay));
+		return (B_FALSE);
+	}
+	dbg_log(adc, 1, "replaying %s, %d columns", replay.path,
+	    (int)replay.n_cols);
+
+	return (B_TRUE);
+}
+
+static void
+replay_fini(void)
+{
+	if (replay.fp != NULL) {
+		dbg_log(adc, 1, "replayed %u samples from %s",
+		    replay.n_samples, replay.path);
+		fclose(replay.fp);
+	}
+	free(replay.path);
+	memset(&replay, 0, sizeof (replay));
+}
+
+static bool_t
+replay_collect(adc_t *adc)
+{
+	char buf[ADC_TRACE_MAX_LINE_LEN];
+	char *toks[ADC_TRACE_MAX_COLS];
+	double sim_time;
+	int n;
+
+	if (replay.fp == NULL)
+		return (B_FALSE);
+
+	while ((n = read_line(buf, toks)) > 0 && is_col_name(toks[0])) {
+		if (!parse_hdr(toks, n)) {
+			fclose(replay.fp);
+			replay.fp = NULL;
+			return (B_FALSE);
+		}
+	}
+	if (n <= 0) {
+		if (n == 0) {
+			logMsg("Air data trace %s finished after %u samples.",
+			    replay.path, replay.n_samples);
+		}
+		/* stop replaying, the air data will remain faulted */
+		fclose(replay.fp);
+		replay.fp = NULL;
+		return (B_FALSE);
+	}
+	if ((size_t)n != replay.n_cols) {
+		logMsg("Error reading air data trace %s: expected %d values "
+		    "on line %u, found %d.", replay.path, (int)replay.n_cols,
+		    replay.line_nr, n);
+		return (B_FALSE);
+	}
+
+	sim_time = adc->sim_time;
+	*adc = replay.dflt;
+	adc->sim_time = sim_time;
+	for (int i = 0; i < n; i++) {
+		const trace_field_t *tf = replay.cols[i].tf;
+		bool_t repeat = (strcmp(toks[i], ADC_TRACE_REPEAT_STR) == 0);
+
+		if (tf == NULL) {
+			/* dataref columns keep their value on repeats */
+			if (repeat || set_dr_col(&replay.cols[i], toks[i]))
+				continue;
+		} else if (repeat) {
+			memcpy((void *)((uintptr_t)adc + tf->off),
+			    (void *)((uintptr_t)&replay.prev + tf->off),
+			    tf_size(tf));
+			continue;
+		} else if (parse_val(tf, toks[i], adc)) {
+			continue;
+		}
+		logMsg("Error reading air data trace %s: invalid value "
+		    "\"%s\" in column %d on line %u.", replay.path, toks[i],
+		    i + 1, replay.line_nr);
+		return (B_FALSE);
+	}
+	replay.prev = *adc;
+	replay.n_samples++;
+
+	return (B_TRUE);
+}
+
+const adc_backend_t adc_replay_backend = {
+	.name = "replay",
+	.init = replay_init,
+	.fini = replay_fini,
+	.collect = replay_collect,
+	.gpwc_rwy_data = NULL,
+	.auto_probe = B_FALSE
+};
@@ -0,0 +1,60 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_ADC_TRACE_H_
+#define	_XRAAS_ADC_TRACE_H_
+
+#include <stddef.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * Air data trace format, shared by the replay backend (adc_replay.c,
+ * which also describes the format) and the recorder (adc_rec.c).
+ */
+
+#define	ADC_TRACE_MAX_LINE_LEN	4096
+#define	ADC_TRACE_MAX_COLS	96
+#define	ADC_TRACE_EMPTY_STR	"-"
+#define	ADC_TRACE_REPEAT_STR	"="
+#define	ADC_TRACE_CFG_HASH	"# config_hash "
+
+typedef enum {
+	TF_DOUBLE,
+	TF_FLOAT,
+	TF_INT,
+	TF_BOOL,
+	TF_SIZE,
+	TF_STR8		/* char[8] */
+} trace_field_type_t;
+
+typedef struct {
+	const char		*name;
+	trace_field_type_t	type;
+	size_t			off;
+} trace_field_t;
+
+extern const trace_field_t adc_trace_fields[];
+extern const size_t adc_trace_num_fields;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_ADC_TRACE_H_ */
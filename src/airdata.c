@@ -23,6 +23,8 @@
  * Copyright 2017 Saso Kiselkov. All rights reserved.
  */
 
+#include <math.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <XPLMPlugin.h>
@@ -30,54 +32,86 @@
 #include <acfutils/assert.h>
 #include <acfutils/dr.h>
 #include <acfutils/geom.h>
+#include <acfutils/math.h>
 #include <acfutils/perf.h>
-#include <acfutils/thread.h>
 
 /* A320 interface */
 #include <FF_A320/SharedValue.h>
 
+#include "adc_backend.h"
 #include "airdata.h"
 #include "dbg_log.h"
 #include "nd_alert.h"
+#include "raw_trace.h"
 #include "xraas2.h"
 #include "../api/c/XRAAS_ND_msg_decode.h"
 
 #define	HDG_ALIGN_THRESH	20	/* degrees */
 #define	GPWC_ARPT_ELEV_THRESH	609	/* meters, 2000 feet */
-#define	ADC_PRINTF_FMT \
-	"ALT:%05.0fft/%02.2finHg/%04.0fm POS:%02.04fdeg/%03.04fdeg/%05.0fm " \
-	"ATT:%03.0fdeg/%02.1fdeg SPD:%03.0fkt/%03.0fmps TR:%05dft/%05dft " \
-	"FL:%0.02f-%0.02f/%0.02f-%0.02f VR:%03.0fkt/%03.0fkt " \
-	"ILS:%d/%.2f/%s/%.01f/%.01f"
-#define	ADC_PRINTF_ARGS(adc) \
-	(adc)->baro_alt, (adc)->baro_set, (adc)->rad_alt, (adc)->lat, \
-	(adc)->lon, (adc)->elev, (adc)->hdg, (adc)->pitch, (adc)->cas, \
-	(adc)->gs, (adc)->trans_alt, (adc)->trans_lvl, \
-	(adc)->takeoff_flaps_min, (adc)->takeoff_flaps_max, \
-	(adc)->landing_flaps_min, (adc)->landing_flaps_max, \
-	(adc)->vref, (adc)->vapp, (adc)->ils_info.active, \
-	(adc)->ils_info.active ? (adc)->ils_info.freq : 0.0, \
-	(adc)->ils_info.active ? (adc)->ils_info.id : "", \
-	(adc)->ils_info.active ? (adc)->ils_info.hdef : 0.0, \
-	(adc)->ils_info.active ? (adc)->ils_info.vdef : 0.0
 #define	XPLANE_NAV_TYPE_ILS	40
 
-enum {
-	XP_DEFAULT_INTERFACE,
-	FF_A320_INTERFACE,
-	INVALID_INTERFACE
-};
+#define	HIST_MAX_GAP		5	/* seconds */
+#define	HIST_VS_TAU		1.0	/* seconds */
+#define	HIST_ACCEL_TAU		1.0	/* seconds */
+#define	HIST_TRK_TAU		2.0	/* seconds */
+#define	HIST_TRK_MIN_DIST	1.0	/* meters */
 
-static void xp_adc_get(adc_t *adc);
+static bool_t xp_intf_init(void);
+static void xp_intf_fini(void);
+static bool_t xp_adc_get(adc_t *adc);
+static void xp_ils_get(adc_t *adc);
+static void adc_plan_log(void);
+static void adc_hist_reset(void);
+static void adc_hist_add(const adc_t *sample);
 
 static bool_t ff_a320_intf_init(void);
 static void ff_a320_intf_fini(void);
 static void __stdcall ff_a320_update(double step, void *tag);
 static bool_t ff_a320_adc_get(adc_t *adc);
+static bool_t ff_a320_gpwc_rwy_data(geo_pos3_t *thr_pos, double *len,
+    double *width, double *trk);
 static const char *ff_a320_type2str(unsigned int t);
 
+static const adc_backend_t xp_backend = {
+	.name = "xplane",
+	.init = xp_intf_init,
+	.fini = xp_intf_fini,
+	.collect = xp_adc_get,
+	.gpwc_rwy_data = NULL,
+	.auto_probe = B_TRUE
+};
+
+static const adc_backend_t ff_a320_backend = {
+	.name = "ff_a320",
+	.init = ff_a320_intf_init,
+	.fini = ff_a320_intf_fini,
+	.collect = ff_a320_adc_get,
+	.gpwc_rwy_data = ff_a320_gpwc_rwy_data,
+	.auto_probe = B_TRUE
+};
+
+/*
+ * Backend registry. When auto-probing, the first backend whose init
+ * succeeds is used, so aircraft-specific backends must precede the
+ * X-Plane default, which always succeeds.
+ */
+static const adc_backend_t *const backends[] = {
+	&ff_a320_backend,
+	&xp_backend,
+	&adc_replay_backend
+};
+
+static const adc_backend_t *backend = NULL;
 
-static int intf_type = INVALID_INTERFACE;
+static struct {
+	adc_t		ring[ADC_HIST_LEN];
+	unsigned	n;		/* samples since the last reset */
+	unsigned	head;		/* index of the newest sample */
+	double		trk;		/* degrees true, NAN if N/A */
+	double		vs;		/* meters/second */
+	double		accel;		/* meters/second^2 */
+	double		trk_rate;	/* degrees/second */
+} hist;
 
 static adc_t adc_l;
 const adc_t *adc = &adc_l;
@@ -85,9 +119,74 @@ const adc_t *adc = &adc_l;
 static drs_t drs_l;
 const drs_t *drs = &drs_l;
 
+/*
+ * Dataref read plan. Rather than reading every dataref on every tick,
+ * adc_collect executes this table in a single pass. Core fields are
+ * always read. The remaining groups are only read when an enabled
+ * monitor consumes them in the current flight phase (see
+ * adc_plan_groups). Fields of groups which aren't in the plan keep their
+ * last sampled values. Entries marked xp_only are supplied by the
+ * aircraft itself on the other interfaces (see ff_a320_update).
+ * Core entries must come first, since the plan groups are derived from
+ * the freshly read core fields.
+ */
+typedef enum {
+	ADC_GRP_CORE =	1 << 0,
+	ADC_GRP_ALTM =	1 << 1,	/* altimeter setting monitors */
+	ADC_GRP_ILS =	1 << 2,	/* too high approach monitors */
+	ADC_GRP_GEAR =	1 << 3	/* approach config monitors */
+} adc_grp_t;
+
+typedef enum {
+	ADC_RD_F,		/* float dataref into a double */
+	ADC_RD_D,		/* double dataref into a double */
+	ADC_RD_VF1,		/* first element of a float array */
+	ADC_RD_GEAR,		/* gear deployment & type arrays */
+	ADC_RD_ILS		/* NAV1/NAV2 ILS receiver block */
+} adc_rd_kind_t;
+
+typedef struct {
+	const char	*name;
+	adc_grp_t	grp;
+	bool_t		xp_only;
+	adc_rd_kind_t	kind;
+	size_t		dr_off;	/* dataref offset in drs_t */
+	size_t		adc_off; /* field offset in adc_t */
+} adc_rd_t;
+
+#define	ADC_RD(field, grp, xp_only, kind) \
+	{ #field, grp, xp_only, kind, offsetof(drs_t, field), \
+	    offsetof(adc_t, field) }
+static const adc_rd_t adc_plan[] = {
+	ADC_RD(rad_alt, ADC_GRP_CORE, B_TRUE, ADC_RD_F),
+	ADC_RD(lat, ADC_GRP_CORE, B_TRUE, ADC_RD_D),
+	ADC_RD(lon, ADC_GRP_CORE, B_TRUE, ADC_RD_D),
+	ADC_RD(elev, ADC_GRP_CORE, B_TRUE, ADC_RD_D),
+	ADC_RD(hdg, ADC_GRP_CORE, B_TRUE, ADC_RD_F),
+	ADC_RD(pitch, ADC_GRP_CORE, B_TRUE, ADC_RD_F),
+	ADC_RD(cas, ADC_GRP_CORE, B_TRUE, ADC_RD_F),
+	ADC_RD(gs, ADC_GRP_CORE, B_TRUE, ADC_RD_F),
+	ADC_RD(flaprqst, ADC_GRP_CORE, B_FALSE, ADC_RD_F),
+	ADC_RD(nw_offset, ADC_GRP_CORE, B_FALSE, ADC_RD_VF1),
+	ADC_RD(baro_alt, ADC_GRP_ALTM, B_TRUE, ADC_RD_F),
+	ADC_RD(baro_set, ADC_GRP_ALTM, B_TRUE, ADC_RD_F),
+	ADC_RD(baro_sl, ADC_GRP_ALTM, B_FALSE, ADC_RD_F),
+	ADC_RD(gear, ADC_GRP_GEAR, B_FALSE, ADC_RD_GEAR),
+	{ "ils", ADC_GRP_ILS, B_TRUE, ADC_RD_ILS, 0,
+	    offsetof(adc_t, ils_info) }
+};
+#undef	ADC_RD
+#define	NUM_ADC_RDS	ARRAY_NUM_ELEM(adc_plan)
+
+static struct {
+	int		groups;		/* last executed plan */
+	int		reads[NUM_ADC_RDS]; /* per-entry read counts */
+	dr_t		groups_dr;
+	dr_t		reads_dr;
+} plan;
+
 
 typedef struct ff_a320_rwy_info {
-	bool_t		changed;
 	bool_t		present;
 	geo_pos3_t	thr_pos;
 	double		length;
@@ -95,12 +194,47 @@ typedef struct ff_a320_rwy_info {
 	double		track;
 } ff_a320_rwy_info_t;
 
-static struct {
-	SharedValuesInterface	svi;
-	mutex_t			lock;
+/*
+ * Wait-free triple buffer for handing snapshots between a single writer
+ * and a single reader running on different threads. Each side owns one
+ * of three slots and the third slot is exchanged atomically with `mid'.
+ * The writer fills its `back' slot and swaps it into `mid', marking it
+ * TRIBUF_FRESH. The reader swaps its `front' slot with `mid' only if the
+ * latter is fresh. Neither side ever waits on the other and the reader
+ * always sees the last completely published snapshot.
+ */
+#define	TRIBUF_FRESH	0x4
+#define	TRIBUF_IDX	0x3
+
+typedef struct {
+	int	back;		/* owned by the writer */
+	int	mid;		/* shared, slot index | TRIBUF_FRESH */
+	int	front;		/* owned by the reader */
+} tribuf_t;
 
-	adc_t			adc;
-	bool_t			sys_ok;
+/*
+ * Typed handles to FF A320 shared values. ff_a320_bind looks up the value
+ * IDs and validates their types once, so the accessors can then read &
+ * write the values directly without re-checking the type on every access.
+ * The distinct handle types make passing a handle to an accessor of the
+ * wrong type a compile-time error.
+ */
+typedef struct { int id; } ff_s32_t;
+typedef struct { int id; } ff_f32_t;
+typedef struct { int id; } ff_f64_t;
+typedef struct { int id; } ff_str_t;
+
+typedef enum {
+	FF_VAL_S32,
+	FF_VAL_F32,
+	FF_VAL_F64,
+	FF_VAL_STR
+} ff_val_kind_t;
+
+/* The part of the FF A320's state we share with the flight loop. */
+typedef struct {
+	adc_t		adc;
+	bool_t		sys_ok;
 	struct {
 		bool_t powered;
 		bool_t alerting;
@@ -109,54 +243,108 @@ static struct {
 		bool_t inhibit_ex;
 		bool_t inhibit_flaps;
 	} status;
+} ff_a320_snap_t;
+
+static struct {
+	SharedValuesInterface	svi;
+
+	/*
+	 * ff_a320_update runs on the A320's avionics thread. It assembles
+	 * the snapshot in `work' and publishes it via snap_tb. The flight
+	 * loop picks up the latest snapshot in ff_a320_adc_get and all
+	 * status accessors read that same snapshot until the next one.
+	 */
+	ff_a320_snap_t		work;
+	ff_a320_snap_t		snaps[3];
+	tribuf_t		snap_tb;
+
+	bool_t			bound;	/* ff_a320_bind was run */
+	bool_t			bind_ok; /* all values bound OK */
 	struct {
-		int powered;			/* flag 0/1 */
-		int fault;			/* flag 0/1 */
-		int fault_ex;			/* flag 0/1 */
-		int inhibit;			/* flag 0/1 */
-		int inhibit_ex;			/* flag 0/1 */
-		int inhibit_flaps;		/* flag 0/1 */
-		int alert;			/* flag 0/1 */
-
-		int baro_alt;			/* meters */
-		int baro_raw;			/* meters */
-		int rad_alt;			/* meters */
-
-		int lat;			/* radians from equator */
-		int lon;			/* radians from 0th meridian */
-		int elev;			/* meters AMSL */
-
-		int hdg;			/* degrees true -180..+180 */
-
-		int cas;			/* meters/second */
-		int gs;				/* meters/second */
-
-		int rwy_lat;			/* radians from equator */
-		int rwy_lon;			/* radians from 0th meridian */
-		int rwy_len;			/* meters */
-		int rwy_width;			/* meters */
-		int rwy_track;			/* degrees true -180..+180 */
-		int rwy_elev;			/* meters */
-
-		int trans_alt;			/* meters */
-		int trans_lvl;			/* meters */
-
-		int takeoff_flaps;		/* int, 2-4 */
-		int landing_flaps;		/* int, 3-5 */
-		int vapp;			/* knots */
-
-		int localizer;			/* dots = 2 * (loc / 0.155) */
-		int localizer_valid;		/* bool */
-		int glideslope;			/* dots = 2 * (gs / 0.175) */
-		int glideslope_valid;		/* bool */
-
-		int adv_text;			/* string */
-		int adv_lvl;			/* 0=none, 1=green, 2=yellow */
+		ff_s32_t powered;		/* flag 0/1 */
+		ff_s32_t fault;			/* flag 0/1 */
+		ff_s32_t fault_ex;		/* flag 0/1 */
+		ff_s32_t inhibit;		/* flag 0/1 */
+		ff_s32_t inhibit_ex;		/* flag 0/1 */
+		ff_s32_t inhibit_flaps;		/* flag 0/1 */
+		ff_s32_t alert;			/* flag 0/1 */
+
+		ff_f32_t baro_alt;		/* meters */
+		ff_f32_t baro_raw;		/* meters */
+		ff_f32_t rad_alt;		/* meters */
+
+		ff_f32_t hdg;		/* degrees true -180..+180 */
+
+		ff_f32_t cas;			/* meters/second */
+		ff_f32_t gs;			/* meters/second */
+
+		ff_f64_t rwy_lat;		/* radians from equator */
+		ff_f64_t rwy_lon;		/* radians from 0th meridian */
+		ff_f32_t rwy_len;		/* meters */
+		ff_f32_t rwy_width;		/* meters */
+		ff_f32_t rwy_track;		/* degrees true -180..+180 */
+		ff_f32_t rwy_elev;		/* meters */
+
+		ff_f32_t trans_alt;		/* meters */
+		ff_f32_t trans_lvl;		/* meters */
+
+		ff_s32_t takeoff_flaps;		/* int, 2-4 */
+		ff_s32_t landing_flaps;		/* int, 3-5 */
+		ff_f32_t vapp;			/* knots */
+
+		ff_f32_t localizer;	/* dots = 2 * (loc / 0.155) */
+		ff_s32_t localizer_valid;	/* bool */
+		ff_f32_t glideslope;	/* dots = 2 * (gs / 0.175) */
+		ff_s32_t glideslope_valid;	/* bool */
+
+		ff_str_t adv_text;		/* string */
+		ff_s32_t adv_lvl;		/* 0=none, 1=green, 2=yellow */
 	} ids;
 
-	ff_a320_rwy_info_t rwy_info;
+	/*
+	 * The runway info travels the other way: ff_a320_rwy_info_set on
+	 * the flight loop publishes into rwy_tb, and ff_a320_update pushes
+	 * any freshly published runway to the A320's GPWC.
+	 */
+	ff_a320_rwy_info_t	rwy_info;
+	ff_a320_rwy_info_t	rwy_infos[3];
+	tribuf_t		rwy_tb;
 } ff_a320;
 
+static void
+tribuf_init(tribuf_t *tb)
+{
+	tb->back = 0;
+	tb->mid = 1;
+	tb->front = 2;
+}
+
+/*
+ * Writer side: publishes the `back' slot and takes over the old `mid'.
+ */
+static void
+tribuf_publish(tribuf_t *tb)
+{
+	tb->back = __atomic_exchange_n(&tb->mid, tb->back | TRIBUF_FRESH,
+	    __ATOMIC_ACQ_REL) & TRIBUF_IDX;
+}
+
+/*
+ * Reader side: if a fresh snapshot was published, makes it the `front'
+ * slot and returns B_TRUE. Otherwise `front' is left untouched.
+ */
+static bool_t
+tribuf_acquire(tribuf_t *tb)
+{
+	if ((__atomic_load_n(&tb->mid, __ATOMIC_ACQUIRE) & TRIBUF_FRESH) == 0)
+		return (B_FALSE);
+	tb->front = __atomic_exchange_n(&tb->mid, tb->front,
+	    __ATOMIC_ACQ_REL) & TRIBUF_IDX;
+	return (B_TRUE);
+}
+
+#define	FF_A320_SNAP	(&ff_a320.snaps[ff_a320.snap_tb.front])
+
 
 static XPLMDataRef
 dr_get(const char *drname)
@@ -166,6 +354,40 @@ dr_get(const char *drname)
 	return (dr);
 }
 
+/*
+ * Picks the air data backend. If `name' names a backend (other than
+ * "auto"), we try that one first. Otherwise, or if it fails, we use the
+ * first auto-probed backend that initializes successfully.
+ */
+static const adc_backend_t *
+adc_backend_select(const char *name)
+{
+	if (*name != 0 && strcmp(name, "auto") != 0) {
+		size_t i;
+
+		for (i = 0; i < ARRAY_NUM_ELEM(backends); i++) {
+			if (strcmp(backends[i]->name, name) == 0)
+				break;
+		}
+		if (i == ARRAY_NUM_ELEM(backends)) {
+			logMsg("Unknown air data backend \"%s\", "
+			    "auto-detecting instead.", name);
+		} else if (backends[i]->init()) {
+			return (backends[i]);
+		} else {
+			logMsg("Air data backend \"%s\" failed to initialize, "
+			    "auto-detecting instead.", name);
+		}
+	}
+	for (size_t i = 0; i < ARRAY_NUM_ELEM(backends); i++) {
+		if (backends[i]->auto_probe && backends[i]->init())
+			return (backends[i]);
+	}
+	/* the X-Plane backend always initializes */
+	VERIFY(0);
+	return (NULL);
+}
+
 bool_t
 adc_init(void)
 {
@@ -219,6 +441,7 @@ adc_init(void)
 	}
 
 	drs_l.replay_mode = dr_get("sim/operation/prefs/replay_mode");
+	drs_l.sim_time = dr_get("sim/time/total_running_time_sec");
 
 	drs_l.nav1_frequency = dr_get("sim/cockpit/radios/nav1_freq_hz");
 	drs_l.nav1_type = dr_get("sim/cockpit2/radios/indicators/nav1_type");
@@ -238,10 +461,15 @@ adc_init(void)
 	drs_l.nav2_power =
 	    dr_get("sim/cockpit2/radios/actuators/nav2_power");
 
-	if (ff_a320_intf_init())
-		intf_type = FF_A320_INTERFACE;
-	else
-		intf_type = XP_DEFAULT_INTERFACE;
+	memset(&plan, 0, sizeof (plan));
+	dr_create_i(&plan.groups_dr, &plan.groups, B_FALSE,
+	    "xraas/adc/plan/groups");
+	dr_create_vi(&plan.reads_dr, plan.reads, NUM_ADC_RDS, B_FALSE,
+	    "xraas/adc/plan/reads");
+
+	adc_hist_reset();
+	backend = adc_backend_select(xraas_state->config.adc_backend);
+	dbg_log(adc, 1, "using air data backend \"%s\"", backend->name);
 
 	return (B_TRUE);
 }
@@ -251,37 +479,256 @@ adc_fini(void)
 {
 	dbg_log(adc, 1, "fini");
 
+	adc_plan_log();
+	adc_hist_reset();
+	dr_delete(&plan.groups_dr);
+	dr_delete(&plan.reads_dr);
+
 	memset(&adc_l, 0, sizeof (adc_l));
 	memset(&drs_l, 0, sizeof (drs_l));
 
-	if (intf_type == FF_A320_INTERFACE)
-		ff_a320_intf_fini();
+	if (backend != NULL)
+		backend->fini();
+	backend = NULL;
+}
+
+/*
+ * Logs the per-entry read counts of the dataref read plan.
+ */
+static void
+adc_plan_log(void)
+{
+	char buf[512] = { 0 };
+	size_t len = 0;
+
+	for (size_t i = 0; i < NUM_ADC_RDS && len < sizeof (buf); i++) {
+		len += snprintf(&buf[len], sizeof (buf) - len, " %s:%d",
+		    adc_plan[i].name, plan.reads[i]);
+	}
+	dbg_log(adc, 1, "read plan counts:%s", buf);
+}
 
-	intf_type = INVALID_INTERFACE;
+/*
+ * Determines which optional groups of the read plan any enabled monitor
+ * needs in the current flight phase. All of them are only consumed when
+ * airborne (see air_runway_approach & altimeter_setting in xraas2.c).
+ */
+static int
+adc_plan_groups(void)
+{
+	const bool_t *mon = xraas_state->config.monitors;
+	int groups = ADC_GRP_CORE;
+
+	if (adc_l.rad_alt < RADALT_GRD_THRESH)
+		return (groups);
+
+	if (mon[ALTM_QNE_MON] || mon[ALTM_QNH_MON] || mon[ALTM_QFE_MON])
+		groups |= ADC_GRP_ALTM;
+	if (mon[APCH_TOO_HIGH_UPPER_MON] || mon[APCH_TOO_HIGH_LOWER_MON])
+		groups |= ADC_GRP_ILS;
+	if (mon[APCH_TOO_HIGH_UPPER_MON] || mon[APCH_TOO_HIGH_LOWER_MON] ||
+	    mon[APCH_TOO_FAST_UPPER_MON] || mon[APCH_TOO_FAST_LOWER_MON] ||
+	    mon[APCH_FLAPS_UPPER_MON] || mon[APCH_FLAPS_LOWER_MON] ||
+	    mon[APCH_UNSTABLE_MON] || mon[TWY_LAND_MON])
+		groups |= ADC_GRP_GEAR;
+
+	return (groups);
 }
 
-bool_t
-adc_collect(void)
+static void
+adc_plan_read(const adc_rd_t *rd)
 {
-	if (intf_type == FF_A320_INTERFACE) {
-		if (!ff_a320_adc_get(&adc_l))
-			return (B_FALSE);
-	} else if (intf_type == XP_DEFAULT_INTERFACE) {
-		xp_adc_get(&adc_l);
-	} else {
-		return (B_FALSE);
+	XPLMDataRef dr = *(XPLMDataRef *)((uintptr_t)&drs_l + rd->dr_off);
+	void *field = (void *)((uintptr_t)&adc_l + rd->adc_off);
+
+	switch (rd->kind) {
+	case ADC_RD_F:
+		*(double *)field = XPLMGetDataf(dr);
+		break;
+	case ADC_RD_D:
+		*(double *)field = XPLMGetDatad(dr);
+		break;
+	case ADC_RD_VF1:
+		XPLMGetDatavf(dr, field, 0, 1);
+		break;
+	case ADC_RD_GEAR:
+		adc_l.n_gear = XPLMGetDatavf(drs_l.gear, adc_l.gear, 0,
+		    NUM_GEAR);
+		VERIFY(adc_l.n_gear <= NUM_GEAR);
+		XPLMGetDatavi(drs_l.gear_type, adc_l.gear_type, 0,
+		    adc_l.n_gear);
+		break;
+	case ADC_RD_ILS:
+		xp_ils_get(&adc_l);
+		break;
 	}
+}
 
-	adc_l.baro_sl = XPLMGetDataf(drs_l.baro_sl);
+/*
+ * Executes the dataref read plan in a single pass over adc_plan.
+ */
+static void
+adc_plan_exec(bool_t xp_intf)
+{
+	int groups = ADC_GRP_CORE;
+	bool_t groups_known = B_FALSE;
 
-	XPLMGetDatavf(drs_l.nw_offset, &adc_l.nw_offset, 0, 1);
-	adc_l.flaprqst = XPLMGetDataf(drs_l.flaprqst);
+	for (size_t i = 0; i < NUM_ADC_RDS; i++) {
+		const adc_rd_t *rd = &adc_plan[i];
 
-	adc_l.n_gear = XPLMGetDatavf(drs_l.gear, adc_l.gear, 0, NUM_GEAR);
-	VERIFY(adc_l.n_gear <= NUM_GEAR);
-	XPLMGetDatavi(drs_l.gear_type, adc_l.gear_type, 0, adc_l.n_gear);
+		if (rd->xp_only && !xp_intf)
+			continue;
+		if (rd->grp != ADC_GRP_CORE && !groups_known) {
+			groups = adc_plan_groups();
+			groups_known = B_TRUE;
+		}
+		if ((groups & rd->grp) == 0)
+			continue;
+		adc_plan_read(rd);
+		plan.reads[i]++;
+	}
 
-	dbg_log(adc, 2, "collect; " ADC_PRINTF_FMT, ADC_PRINTF_ARGS(&adc_l));
+	if (groups != plan.groups) {
+		dbg_log(adc, 2, "read plan groups %x -> %x", plan.groups,
+		    groups);
+		plan.groups = groups;
+	}
+}
+
+static void
+adc_hist_reset(void)
+{
+	memset(&hist, 0, sizeof (hist));
+	hist.trk = NAN;
+}
+
+/*
+ * Exponential moving average gain for a sample `dt' seconds after the
+ * previous one, so the filter's time constant is `tau' regardless of
+ * the sampling rate.
+ */
+static double
+ema_gain(double dt, double tau)
+{
+	return (1 - exp(-dt / tau));
+}
+
+static void
+ema_update(double *est, double raw, double dt, double tau)
+{
+	/* seed the estimator with the first raw value */
+	if (hist.n == 1)
+		*est = raw;
+	else
+		*est += ema_gain(dt, tau) * (raw - *est);
+}
+
+/*
+ * Appends `sample' to the air data history & updates the rate estimators.
+ */
+static void
+adc_hist_add(const adc_t *sample)
+{
+	const adc_t *prev = adc_hist(0);
+	double dt = 0;
+
+	if (prev != NULL) {
+		dt = sample->sim_time - prev->sim_time;
+		if (dt <= 0)
+			/* sim paused or time went backwards, nothing new */
+			return;
+		if (dt > HIST_MAX_GAP) {
+			dbg_log(adc, 1, "history reset after %.1fs gap", dt);
+			adc_hist_reset();
+			prev = NULL;
+		}
+	}
+
+	if (prev != NULL) {
+		/* local flat-earth approximation is fine over a few meters */
+		double d_north = NM2MET(60) * (sample->lat - prev->lat);
+		double d_east = NM2MET(60) * rel_hdg(prev->lon, sample->lon) *
+		    cos(DEG2RAD(sample->lat));
+
+		ema_update(&hist.vs, (sample->elev - prev->elev) / dt, dt,
+		    HIST_VS_TAU);
+		ema_update(&hist.accel, (sample->gs - prev->gs) / dt, dt,
+		    HIST_ACCEL_TAU);
+		if (sqrt(POW2(d_north) + POW2(d_east)) >= HIST_TRK_MIN_DIST) {
+			double trk = RAD2DEG(atan2(d_east, d_north));
+
+			if (!isnan(hist.trk)) {
+				hist.trk_rate += ema_gain(dt, HIST_TRK_TAU) *
+				    (rel_hdg(hist.trk, trk) / dt -
+				    hist.trk_rate);
+			}
+			hist.trk = trk;
+		}
+		hist.head = (hist.head + 1) % ADC_HIST_LEN;
+	}
+	hist.ring[hist.head] = *sample;
+	hist.n++;
+}
+
+/*
+ * Returns the air data sample collected `ago' samples before the latest
+ * one (so adc_hist(0) is the current sample), or NULL if the history
+ * doesn't reach that far back.
+ */
+const adc_t *
+adc_hist(unsigned ago)
+{
+	if (ago >= MIN(hist.n, ADC_HIST_LEN))
+		return (NULL);
+	return (&hist.ring[(hist.head + ADC_HIST_LEN - ago) % ADC_HIST_LEN]);
+}
+
+/*
+ * Filtered vertical speed in meters/second, positive when climbing.
+ */
+double
+adc_vs(void)
+{
+	return (hist.vs);
+}
+
+/*
+ * Filtered rate of change of ground speed in meters/second^2, negative
+ * when decelerating.
+ */
+double
+adc_accel(void)
+{
+	return (hist.accel);
+}
+
+/*
+ * Filtered rate of change of the ground track in degrees/second,
+ * positive when turning right.
+ */
+double
+adc_trk_rate(void)
+{
+	return (hist.trk_rate);
+}
+
+bool_t
+adc_collect(void)
+{
+	if (backend == NULL)
+		return (B_FALSE);
+	adc_l.sim_time = XPLMGetDataf(drs_l.sim_time);
+	if (!backend->collect(&adc_l))
+		return (B_FALSE);
+	adc_hist_add(&adc_l);
+
+	if (!raw_trace_adc(RT_ADC_COLLECT, __LINE__, &adc_l)) {
+		dbg_log(adc, 2, "collect; " ADC_PRINTF_FMT,
+		    ADC_PRINTF_ARGS(&adc_l));
+		dbg_log(adc, 2, "rates; vs: %.2f m/s accel: %.2f m/s^2 "
+		    "trk_rate: %.2f deg/s", hist.vs, hist.accel,
+		    hist.trk_rate);
+	}
 
 	return (B_TRUE);
 }
@@ -294,37 +741,43 @@ adc_collect(void)
 bool_t
 adc_gpwc_rwy_data(geo_pos3_t *thr_pos, double *len, double *width, double *trk)
 {
-	if (intf_type != FF_A320_INTERFACE || !ff_a320.rwy_info.present)
+	if (backend == NULL || backend->gpwc_rwy_data == NULL)
 		return (B_FALSE);
+	return (backend->gpwc_rwy_data(thr_pos, len, width, trk));
+}
 
-	*thr_pos = ff_a320.rwy_info.thr_pos;
-	*len = ff_a320.rwy_info.length;
-	*width = ff_a320.rwy_info.width;
-	*trk = ff_a320.rwy_info.track;
-
+static bool_t
+xp_intf_init(void)
+{
 	return (B_TRUE);
 }
 
 static void
+xp_intf_fini(void)
+{
+}
+
+/*
+ * Fills in the fields of adc_t which X-Plane doesn't supply. Everything
+ * else is read via the read plan.
+ */
+static bool_t
 xp_adc_get(adc_t *adc)
 {
-	adc->baro_alt = XPLMGetDataf(drs_l.baro_alt);
-	adc->baro_set = XPLMGetDataf(drs_l.baro_set);
-	adc->rad_alt = XPLMGetDataf(drs_l.rad_alt);
-	adc->lat = XPLMGetDatad(drs_l.lat);
-	adc->lon = XPLMGetDatad(drs_l.lon);
-	adc->elev = XPLMGetDatad(drs_l.elev);
-	adc->hdg = XPLMGetDataf(drs_l.hdg);
-	adc->pitch = XPLMGetDataf(drs_l.pitch);
-	adc->cas = XPLMGetDataf(drs_l.cas);
-	adc->gs = XPLMGetDataf(drs_l.gs);
 	adc->takeoff_flaps_min = NAN;
 	adc->takeoff_flaps_max = NAN;
 	adc->landing_flaps_min = NAN;
 	adc->landing_flaps_max = NAN;
 	adc->vref = NAN;
 	adc->vapp = NAN;
+	adc_plan_exec(B_TRUE);
+
+	return (B_TRUE);
+}
 
+static void
+xp_ils_get(adc_t *adc)
+{
 	if (XPLMGetDatai(drs_l.nav1_power) == 1 &&
 	    XPLMGetDatai(drs_l.nav1_type) == XPLANE_NAV_TYPE_ILS) {
 		adc->ils_info.active = B_TRUE;
@@ -381,10 +834,10 @@ ff_a320_intf_init(void)
 		return (B_FALSE);
 	}
 
-	ff_a320.svi.DataAddUpdate(ff_a320_update, NULL);
+	tribuf_init(&ff_a320.snap_tb);
+	tribuf_init(&ff_a320.rwy_tb);
 
-	memset(&ff_a320.ids, 0xff, sizeof (ff_a320.ids));
-	mutex_init(&ff_a320.lock);
+	ff_a320.svi.DataAddUpdate(ff_a320_update, NULL);
 
 	dbg_log(ff_a320, 1, "init successful");
 
@@ -392,67 +845,43 @@ ff_a320_intf_init(void)
 }
 
 static inline int32_t
-ff_a320_gets32(int id)
+ff_a320_gets32(ff_s32_t h)
 {
 	int val;
-	unsigned int type = ff_a320.svi.ValueType(id);
-	ASSERT_MSG(type >= Value_Type_sint8 && type <= Value_Type_uint32,
-	    "%s isn't an integer type, instead it is %s",
-	    ff_a320.svi.ValueName(id), ff_a320_type2str(type));
-	ff_a320.svi.ValueGet(id, &val);
+	ff_a320.svi.ValueGet(h.id, &val);
 	return (val);
 }
 
 static inline void
-ff_a320_sets32(int id, int val)
+ff_a320_sets32(ff_s32_t h, int val)
 {
-	unsigned int type = ff_a320.svi.ValueType(id);
-	ASSERT_MSG(type >= Value_Type_sint8 && type <= Value_Type_uint32,
-	    "%s isn't an integer type, instead it is %s",
-	    ff_a320.svi.ValueName(id), ff_a320_type2str(type));
-	ff_a320.svi.ValueSet(id, &val);
+	ff_a320.svi.ValueSet(h.id, &val);
 }
 
 static inline void
-ff_a320_set_str(int id, const char *val)
+ff_a320_set_str(ff_str_t h, const char *val)
 {
-	unsigned int type = ff_a320.svi.ValueType(id);
-	ASSERT_MSG(type == Value_Type_String,
-	    "%s isn't a string type, instead it is %s",
-	    ff_a320.svi.ValueName(id), ff_a320_type2str(type));
-	ff_a320.svi.ValueSet(id, val);
+	ff_a320.svi.ValueSet(h.id, val);
 }
 
 static inline float
-ff_a320_getf32(int id)
+ff_a320_getf32(ff_f32_t h)
 {
 	float val;
-	unsigned int type = ff_a320.svi.ValueType(id);
-	ASSERT_MSG(type == Value_Type_float32,
-	    "%s isn't a float32 type, instead it is %s",
-	    ff_a320.svi.ValueName(id), ff_a320_type2str(type));
-	ff_a320.svi.ValueGet(id, &val);
+	ff_a320.svi.ValueGet(h.id, &val);
 	return (val);
 }
 
 static inline void
-ff_a320_setf32(int id, float val)
+ff_a320_setf32(ff_f32_t h, float val)
 {
-	unsigned int type = ff_a320.svi.ValueType(id);
-	ASSERT_MSG(type == Value_Type_float32,
-	    "%s isn't a float32 type, instead it is %s",
-	    ff_a320.svi.ValueName(id), ff_a320_type2str(type));
-	ff_a320.svi.ValueSet(id, &val);
+	ff_a320.svi.ValueSet(h.id, &val);
 }
 
 static inline void
-ff_a320_setf64(int id, double val)
+ff_a320_setf64(ff_f64_t h, double val)
 {
-	unsigned int type = ff_a320.svi.ValueType(id);
-	ASSERT_MSG(type == Value_Type_float64,
-	    "%s isn't a float64 type, instead it is %s",
-	    ff_a320.svi.ValueName(id), ff_a320_type2str(type));
-	ff_a320.svi.ValueSet(id, &val);
+	ff_a320.svi.ValueSet(h.id, &val);
 }
 
 static const char *
@@ -526,20 +955,135 @@ ff_a320_units2str(unsigned int units, char buf[32])
 	    (units & Value_Unit_Label) ? "9" : "");
 }
 
-static int
-ff_a320_val_id(const char *name)
+static bool_t
+ff_a320_type_ok(ff_val_kind_t kind, unsigned int type)
 {
-	int id = ff_a320.svi.ValueIdByName(name);
-	char units[32];
+	switch (kind) {
+	case FF_VAL_S32:
+		return (type >= Value_Type_sint8 && type <= Value_Type_uint32);
+	case FF_VAL_F32:
+		return (type == Value_Type_float32);
+	case FF_VAL_F64:
+		return (type == Value_Type_float64);
+	case FF_VAL_STR:
+		return (type == Value_Type_String);
+	}
+	return (B_FALSE);
+}
 
-	ff_a320_units2str(id, units);
-	dbg_log(ff_a320, 3, "%-44s  %-8s  %02x  %-10s  %s", name,
-	    ff_a320_type2str(ff_a320.svi.ValueType(id)),
-	    ff_a320.svi.ValueFlags(id),
-	    ff_a320.svi.ValueDesc(id),
-	    units);
+/*
+ * Resolves all the shared values we use into ff_a320.ids and validates
+ * their types. Returns B_FALSE if any value is missing or has a type
+ * different from what we expect.
+ */
+static bool_t
+ff_a320_bind(void)
+{
+#define	FF_VAL(field, kind, name) \
+	{ name, kind, offsetof(__typeof__(ff_a320.ids), field) }
+	static const struct {
+		const char	*name;
+		ff_val_kind_t	kind;
+		size_t		off;
+	} vals[] = {
+	    FF_VAL(powered, FF_VAL_S32, "Aircraft.Navigation.GPWC.Powered"),
+	    FF_VAL(fault, FF_VAL_S32, "Aircraft.Navigation.GPWC.Fault"),
+	    FF_VAL(fault_ex, FF_VAL_S32, "Aircraft.Navigation.GPWC.FaultEx"),
+	    FF_VAL(inhibit, FF_VAL_S32, "Aircraft.Navigation.GPWC.Inhibit"),
+	    FF_VAL(inhibit_ex, FF_VAL_S32,
+		"Aircraft.Navigation.GPWC.InhibitEx"),
+	    FF_VAL(inhibit_flaps, FF_VAL_S32,
+		"Aircraft.Navigation.GPWC.InhibitFlaps"),
+	    FF_VAL(alert, FF_VAL_S32, "Aircraft.Navigation.GPWC.Alert"),
+
+	    FF_VAL(baro_alt, FF_VAL_F32,
+		"Aircraft.Navigation.GPWC.AltitudeBaro"),
+	    FF_VAL(baro_raw, FF_VAL_F32, "Aircraft.Navigation.GPWC.Altitude"),
+	    FF_VAL(rad_alt, FF_VAL_F32, "Aircraft.Navigation.GPWC.Height"),
+
+	    FF_VAL(hdg, FF_VAL_F32, "Aircraft.Navigation.GPWC.Heading"),
+
+	    FF_VAL(cas, FF_VAL_F32, "Aircraft.Navigation.GPWC.AirSpeed"),
+	    FF_VAL(gs, FF_VAL_F32, "Aircraft.Navigation.GPWC.Speed"),
+
+	    FF_VAL(rwy_lat, FF_VAL_F64,
+		"Aircraft.Navigation.GPWC.RunwayPositionLat"),
+	    FF_VAL(rwy_lon, FF_VAL_F64,
+		"Aircraft.Navigation.GPWC.RunwayPositionLon"),
+	    FF_VAL(rwy_len, FF_VAL_F32,
+		"Aircraft.Navigation.GPWC.RunwayLength"),
+	    FF_VAL(rwy_width, FF_VAL_F32,
+		"Aircraft.Navigation.GPWC.RunwayWidth"),
+	    FF_VAL(rwy_track, FF_VAL_F32,
+		"Aircraft.Navigation.GPWC.RunwayTrack"),
+	    FF_VAL(rwy_elev, FF_VAL_F32,
+		"Aircraft.Navigation.GPWC.RunwayElevation"),
+
+	    FF_VAL(trans_alt, FF_VAL_F32,
+		"Aircraft.Navigation.GPWC.TransitionAltitude"),
+	    FF_VAL(trans_lvl, FF_VAL_F32,
+		"Aircraft.Navigation.GPWC.TransitionLevel"),
+
+	    FF_VAL(takeoff_flaps, FF_VAL_S32, "Aircraft.TakeoffConfig"),
+	    FF_VAL(landing_flaps, FF_VAL_S32, "Aircraft.LandingConfig"),
+	    FF_VAL(vapp, FF_VAL_F32,
+		"Aircraft.Navigation.GPWC.ApproachSpeed"),
+
+	    FF_VAL(glideslope, FF_VAL_F32,
+		"Aircraft.Navigation.GPWC.GlideSlope"),
+	    FF_VAL(glideslope_valid, FF_VAL_S32,
+		"Aircraft.Navigation.GPWC.GlideSlopeValid"),
+	    FF_VAL(localizer, FF_VAL_F32,
+		"Aircraft.Navigation.GPWC.Localizer"),
+	    FF_VAL(localizer_valid, FF_VAL_S32,
+		"Aircraft.Navigation.GPWC.LocalizerValid"),
+
+	    FF_VAL(adv_text, FF_VAL_STR,
+		"Aircraft.Navigation.GPWC.AdvisoryText"),
+	    FF_VAL(adv_lvl, FF_VAL_S32,
+		"Aircraft.Navigation.GPWC.AdvisoryLevel")
+	};
+#undef	FF_VAL
+	static const char *kind_names[] = {
+	    "an integer", "a float32", "a float64", "a string"
+	};
+	bool_t ok = B_TRUE;
 
-	return (id);
+	VERIFY(ff_a320.svi.ValueIdByName != NULL);
+	VERIFY(ff_a320.svi.ValueGet != NULL);
+	VERIFY(ff_a320.svi.ValueSet != NULL);
+	VERIFY(ff_a320.svi.ValueType != NULL);
+
+	for (size_t i = 0; i < ARRAY_NUM_ELEM(vals); i++) {
+		int id = ff_a320.svi.ValueIdByName(vals[i].name);
+		unsigned int type;
+		char units[32];
+
+		if (id == -1) {
+			logMsg("FF A320 interface error: shared value %s "
+			    "not found", vals[i].name);
+			ok = B_FALSE;
+			continue;
+		}
+		type = ff_a320.svi.ValueType(id);
+		units[0] = 0;
+		if (ff_a320.svi.ValueUnits != NULL)
+			ff_a320_units2str(ff_a320.svi.ValueUnits(id), units);
+		dbg_log(ff_a320, 3, "%-44s  %-8s  %02x  %-10s  %s",
+		    vals[i].name, ff_a320_type2str(type),
+		    ff_a320.svi.ValueFlags(id), ff_a320.svi.ValueDesc(id),
+		    units);
+		if (!ff_a320_type_ok(vals[i].kind, type)) {
+			logMsg("FF A320 interface error: shared value %s "
+			    "isn't %s type, instead it is %s", vals[i].name,
+			    kind_names[vals[i].kind], ff_a320_type2str(type));
+			ok = B_FALSE;
+			continue;
+		}
+		*(int *)((uintptr_t)&ff_a320.ids + vals[i].off) = id;
+	}
+
+	return (ok);
 }
 
 /*
@@ -571,9 +1115,21 @@ ff_a320_flaps2gates(int config, double *lower_gate, double *upper_gate)
 	}
 }
 
+/*
+ * Publishes the snapshot assembled in ff_a320.work. Fields which weren't
+ * updated in this pass retain their previously published values.
+ */
+static void
+ff_a320_snap_publish(void)
+{
+	ff_a320.snaps[ff_a320.snap_tb.back] = ff_a320.work;
+	tribuf_publish(&ff_a320.snap_tb);
+}
+
 static void __stdcall
 ff_a320_update(double step, void *tag)
 {
+	ff_a320_snap_t *work = &ff_a320.work;
 	double alt_uncorr;
 	adc_t ff_adc;
 	int nd_alert = ND_alert_status();
@@ -583,104 +1139,32 @@ ff_a320_update(double step, void *tag)
 	UNUSED(step);
 	UNUSED(tag);
 
-	VERIFY(ff_a320.svi.ValueIdByName != NULL);
-	VERIFY(ff_a320.svi.ValueGet != NULL);
-	VERIFY(ff_a320.svi.ValueType != NULL);
-	VERIFY(ff_a320.svi.ValueName != NULL);
-
 	memset(&ff_adc, 0, sizeof (ff_adc));
 
-	if (ff_a320.ids.baro_alt == -1) {
-		ff_a320.ids.powered =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.Powered");
-		ff_a320.ids.fault =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.Fault");
-		ff_a320.ids.fault_ex =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.FaultEx");
-		ff_a320.ids.inhibit =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.Inhibit");
-		ff_a320.ids.inhibit_ex =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.InhibitEx");
-		ff_a320.ids.inhibit_flaps =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.InhibitFlaps");
-		ff_a320.ids.alert =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.Alert");
-
-		ff_a320.ids.baro_alt =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.AltitudeBaro");
-		ff_a320.ids.baro_raw =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.Altitude");
-		ff_a320.ids.rad_alt =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.Height");
-
-		ff_a320.ids.lat =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.PositionLat");
-		ff_a320.ids.lon =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.PositionLon");
-		ff_a320.ids.elev =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.Elevation");
-		ff_a320.ids.hdg =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.Heading");
-
-		ff_a320.ids.cas =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.AirSpeed");
-		ff_a320.ids.gs =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.Speed");
-
-
-		ff_a320.ids.rwy_lat = ff_a320_val_id(
-		    "Aircraft.Navigation.GPWC.RunwayPositionLat");
-		ff_a320.ids.rwy_lon = ff_a320_val_id(
-		    "Aircraft.Navigation.GPWC.RunwayPositionLon");
-		ff_a320.ids.rwy_len =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.RunwayLength");
-		ff_a320.ids.rwy_width =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.RunwayWidth");
-		ff_a320.ids.rwy_track =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.RunwayTrack");
-		ff_a320.ids.rwy_elev =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.RunwayElevation");
-
-		ff_a320.ids.trans_alt = ff_a320_val_id(
-		    "Aircraft.Navigation.GPWC.TransitionAltitude");
-		ff_a320.ids.trans_lvl =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.TransitionLevel");
-
-		ff_a320.ids.takeoff_flaps =
-		    ff_a320_val_id("Aircraft.TakeoffConfig");
-		ff_a320.ids.landing_flaps =
-		    ff_a320_val_id("Aircraft.LandingConfig");
-		ff_a320.ids.vapp =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.ApproachSpeed");
-
-		ff_a320.ids.glideslope =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.GlideSlope");
-		ff_a320.ids.glideslope_valid =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.GlideSlopeValid");
-		ff_a320.ids.localizer =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.Localizer");
-		ff_a320.ids.localizer_valid =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.LocalizerValid");
-
-		ff_a320.ids.adv_text =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.AdvisoryText");
-		ff_a320.ids.adv_lvl =
-		    ff_a320_val_id("Aircraft.Navigation.GPWC.AdvisoryLevel");
+	if (!ff_a320.bound) {
+		ff_a320.bind_ok = ff_a320_bind();
+		ff_a320.bound = B_TRUE;
+	}
+	if (!ff_a320.bind_ok) {
+		work->sys_ok = B_FALSE;
+		ff_a320_snap_publish();
+		return;
 	}
 
-	ff_a320.status.powered = ff_a320_gets32(ff_a320.ids.powered);
+	work->status.powered = ff_a320_gets32(ff_a320.ids.powered);
 
 	if (ff_a320_gets32(ff_a320.ids.fault) != 0 ||
 	    ff_a320_gets32(ff_a320.ids.fault_ex) != 0) {
-		ff_a320.sys_ok = B_FALSE;
+		work->sys_ok = B_FALSE;
+		ff_a320_snap_publish();
 		return;
 	}
 
-	ff_a320.status.inhibit = ff_a320_gets32(ff_a320.ids.inhibit);
-	ff_a320.status.inhibit_ex = ff_a320_gets32(ff_a320.ids.inhibit_ex);
-	ff_a320.status.inhibit_flaps =
+	work->status.inhibit = ff_a320_gets32(ff_a320.ids.inhibit);
+	work->status.inhibit_ex = ff_a320_gets32(ff_a320.ids.inhibit_ex);
+	work->status.inhibit_flaps =
 	    ff_a320_gets32(ff_a320.ids.inhibit_flaps);
-	ff_a320.status.alerting = ff_a320_gets32(ff_a320.ids.alert);
+	work->status.alerting = ff_a320_gets32(ff_a320.ids.alert);
 
 	ff_adc.baro_alt = MET2FEET(ff_a320_getf32(ff_a320.ids.baro_alt));
 	alt_uncorr = MET2FEET(ff_a320_getf32(ff_a320.ids.baro_raw));
@@ -704,6 +1188,7 @@ ff_a320_update(double step, void *tag)
 	ff_adc.baro_set = 29.92 + ((ff_adc.baro_alt - alt_uncorr) / 1000.0);
 
 	ff_adc.rad_alt = MET2FEET(ff_a320_getf32(ff_a320.ids.rad_alt));
+	ff_adc.sim_time = XPLMGetDataf(drs_l.sim_time);
 
 	/*
 	 * The IRS positions can be quite inaccurate and result in spurious
@@ -733,25 +1218,27 @@ ff_a320_update(double step, void *tag)
 	ff_adc.vref = NAN;
 	ff_adc.vapp = ff_a320_getf32(ff_a320.ids.vapp);
 
-	dbg_log(ff_a320, 4, "update; " ADC_PRINTF_FMT,
-	    ADC_PRINTF_ARGS(&ff_adc));
+	if (!raw_trace_adc(RT_FF_A320_UPDATE, __LINE__, &ff_adc)) {
+		dbg_log(ff_a320, 4, "update; " ADC_PRINTF_FMT,
+		    ADC_PRINTF_ARGS(&ff_adc));
+	}
+
+	if (tribuf_acquire(&ff_a320.rwy_tb)) {
+		const ff_a320_rwy_info_t *ri =
+		    &ff_a320.rwy_infos[ff_a320.rwy_tb.front];
 
-	if (ff_a320.rwy_info.changed) {
-		if (ff_a320.rwy_info.present) {
-			double trk = ff_a320.rwy_info.track;
+		if (ri->present) {
+			double trk = ri->track;
 			if (trk > 180.0)
 				trk -= 360.0;
 			ff_a320_setf64(ff_a320.ids.rwy_lat,
-			    DEG2RAD(ff_a320.rwy_info.thr_pos.lat));
+			    DEG2RAD(ri->thr_pos.lat));
 			ff_a320_setf64(ff_a320.ids.rwy_lon,
-			    DEG2RAD(ff_a320.rwy_info.thr_pos.lon));
-			ff_a320_setf32(ff_a320.ids.rwy_len,
-			    ff_a320.rwy_info.length);
-			ff_a320_setf32(ff_a320.ids.rwy_width,
-			    ff_a320.rwy_info.width);
+			    DEG2RAD(ri->thr_pos.lon));
+			ff_a320_setf32(ff_a320.ids.rwy_len, ri->length);
+			ff_a320_setf32(ff_a320.ids.rwy_width, ri->width);
 			ff_a320_setf32(ff_a320.ids.rwy_track, trk);
-			ff_a320_setf32(ff_a320.ids.rwy_elev,
-			    ff_a320.rwy_info.thr_pos.lon);
+			ff_a320_setf32(ff_a320.ids.rwy_elev, ri->thr_pos.lon);
 		} else {
 			ff_a320_setf64(ff_a320.ids.rwy_lat, 4 * M_PI);
 			ff_a320_setf64(ff_a320.ids.rwy_lon, 4 * M_PI);
@@ -760,7 +1247,6 @@ ff_a320_update(double step, void *tag)
 			ff_a320_setf32(ff_a320.ids.rwy_track, -1.0);
 			ff_a320_setf32(ff_a320.ids.rwy_elev, -1000.0);
 		}
-		ff_a320.rwy_info.changed = B_FALSE;
 	}
 
 	if (ff_a320_gets32(ff_a320.ids.localizer_valid) == 1 &&
@@ -788,20 +1274,41 @@ ff_a320_update(double step, void *tag)
 		ff_a320_sets32(ff_a320.ids.adv_lvl, 0);
 	}
 
-	mutex_enter(&ff_a320.lock);
-	memcpy(&ff_a320.adc, &ff_adc, sizeof (ff_a320.adc));
-	ff_a320.sys_ok = B_TRUE;
-	mutex_exit(&ff_a320.lock);
+	memcpy(&work->adc, &ff_adc, sizeof (work->adc));
+	work->sys_ok = B_TRUE;
+	ff_a320_snap_publish();
 }
 
+/*
+ * Grabs the latest snapshot published by ff_a320_update. Called once per
+ * flight loop, so the air data and the status accessors below all see
+ * the same consistent snapshot.
+ */
 static bool_t
 ff_a320_adc_get(adc_t *adc)
 {
-	mutex_enter(&ff_a320.lock);
-	memcpy(adc, &ff_a320.adc, sizeof (*adc));
-	mutex_exit(&ff_a320.lock);
+	(void) tribuf_acquire(&ff_a320.snap_tb);
+	memcpy(adc, &FF_A320_SNAP->adc, sizeof (*adc));
+	if (!FF_A320_SNAP->sys_ok)
+		return (B_FALSE);
+	adc_plan_exec(B_FALSE);
 
-	return (ff_a320.sys_ok);
+	return (B_TRUE);
+}
+
+static bool_t
+ff_a320_gpwc_rwy_data(geo_pos3_t *thr_pos, double *len, double *width,
+    double *trk)
+{
+	if (!ff_a320.rwy_info.present)
+		return (B_FALSE);
+
+	*thr_pos = ff_a320.rwy_info.thr_pos;
+	*len = ff_a320.rwy_info.length;
+	*width = ff_a320.rwy_info.width;
+	*trk = ff_a320.rwy_info.track;
+
+	return (B_TRUE);
 }
 
 static void
@@ -809,7 +1316,6 @@ ff_a320_intf_fini(void)
 {
 	if (ff_a320.svi.DataDelUpdate != NULL)
 		ff_a320.svi.DataDelUpdate(ff_a320_update, NULL);
-	mutex_destroy(&ff_a320.lock);
 	memset(&ff_a320, 0, sizeof (ff_a320));
 	dbg_log(ff_a320, 1, "fini");
 }
@@ -817,14 +1323,13 @@ ff_a320_intf_fini(void)
 bool_t
 ff_a320_is_loaded(void)
 {
-	return (intf_type == FF_A320_INTERFACE);
+	return (backend == &ff_a320_backend);
 }
 
 static void
 ff_a320_rwy_info_set(bool_t present, geo_pos3_t thr, double length,
     double width, double track)
 {
-	mutex_enter(&ff_a320.lock);
 	if (present && (!ff_a320.rwy_info.present ||
 	    memcmp(&ff_a320.rwy_info.thr_pos, &thr, sizeof (thr)) != 0 ||
 	    ff_a320.rwy_info.length != length ||
@@ -833,7 +1338,6 @@ ff_a320_rwy_info_set(bool_t present, geo_pos3_t thr, double length,
 		dbg_log(ff_a320, 1, "rwy_info_set: p:%03.02f/%03.02f/%04.0f "
 		    "len:%04.0f w:%02.0f t:%03f", thr.lat, thr.lon, thr.elev,
 		    length, width, track);
-		ff_a320.rwy_info.changed = B_TRUE;
 		ff_a320.rwy_info.present = B_TRUE;
 		ff_a320.rwy_info.thr_pos = thr;
 		ff_a320.rwy_info.length = length;
@@ -842,10 +1346,11 @@ ff_a320_rwy_info_set(bool_t present, geo_pos3_t thr, double length,
 	} else if (!present && ff_a320.rwy_info.present) {
 		dbg_log(ff_a320, 1, "rwy_info_set: nil");
 		memset(&ff_a320.rwy_info, 0, sizeof (ff_a320.rwy_info));
-		ff_a320.rwy_info.changed = B_TRUE;
-		ff_a320.rwy_info.present = B_FALSE;
+	} else {
+		return;
 	}
-	mutex_exit(&ff_a320.lock);
+	ff_a320.rwy_infos[ff_a320.rwy_tb.back] = ff_a320.rwy_info;
+	tribuf_publish(&ff_a320.rwy_tb);
 }
 
 void
@@ -905,47 +1410,47 @@ ff_a320_find_nearest_rwy(void)
 bool_t
 ff_a320_powered(void)
 {
-	if (!ff_a320.status.powered)
+	if (!FF_A320_SNAP->status.powered)
 		dbg_log(ff_a320, 2, "powered: false");
-	return (ff_a320.status.powered);
+	return (FF_A320_SNAP->status.powered);
 }
 
 bool_t
 ff_a320_suppressed(void)
 {
-	if (ff_a320.status.suppressed)
+	if (FF_A320_SNAP->status.suppressed)
 		dbg_log(ff_a320, 2, "suppressed: true");
-	return (ff_a320.status.suppressed);
+	return (FF_A320_SNAP->status.suppressed);
 }
 
 bool_t
 ff_a320_alerting(void)
 {
-	if (ff_a320.status.alerting)
+	if (FF_A320_SNAP->status.alerting)
 		dbg_log(ff_a320, 2, "alerting: true");
-	return (ff_a320.status.alerting);
+	return (FF_A320_SNAP->status.alerting);
 }
 
 bool_t
 ff_a320_inhibit(void)
 {
-	if (ff_a320.status.inhibit)
+	if (FF_A320_SNAP->status.inhibit)
 		dbg_log(ff_a320, 2, "inhibit: true");
-	return (ff_a320.status.inhibit);
+	return (FF_A320_SNAP->status.inhibit);
 }
 
 bool_t
 ff_a320_inhibit_ex(void)
 {
-	if (ff_a320.status.inhibit_ex)
+	if (FF_A320_SNAP->status.inhibit_ex)
 		dbg_log(ff_a320, 2, "inhibit_ex: true");
-	return (ff_a320.status.inhibit_ex);
+	return (FF_A320_SNAP->status.inhibit_ex);
 }
 
 bool_t
 ff_a320_inhibit_flaps(void)
 {
-	if (ff_a320.status.inhibit_flaps)
+	if (FF_A320_SNAP->status.inhibit_flaps)
 		dbg_log(ff_a320, 2, "inhibit_flaps: true");
-	return (ff_a320.status.inhibit_flaps);
+	return (FF_A320_SNAP->status.inhibit_flaps);
 }
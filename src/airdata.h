@@ -47,6 +47,8 @@ extern "C" {
 #define	NUM_GEAR	10
 
 typedef struct {
+	double	sim_time;	/* seconds, when the sample was taken */
+
 	double	baro_alt;	/* feet */
 	double	baro_set;	/* in.Hg */
 	double	baro_sl;	/* in.Hg */
@@ -114,6 +116,7 @@ typedef struct {
 	XPLMDataRef gpws_prio;
 	XPLMDataRef gpws_inop;
 	XPLMDataRef replay_mode;
+	XPLMDataRef sim_time;
 
 	XPLMDataRef nav1_frequency;
 	XPLMDataRef nav1_type;
@@ -137,6 +140,22 @@ bool_t adc_init(void);
 void adc_fini(void);
 bool_t adc_collect(void);
 
+/*
+ * Air data history. adc_collect appends every new sample to a ring of the
+ * last ADC_HIST_LEN samples and updates filtered estimates of the rates
+ * below. The estimators use the actual sim time elapsed between samples,
+ * so they don't depend on how often we collect air data. While the sim
+ * is paused no samples are added and if the air data was unavailable for
+ * too long, the history restarts. Until two samples are available, all
+ * rates are zero.
+ */
+#define	ADC_HIST_LEN	16
+
+const adc_t *adc_hist(unsigned ago);
+double adc_vs(void);
+double adc_accel(void);
+double adc_trk_rate(void);
+
 bool_t adc_gpwc_rwy_data(geo_pos3_t *thr_pos, double *len, double *width,
     double *trk);
 
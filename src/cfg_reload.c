@@ -0,0 +1,317 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <XPLMProcessing.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+#include <acfutils/thread.h>
+#include <acfutils/time.h>
+
+#include "dbg_log.h"
+#include "gui.h"
+#include "init_msg.h"
+#include "xraas2.h"
+#include "xraas_cfg.h"
+
+#include "cfg_reload.h"
+
+/*
+ * Config hot-reload. A background thread polls the X-RAAS.cfg files in
+ * the config directories (global, aircraft & livery, see config_dirs)
+ * every POLL_INTVAL and fingerprints their contents. Once a change has
+ * been stable for one poll (so we don't pick up a half-written file), the
+ * thread builds & validates a complete new configuration from all the
+ * files and hands it over to the main thread. The main thread then
+ * switches over to it in one go using xraas_config_apply, in between two
+ * flight loops, so nothing ever runs with a partially updated config. A
+ * config with a syntax error or a nonsensical value is rejected as a
+ * whole and the previous one stays in effect.
+ */
+
+#define	POLL_INTVAL		1000000		/* us */
+#define	APPLY_INTVAL		1.0		/* seconds */
+#define	CFG_PATH_MAX		1024
+
+typedef struct {
+	bool_t		ok;
+	char		error[512];
+	xraas_config_t	config;
+	debug_config_t	dbg;
+	config_origin_t	origin;
+} result_t;
+
+static struct {
+	bool_t		inited;
+	thread_t	thread;
+	mutex_t		lock;
+	condvar_t	cv;
+
+	/* protected by lock */
+	bool_t		shutdown;
+	unsigned	gen;	/* bumped whenever the dirs change */
+	size_t		n_dirs;
+	char		dirs[NUM_CONFIG_DIRS][CFG_PATH_MAX];
+	config_fprint_t	applied[NUM_CONFIG_DIRS];
+	result_t	*pending;
+} cr;
+
+static bool_t
+fprints_equal(const config_fprint_t *a, const config_fprint_t *b, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		if (a[i].exists != b[i].exists || a[i].crc != b[i].crc)
+			return (B_FALSE);
+	}
+	return (B_TRUE);
+}
+
+/*
+ * Builds a new configuration from the config files in `dirs'. Only
+ * touches the returned result, so it's safe to call off the main thread.
+ */
+static result_t *
+build_config(char dirs[][CFG_PATH_MAX], size_t n_dirs)
+{
+	result_t *res = calloc(1, sizeof (*res));
+	const char *dirp[NUM_CONFIG_DIRS];
+	char reason[256];
+	size_t errdir;
+	int errline;
+
+	for (size_t i = 0; i < n_dirs; i++)
+		dirp[i] = dirs[i];
+	if (!config_parse(dirp, n_dirs, &res->config, &res->dbg,
+	    &res->origin, &errdir, &errline)) {
+		char *cfgname = mkpathname(dirs[errdir], "X-RAAS.cfg", NULL);
+		snprintf(res->error, sizeof (res->error), "syntax error on "
+		    "line %d in config file:\n%s", errline, cfgname);
+		free(cfgname);
+	} else if (!config_validate(&res->config, reason, sizeof (reason))) {
+		snprintf(res->error, sizeof (res->error), "invalid config "
+		    "value, the following must hold: %s", reason);
+	} else {
+		res->ok = B_TRUE;
+	}
+
+	return (res);
+}
+
+static void
+apply_config(result_t *res)
+{
+	if (!res->ok) {
+		logMsg("X-RAAS: config not reloaded, %s", res->error);
+		log_init_msg(B_TRUE, INIT_ERR_MSG_TIMEOUT, "5",
+		    "Configuration", "X-RAAS configuration error: %s\n"
+		    "The previous configuration remains in effect.",
+		    res->error);
+		return;
+	}
+	xraas_config_apply(&res->config, &res->dbg, &res->origin);
+	gui_update();
+}
+
+static void
+watch_thread(void *unused)
+{
+	char dirs[NUM_CONFIG_DIRS][CFG_PATH_MAX];
+	config_fprint_t applied[NUM_CONFIG_DIRS], cur[NUM_CONFIG_DIRS];
+	config_fprint_t prev[NUM_CONFIG_DIRS];
+	unsigned gen, prev_gen = 0;
+	bool_t have_prev = B_FALSE;
+	size_t n_dirs;
+
+	UNUSED(unused);
+
+	mutex_enter(&cr.lock);
+	while (!cr.shutdown) {
+		result_t *res = NULL;
+
+		cv_timedwait(&cr.cv, &cr.lock, microclock() + POLL_INTVAL);
+		if (cr.shutdown)
+			break;
+		gen = cr.gen;
+		n_dirs = cr.n_dirs;
+		memcpy(dirs, cr.dirs, sizeof (dirs));
+		memcpy(applied, cr.applied, sizeof (applied));
+		mutex_exit(&cr.lock);
+
+		for (size_t i = 0; i < n_dirs; i++)
+			config_fingerprint(dirs[i], &cur[i]);
+		if (have_prev && gen == prev_gen &&
+		    !fprints_equal(cur, applied, n_dirs) &&
+		    fprints_equal(cur, prev, n_dirs)) {
+			dbg_log(config, 1, "config files changed, reloading");
+			res = build_config(dirs, n_dirs);
+		}
+		memcpy(prev, cur, sizeof (prev));
+		prev_gen = gen;
+		have_prev = B_TRUE;
+
+		mutex_enter(&cr.lock);
+		if (res != NULL && gen == cr.gen) {
+			free(cr.pending);
+			cr.pending = res;
+			/* don't report a broken config more than once */
+			memcpy(cr.applied, cur, sizeof (cur));
+		} else {
+			free(res);
+		}
+	}
+	mutex_exit(&cr.lock);
+}
+
+static float
+apply_cb(float elapsed1, float elapsed2, int counter, void *refcon)
+{
+	result_t *res;
+
+	UNUSED(elapsed1);
+	UNUSED(elapsed2);
+	UNUSED(counter);
+	UNUSED(refcon);
+
+	mutex_enter(&cr.lock);
+	res = cr.pending;
+	cr.pending = NULL;
+	mutex_exit(&cr.lock);
+
+	if (res != NULL) {
+		apply_config(res);
+		free(res);
+	}
+
+	return (APPLY_INTVAL);
+}
+
+void
+cfg_reload_init(void)
+{
+	ASSERT(!cr.inited);
+
+	cr.shutdown = B_FALSE;
+	cr.gen = 0;
+	cr.n_dirs = 0;
+	cr.pending = NULL;
+	mutex_init(&cr.lock);
+	cv_init(&cr.cv);
+	VERIFY(thread_create(&cr.thread, watch_thread, NULL));
+	XPLMRegisterFlightLoopCallback(apply_cb, APPLY_INTVAL, NULL);
+
+	cr.inited = B_TRUE;
+}
+
+void
+cfg_reload_fini(void)
+{
+	if (!cr.inited)
+		return;
+
+	XPLMUnregisterFlightLoopCallback(apply_cb, NULL);
+	mutex_enter(&cr.lock);
+	cr.shutdown = B_TRUE;
+	cv_broadcast(&cr.cv);
+	mutex_exit(&cr.lock);
+	thread_join(&cr.thread);
+
+	free(cr.pending);
+	cr.pending = NULL;
+	mutex_destroy(&cr.lock);
+	cv_destroy(&cr.cv);
+
+	cr.inited = B_FALSE;
+}
+
+/*
+ * Starts watching the config files in the current config directories
+ * (which change when a new aircraft or livery is loaded). Called from
+ * xraas_init just before the configs are loaded, so the fingerprints
+ * taken here correspond to the config we start with.
+ */
+void
+cfg_reload_watch(void)
+{
+	const char *dirs[NUM_CONFIG_DIRS];
+	config_fprint_t fps[NUM_CONFIG_DIRS];
+	size_t n_dirs;
+
+	if (!cr.inited)
+		return;
+
+	n_dirs = config_dirs(dirs);
+	for (size_t i = 0; i < n_dirs; i++)
+		config_fingerprint(dirs[i], &fps[i]);
+
+	mutex_enter(&cr.lock);
+	cr.gen++;
+	cr.n_dirs = n_dirs;
+	for (size_t i = 0; i < n_dirs; i++)
+		strlcpy(cr.dirs[i], dirs[i], sizeof (cr.dirs[i]));
+	memcpy(cr.applied, fps, sizeof (fps));
+	free(cr.pending);
+	cr.pending = NULL;
+	mutex_exit(&cr.lock);
+}
+
+/*
+ * Reloads the config files right away. Used by the config GUI after it
+ * has written or removed a config file.
+ */
+void
+cfg_reload_now(void)
+{
+	char dirs[NUM_CONFIG_DIRS][CFG_PATH_MAX];
+	config_fprint_t fps[NUM_CONFIG_DIRS];
+	result_t *res;
+	size_t n_dirs;
+
+	if (!cr.inited) {
+		n_dirs = 0;
+	} else {
+		mutex_enter(&cr.lock);
+		n_dirs = cr.n_dirs;
+		memcpy(dirs, cr.dirs, sizeof (dirs));
+		mutex_exit(&cr.lock);
+	}
+	if (n_dirs == 0) {
+		xraas_fini();
+		xraas_init();
+		gui_update();
+		return;
+	}
+
+	for (size_t i = 0; i < n_dirs; i++)
+		config_fingerprint(dirs[i], &fps[i]);
+	res = build_config(dirs, n_dirs);
+
+	mutex_enter(&cr.lock);
+	/* anything the watcher has found is superseded by this */
+	cr.gen++;
+	memcpy(cr.applied, fps, sizeof (fps));
+	free(cr.pending);
+	cr.pending = NULL;
+	mutex_exit(&cr.lock);
+
+	apply_config(res);
+	free(res);
+}
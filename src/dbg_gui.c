@@ -33,6 +33,7 @@
 
 #include "airdata.h"
 #include "dbg_log.h"
+#include "stats.h"
 #include "xraas2.h"
 #include "dbg_gui.h"
 
@@ -69,21 +70,18 @@ draw_bbox(const vect2_t *bbox, bool_t filled)
 	glEnd();
 }
 
-static int
-draw_cb(XPLMDrawingPhase phase, int before, void *refcon)
+static void
+draw(void)
 {
 	vect2_t pos_v, vel_v, tgt_v;
 	const airport_t *arpt;
 	geo_pos3_t rwy_pos;
 	double rwy_len, rwy_width, rwy_trk;
 
-	UNUSED(phase);
-	UNUSED(before);
-	UNUSED(refcon);
 	ASSERT(dbg_gui_inited);
 
 	if ((arpt = find_nearest_curarpt()) == NULL)
-		return (1);
+		return;
 	ASSERT(arpt->load_complete);
 
 	pos_v = geo2fpp(GEO_POS2(adc->lat, adc->lon), &arpt->fpp);
@@ -169,6 +167,19 @@ draw_cb(XPLMDrawingPhase phase, int before, void *refcon)
 	glColor4f(0, 1, 1, 1);
 	draw_line(DBG_X(pos_v.x), DBG_Y(pos_v.y),
 	    DBG_X(tgt_v.x), DBG_Y(tgt_v.y));
+}
+
+static int
+draw_cb(XPLMDrawingPhase phase, int before, void *refcon)
+{
+	uint64_t t = stats_start();
+
+	UNUSED(phase);
+	UNUSED(before);
+	UNUSED(refcon);
+
+	draw();
+	stats_end(STATS_DBG_GUI_DRAW, t);
 
 	return (1);
 }
@@ -16,6 +16,557 @@
  * Copyright 2017 Saso Kiselkov. All rights reserved.
  */
 
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+#include <acfutils/thread.h>
+#include <acfutils/time.h>
+
 #include "dbg_log.h"
 
 debug_config_t xraas_debug_config;
+
+/*
+ * Asynchronous dbg_log backend. Once dbg_log_async_init has been called,
+ * dbg_log doesn't format & write its messages on the caller's thread.
+ * Instead, it only captures the format string pointer and the raw
+ * argument values into a slot of a lock-free multi-producer ring buffer
+ * (strings are copied, since they might not outlive the call). A
+ * background thread drains the ring every DBG_LOG_FLUSH_INTVAL (or
+ * sooner, once a quarter of the ring has filled up), renders the
+ * messages and hands them to the log. If the ring is full, messages
+ * are dropped and the drop count is reported in the log. Format strings
+ * using conversions we can't capture (or too many arguments) fall back to
+ * synchronous logging.
+ *
+ * The ring is a bounded MPMC queue in the style of D. Vyukov: each slot
+ * carries a sequence number telling producers and the consumer whose
+ * turn it is to use the slot, so producers only contend on the tail
+ * index. The ring itself is static and is never reset, so a producer
+ * racing with dbg_log_async_fini can't touch freed memory. Producers
+ * also count themselves in `n_busy' while they're queueing, so that
+ * dbg_log_async_fini can wait for any stragglers which still saw
+ * `running' set before it destroys the lock & condvar.
+ */
+
+#define	DBG_LOG_RING_SZ		512	/* power of 2 */
+#define	DBG_LOG_MAX_ARGS	32
+#define	DBG_LOG_STR_BUF		256	/* per slot */
+#define	DBG_LOG_MAX_SPEC	16	/* flags+width+prec length */
+#define	DBG_LOG_LINE_LEN	4096
+#define	DBG_LOG_FLUSH_INTVAL	50000	/* us */
+#define	DBG_LOG_FINI_POLL	1000	/* us */
+
+typedef union {
+	long long		i;
+	unsigned long long	u;
+	double			d;
+	const void		*p;
+	const char		*s;
+} dbg_arg_t;
+
+typedef struct {
+	unsigned	seq;
+	const char	*filename;
+	int		line;
+	/* NULL if the message was logged synchronously instead */
+	const char	*fmt;
+	int		n_args;
+	dbg_arg_t	args[DBG_LOG_MAX_ARGS];
+	size_t		str_fill;
+	char		strs[DBG_LOG_STR_BUF];
+} dbg_slot_t;
+
+typedef enum {
+	LEN_NONE,
+	LEN_HH,
+	LEN_H,
+	LEN_L,
+	LEN_LL,
+	LEN_J,
+	LEN_Z,
+	LEN_T
+} len_mod_t;
+
+/* A parsed printf conversion specification. */
+typedef struct {
+	const char	*flags;		/* flags, width & precision */
+	size_t		flags_len;
+	int		n_stars;	/* `*' width & precision args */
+	len_mod_t	len;
+	char		conv;
+	const char	*end;
+} dbg_spec_t;
+
+static dbg_slot_t ring[DBG_LOG_RING_SZ];
+static bool_t ring_inited = B_FALSE;
+
+static struct {
+	bool_t		inited;
+	bool_t		running;	/* atomic, checked by producers */
+	unsigned	n_busy;		/* atomic, producers in async_log */
+	unsigned	tail;		/* atomic, next slot to produce */
+	unsigned	head;		/* next slot to consume */
+	unsigned long long n_logged;
+	unsigned long long n_dropped;	/* atomic */
+	unsigned long long n_dropped_rep;
+
+	thread_t	thread;
+	mutex_t		lock;
+	condvar_t	cv;
+	bool_t		shutdown;
+} async;
+
+/*
+ * Parses the conversion specification starting with the '%' at `p'.
+ * Returns B_FALSE if it isn't one we know how to capture.
+ */
+static bool_t
+spec_parse(const char *p, dbg_spec_t *spec)
+{
+	ASSERT3U(*p, ==, '%');
+
+	memset(spec, 0, sizeof (*spec));
+	spec->flags = ++p;
+	while (*p != 0 && strchr("-+ #0", *p) != NULL)
+		p++;
+	if (*p == '*') {
+		spec->n_stars++;
+		p++;
+	} else {
+		while (isdigit((unsigned char)*p))
+			p++;
+	}
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->n_stars++;
+			p++;
+		} else {
+			while (isdigit((unsigned char)*p))
+				p++;
+		}
+	}
+	spec->flags_len = p - spec->flags;
+	if (spec->flags_len > DBG_LOG_MAX_SPEC)
+		return (B_FALSE);
+
+	switch (*p) {
+	case 'h':
+		spec->len = (p[1] == 'h' ? LEN_HH : LEN_H);
+		p += (p[1] == 'h' ? 2 : 1);
+		break;
+	case 'l':
+		spec->len = (p[1] == 'l' ? LEN_LL : LEN_L);
+		p += (p[1] == 'l' ? 2 : 1);
+		break;
+	case 'j':
+		spec->len = LEN_J;
+		p++;
+		break;
+	case 'z':
+		spec->len = LEN_Z;
+		p++;
+		break;
+	case 't':
+		spec->len = LEN_T;
+		p++;
+		break;
+	}
+
+	if (*p == 0 || strchr("diouxXcspfFeEgGaA%", *p) == NULL)
+		return (B_FALSE);
+	spec->conv = *p;
+	spec->end = p + 1;
+	/* wide chars & strings and long doubles aren't supported */
+	if (spec->len != LEN_NONE && strchr("diouxX", spec->conv) == NULL &&
+	    !(spec->len == LEN_L && strchr("fFeEgGaA", spec->conv) != NULL))
+		return (B_FALSE);
+
+	return (B_TRUE);
+}
+
+/*
+ * Captures the arguments of `fmt' from `ap' into `slot'. Returns B_FALSE
+ * if the format string can't be captured.
+ */
+static bool_t
+capture(dbg_slot_t *slot, const char *fmt, va_list ap)
+{
+	slot->n_args = 0;
+	slot->str_fill = 0;
+
+	for (const char *p = strchr(fmt, '%'); p != NULL;
+	    p = strchr(p, '%')) {
+		dbg_spec_t spec;
+		dbg_arg_t *arg;
+
+		if (!spec_parse(p, &spec))
+			return (B_FALSE);
+		p = spec.end;
+		if (spec.conv == '%')
+			continue;
+		if (slot->n_args + spec.n_stars + 1 > DBG_LOG_MAX_ARGS)
+			return (B_FALSE);
+		for (int i = 0; i < spec.n_stars; i++)
+			slot->args[slot->n_args++].i = va_arg(ap, int);
+
+		arg = &slot->args[slot->n_args++];
+		switch (spec.conv) {
+		case 'd':
+		case 'i':
+			switch (spec.len) {
+			case LEN_L:
+				arg->i = va_arg(ap, long);
+				break;
+			case LEN_LL:
+				arg->i = va_arg(ap, long long);
+				break;
+			case LEN_J:
+				arg->i = va_arg(ap, intmax_t);
+				break;
+			case LEN_Z:
+				arg->i = va_arg(ap, ssize_t);
+				break;
+			case LEN_T:
+				arg->i = va_arg(ap, ptrdiff_t);
+				break;
+			default:
+				/* char & short are promoted to int */
+				arg->i = va_arg(ap, int);
+				if (spec.len == LEN_HH)
+					arg->i = (signed char)arg->i;
+				else if (spec.len == LEN_H)
+					arg->i = (short)arg->i;
+				break;
+			}
+			break;
+		case 'o':
+		case 'u':
+		case 'x':
+		case 'X':
+			switch (spec.len) {
+			case LEN_L:
+				arg->u = va_arg(ap, unsigned long);
+				break;
+			case LEN_LL:
+				arg->u = va_arg(ap, unsigned long long);
+				break;
+			case LEN_J:
+				arg->u = va_arg(ap, uintmax_t);
+				break;
+			case LEN_Z:
+				arg->u = va_arg(ap, size_t);
+				break;
+			case LEN_T:
+				arg->u = va_arg(ap, ptrdiff_t);
+				break;
+			default:
+				arg->u = va_arg(ap, unsigned);
+				if (spec.len == LEN_HH)
+					arg->u = (unsigned char)arg->u;
+				else if (spec.len == LEN_H)
+					arg->u = (unsigned short)arg->u;
+				break;
+			}
+			break;
+		case 'c':
+			arg->i = va_arg(ap, int);
+			break;
+		case 's': {
+			const char *str = va_arg(ap, const char *);
+			size_t len;
+
+			if (str == NULL)
+				str = "(null)";
+			len = MIN(strlen(str),
+			    DBG_LOG_STR_BUF - slot->str_fill - 1);
+			memcpy(&slot->strs[slot->str_fill], str, len);
+			slot->strs[slot->str_fill + len] = 0;
+			arg->s = &slot->strs[slot->str_fill];
+			slot->str_fill += len + 1;
+			if (slot->str_fill == DBG_LOG_STR_BUF)
+				/* keep room for the empty string */
+				slot->str_fill--;
+			break;
+		}
+		case 'p':
+			arg->p = va_arg(ap, const void *);
+			break;
+		default:
+			arg->d = va_arg(ap, double);
+			break;
+		}
+	}
+
+	return (B_TRUE);
+}
+
+/*
+ * Renders a captured message into `buf'.
+ */
+static void
+render(const dbg_slot_t *slot, char *buf, size_t cap)
+{
+	const char *p = slot->fmt;
+	size_t fill = 0;
+	int argi = 0;
+
+	while (*p != 0 && fill + 1 < cap) {
+		const char *pct = strchr(p, '%');
+		size_t lit = (pct != NULL ? (size_t)(pct - p) : strlen(p));
+		char sub[DBG_LOG_MAX_SPEC + 32];
+		size_t sub_fill = 0;
+		dbg_spec_t spec;
+		dbg_arg_t arg;
+		int n;
+
+		lit = MIN(lit, cap - fill - 1);
+		memcpy(&buf[fill], p, lit);
+		fill += lit;
+		if (pct == NULL)
+			break;
+		VERIFY(spec_parse(pct, &spec));
+		p = spec.end;
+		if (spec.conv == '%') {
+			buf[fill++] = '%';
+			continue;
+		}
+
+		sub[sub_fill++] = '%';
+		for (size_t i = 0; i < spec.flags_len; i++) {
+			if (spec.flags[i] == '*') {
+				sub_fill += snprintf(&sub[sub_fill],
+				    sizeof (sub) - sub_fill, "%d",
+				    (int)slot->args[argi++].i);
+			} else {
+				sub[sub_fill++] = spec.flags[i];
+			}
+		}
+		if (strchr("diouxX", spec.conv) != NULL) {
+			sub[sub_fill++] = 'l';
+			sub[sub_fill++] = 'l';
+		}
+		sub[sub_fill++] = spec.conv;
+		sub[sub_fill] = 0;
+
+		arg = slot->args[argi++];
+		switch (spec.conv) {
+		case 'd':
+		case 'i':
+			n = snprintf(&buf[fill], cap - fill, sub, arg.i);
+			break;
+		case 'o':
+		case 'u':
+		case 'x':
+		case 'X':
+			n = snprintf(&buf[fill], cap - fill, sub, arg.u);
+			break;
+		case 'c':
+			n = snprintf(&buf[fill], cap - fill, sub, (int)arg.i);
+			break;
+		case 's':
+			n = snprintf(&buf[fill], cap - fill, sub, arg.s);
+			break;
+		case 'p':
+			n = snprintf(&buf[fill], cap - fill, sub, arg.p);
+			break;
+		default:
+			n = snprintf(&buf[fill], cap - fill, sub, arg.d);
+			break;
+		}
+		fill = MIN(fill + MAX(n, 0), cap - 1);
+	}
+	buf[fill] = 0;
+}
+
+static void
+async_log(const char *filename, int line, const char *fmt, va_list ap)
+{
+	unsigned pos = __atomic_load_n(&async.tail, __ATOMIC_RELAXED);
+	dbg_slot_t *slot;
+	va_list ap2;
+
+	for (;;) {
+		unsigned seq;
+
+		slot = &ring[pos & (DBG_LOG_RING_SZ - 1)];
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq == pos) {
+			if (__atomic_compare_exchange_n(&async.tail, &pos,
+			    pos + 1, B_TRUE, __ATOMIC_RELAXED,
+			    __ATOMIC_RELAXED))
+				break;
+		} else if ((int)(seq - pos) < 0) {
+			/* ring is full */
+			__atomic_add_fetch(&async.n_dropped, 1,
+			    __ATOMIC_RELAXED);
+			return;
+		} else {
+			pos = __atomic_load_n(&async.tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	slot->filename = filename;
+	slot->line = line;
+	va_copy(ap2, ap);
+	if (capture(slot, fmt, ap2)) {
+		slot->fmt = fmt;
+	} else {
+		slot->fmt = NULL;
+		log_impl_v(filename, line, fmt, ap);
+	}
+	va_end(ap2);
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+	/*
+	 * Kick the async thread early during message bursts. We don't take
+	 * the lock, so the wakeup can get lost, but then the thread simply
+	 * wakes up on its timer.
+	 */
+	if ((pos & (DBG_LOG_RING_SZ / 4 - 1)) == 0)
+		cv_signal(&async.cv);
+}
+
+/*
+ * Renders & logs all messages in the ring. Only ever called from one
+ * thread at a time (the async thread, or dbg_log_async_fini after it
+ * has exited).
+ */
+static void
+drain(void)
+{
+	char buf[DBG_LOG_LINE_LEN];
+	unsigned long long n_dropped;
+
+	for (;;) {
+		dbg_slot_t *slot = &ring[async.head & (DBG_LOG_RING_SZ - 1)];
+
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) !=
+		    async.head + 1)
+			break;
+		if (slot->fmt != NULL) {
+			render(slot, buf, sizeof (buf));
+			log_impl(slot->filename, slot->line, "%s", buf);
+			async.n_logged++;
+		}
+		__atomic_store_n(&slot->seq, async.head + DBG_LOG_RING_SZ,
+		    __ATOMIC_RELEASE);
+		async.head++;
+	}
+
+	n_dropped = __atomic_load_n(&async.n_dropped, __ATOMIC_RELAXED);
+	if (n_dropped != async.n_dropped_rep) {
+		logMsg("dbg_log: ring buffer full, dropped %llu messages",
+		    n_dropped - async.n_dropped_rep);
+		async.n_dropped_rep = n_dropped;
+	}
+}
+
+static void
+async_thread(void *unused)
+{
+	UNUSED(unused);
+
+	mutex_enter(&async.lock);
+	while (!async.shutdown) {
+		mutex_exit(&async.lock);
+		drain();
+		mutex_enter(&async.lock);
+		if (!async.shutdown) {
+			cv_timedwait(&async.cv, &async.lock,
+			    microclock() + DBG_LOG_FLUSH_INTVAL);
+		}
+	}
+	mutex_exit(&async.lock);
+}
+
+/*
+ * Switches dbg_log over to asynchronous logging (see above).
+ */
+void
+dbg_log_async_init(void)
+{
+	if (async.inited)
+		return;
+
+	if (!ring_inited) {
+		for (unsigned i = 0; i < DBG_LOG_RING_SZ; i++)
+			ring[i].seq = i;
+		ring_inited = B_TRUE;
+	}
+	async.n_logged = 0;
+	async.n_dropped = 0;
+	async.n_dropped_rep = 0;
+	async.shutdown = B_FALSE;
+	mutex_init(&async.lock);
+	cv_init(&async.cv);
+	VERIFY(thread_create(&async.thread, async_thread, NULL));
+	__atomic_store_n(&async.running, B_TRUE, __ATOMIC_RELEASE);
+	async.inited = B_TRUE;
+}
+
+/*
+ * Writes out all pending messages and switches dbg_log back to
+ * synchronous logging.
+ */
+void
+dbg_log_async_fini(void)
+{
+	if (!async.inited)
+		return;
+
+	mutex_enter(&async.lock);
+	__atomic_store_n(&async.running, B_FALSE, __ATOMIC_SEQ_CST);
+	async.shutdown = B_TRUE;
+	cv_broadcast(&async.cv);
+	mutex_exit(&async.lock);
+	thread_join(&async.thread);
+
+	/*
+	 * Producers which got past the `running' check before we cleared
+	 * it can still be queueing and signalling the cv. Any producer
+	 * coming in after this sees `running' clear and logs synchronously.
+	 */
+	mutex_enter(&async.lock);
+	while (__atomic_load_n(&async.n_busy, __ATOMIC_SEQ_CST) != 0) {
+		cv_timedwait(&async.cv, &async.lock,
+		    microclock() + DBG_LOG_FINI_POLL);
+	}
+	mutex_exit(&async.lock);
+	drain();
+
+	mutex_destroy(&async.lock);
+	cv_destroy(&async.cv);
+	logMsg("dbg_log: asynchronous logging stopped, %llu messages "
+	    "logged, %llu dropped", async.n_logged, async.n_dropped_rep);
+	async.inited = B_FALSE;
+}
+
+void
+dbg_log_impl(const char *filename, int line, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	if (__atomic_load_n(&async.running, __ATOMIC_ACQUIRE)) {
+		/* recheck, dbg_log_async_fini might have just cleared it */
+		__atomic_add_fetch(&async.n_busy, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&async.running, __ATOMIC_SEQ_CST))
+			async_log(filename, line, fmt, ap);
+		else
+			log_impl_v(filename, line, fmt, ap);
+		__atomic_sub_fetch(&async.n_busy, 1, __ATOMIC_SEQ_CST);
+	} else {
+		log_impl_v(filename, line, fmt, ap);
+	}
+	va_end(ap);
+}
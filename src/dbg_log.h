@@ -43,19 +43,94 @@ typedef struct {
 	int wav;
 	int ff_a320;
 	int adc;
+	int journal;
 } debug_config_t;
 
 extern debug_config_t xraas_debug_config;
 
+/*
+ * Compile-time maximum log level of each debug class. A dbg_log call with a
+ * level above its class' maximum is a constant-false branch, so the
+ * compiler drops it from the build, along with its format string. Levels
+ * up to the maximum are still controlled at runtime by the debug_* config
+ * keys. Set using the DBG_LOG_MAX_LEVEL (all classes) & DBG_LOG_MAX_<class>
+ * CMake options, e.g. -DDBG_LOG_MAX_LEVEL=0 -DDBG_LOG_MAX_snd=1 for a
+ * release build which only keeps level 1 messages of the "snd" class.
+ * Without these, all levels are compiled in. The qmake build used for
+ * release packages doesn't set them, so releases have all levels. Each
+ * level which is compiled in costs a couple of loads & compares per call
+ * site even when it is disabled (see tools/dbg_bench).
+ */
+#ifndef	DBG_LOG_MAX_LEVEL
+#define	DBG_LOG_MAX_LEVEL	99
+#endif
+#ifndef	DBG_LOG_MAX_altimeter
+#define	DBG_LOG_MAX_altimeter	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_ann_state
+#define	DBG_LOG_MAX_ann_state	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_apch_cfg_chk
+#define	DBG_LOG_MAX_apch_cfg_chk	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_config
+#define	DBG_LOG_MAX_config	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_dbg_gui
+#define	DBG_LOG_MAX_dbg_gui	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_flt_state
+#define	DBG_LOG_MAX_flt_state	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_fs
+#define	DBG_LOG_MAX_fs	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_nd_alert
+#define	DBG_LOG_MAX_nd_alert	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_pwr_state
+#define	DBG_LOG_MAX_pwr_state	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_rwy_key
+#define	DBG_LOG_MAX_rwy_key	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_snd
+#define	DBG_LOG_MAX_snd	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_startup
+#define	DBG_LOG_MAX_startup	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_tile
+#define	DBG_LOG_MAX_tile	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_wav
+#define	DBG_LOG_MAX_wav	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_ff_a320
+#define	DBG_LOG_MAX_ff_a320	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_adc
+#define	DBG_LOG_MAX_adc	DBG_LOG_MAX_LEVEL
+#endif
+#ifndef	DBG_LOG_MAX_journal
+#define	DBG_LOG_MAX_journal	DBG_LOG_MAX_LEVEL
+#endif
+
 #define	dbg_log(class, level, ...) \
 	do { \
-		if (xraas_debug_config.class >= level || \
-		    xraas_debug_config.all >= level) { \
-			log_impl(log_basename(__FILE__), __LINE__, \
+		if ((level) <= DBG_LOG_MAX_ ## class && \
+		    (xraas_debug_config.class >= level || \
+		    xraas_debug_config.all >= level)) { \
+			dbg_log_impl(log_basename(__FILE__), __LINE__, \
 			    "[" #class "/" #level "] " __VA_ARGS__); \
 		} \
 	} while (0)
 
+void dbg_log_impl(const char *filename, int line, const char *fmt, ...)
+    PRINTF_ATTR(3);
+void dbg_log_async_init(void);
+void dbg_log_async_fini(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,7 @@
 #include <acfutils/time.h>
 #include <acfutils/widget.h>
 
+#include "cfg_reload.h"
 #include "dbg_gui.h"
 #include "init_msg.h"
 #include "nd_alert.h"
@@ -380,9 +381,7 @@ save_config(conf_target_t target)
 	free(config);
 	free(filename);
 
-	xraas_fini();
-	xraas_init();
-	gui_update();
+	cfg_reload_now();
 
 	switch (target) {
 	case CONFIG_TARGET_LIVERY:
@@ -406,9 +405,7 @@ reset_config(conf_target_t target)
 	char *filename = config_target2filename(target);
 
 	if (remove_file(filename, B_TRUE)) {
-		xraas_fini();
-		xraas_init();
-		gui_update();
+		cfg_reload_now();
 		switch (target) {
 		case CONFIG_TARGET_LIVERY:
 			XPSetWidgetDescriptor(text_fields.status_msg,
@@ -54,6 +54,7 @@
 #define	INIT_MSG_FONT		"Aileron/Aileron-Regular.otf"
 #endif	/* !IBM */
 #define	INIT_MSG_FONT_SIZE	21
+#define	INIT_MSG_BG_ALPHA	0.67
 
 enum { MARGIN_SIZE = 10 };
 
@@ -65,9 +66,19 @@ static struct {
 	uint64_t	end;
 	int		width;
 	int		height;
+} init_msg = { NULL, 0, 0, 0, 0 };
+
+/*
+ * Long-lived texture and CPU staging buffer for the init message. These
+ * survive between messages and only ever grow, so showing a new message
+ * is a single glTexSubImage2D into the top left corner of the texture.
+ */
+static struct {
 	GLuint		texture;
+	int		w, h;
 	uint8_t		*bytes;
-} init_msg = { NULL, 0, 0, 0, 0, 0, NULL };
+	size_t		bytes_sz;
+} init_tex = { 0, 0, 0, NULL, 0 };
 
 static FT_Library ft;
 static FT_Face face;
@@ -87,9 +98,7 @@ static void
 clear_init_msg(void)
 {
 	if (init_msg.msg != NULL) {
-		glDeleteTextures(1, &init_msg.texture);
 		free(init_msg.msg);
-		free(init_msg.bytes);
 		memset(&init_msg, 0, sizeof (init_msg));
 		XPLMUnregisterDrawCallback(draw_init_msg_cb, xplm_Phase_Window,
 		    0, NULL);
@@ -105,6 +114,7 @@ static int
 draw_init_msg_cb(XPLMDrawingPhase phase, int before, void *refcon)
 {
 	int screen_x, screen_y;
+	float s1, t1;
 
 	UNUSED(phase);
 	UNUSED(before);
@@ -118,18 +128,22 @@ draw_init_msg_cb(XPLMDrawingPhase phase, int before, void *refcon)
 	XPLMGetScreenSize(&screen_x, &screen_y);
 	XPLMSetGraphicsState(1, 1, 0, 1, 1, 1, 1);
 
-	glBindTexture(GL_TEXTURE_2D, init_msg.texture);
+	glBindTexture(GL_TEXTURE_2D, init_tex.texture);
+
+	/* the message only occupies the top left part of the texture */
+	s1 = (init_msg.width + 2 * MARGIN_SIZE) / (float)init_tex.w;
+	t1 = (init_msg.height + 2 * MARGIN_SIZE) / (float)init_tex.h;
 
 	glBegin(GL_QUADS);
-	glTexCoord2f(0.0, 1.0);
+	glTexCoord2f(0.0, t1);
 	glVertex2f((screen_x - init_msg.width) / 2 - MARGIN_SIZE, 0);
 	glTexCoord2f(0.0, 0.0);
 	glVertex2f((screen_x - init_msg.width) / 2 - MARGIN_SIZE,
 	    init_msg.height + 2 * MARGIN_SIZE);
-	glTexCoord2f(1.0, 0.0);
+	glTexCoord2f(s1, 0.0);
 	glVertex2f((screen_x + init_msg.width) / 2 + MARGIN_SIZE,
 	    init_msg.height + 2 * MARGIN_SIZE);
-	glTexCoord2f(1.0, 1.0);
+	glTexCoord2f(s1, t1);
 	glVertex2f((screen_x + init_msg.width) / 2 + MARGIN_SIZE, 0);
 	glEnd();
 
@@ -178,47 +192,56 @@ log_init_msg(bool_t display, int timeout, const char *man_sect,
 	logMsg("%s", msg);
 	if (display) {
 		int tex_w, tex_h;
-		uint8_t *tex_bytes;
+		size_t sz;
 
 		clear_init_msg();
 
-		if (!get_text_block_size(msg, face, INIT_MSG_FONT_SIZE,
-		    &init_msg.width, &init_msg.height)) {
+		if (!get_text_box_size(msg, face, INIT_MSG_FONT_SIZE,
+		    MARGIN_SIZE, &tex_w, &tex_h)) {
 			free(msg);
 			return;
 		}
 
-		tex_w = init_msg.width + 2 * MARGIN_SIZE;
-		tex_h = init_msg.height + 2 * MARGIN_SIZE;
-		tex_bytes = calloc(tex_w * tex_h * 4, 1);
-
-		/* fill with a black, semi-transparent background */
-		for (int i = 0; i < tex_w * tex_h; i++)
-			tex_bytes[i * 4 + 3] = (uint8_t)(255 * 0.67);
+		init_msg.width = tex_w - 2 * MARGIN_SIZE;
+		init_msg.height = tex_h - 2 * MARGIN_SIZE;
+		sz = tex_w * tex_h * 4;
+		if (sz > init_tex.bytes_sz) {
+			free(init_tex.bytes);
+			init_tex.bytes = malloc(sz);
+			init_tex.bytes_sz = sz;
+		}
 
-		if (!render_text_block(msg, face, INIT_MSG_FONT_SIZE,
-		    MARGIN_SIZE, MARGIN_SIZE + INIT_MSG_FONT_SIZE,
-		    255, 255, 255, tex_bytes, tex_w, tex_h)) {
+		/* black, semi-transparent background */
+		if (!render_text_box(msg, face, INIT_MSG_FONT_SIZE,
+		    MARGIN_SIZE, INIT_MSG_BG_ALPHA, 255, 255, 255,
+		    init_tex.bytes, tex_w, tex_h, 0, 0, tex_w, tex_h)) {
 			free(msg);
-			free(tex_bytes);
 			return;
 		}
 
+		if (tex_w > init_tex.w || tex_h > init_tex.h) {
+			init_tex.w = MAX(init_tex.w, tex_w);
+			init_tex.h = MAX(init_tex.h, tex_h);
+			if (init_tex.texture == 0)
+				glGenTextures(1, &init_tex.texture);
+			glBindTexture(GL_TEXTURE_2D, init_tex.texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+			    GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+			    GL_NEAREST);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, init_tex.w,
+			    init_tex.h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		} else {
+			glBindTexture(GL_TEXTURE_2D, init_tex.texture);
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex_w, tex_h,
+		    GL_RGBA, GL_UNSIGNED_BYTE, init_tex.bytes);
+
 		init_msg.msg = msg;
 		init_msg.timeout = timeout;
-		init_msg.bytes = tex_bytes;
 
 		XPLMRegisterDrawCallback(draw_init_msg_cb, xplm_Phase_Window,
 		    0, NULL);
-
-		glGenTextures(1, &init_msg.texture);
-		glBindTexture(GL_TEXTURE_2D, init_msg.texture);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
-		    GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-		    GL_NEAREST);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, tex_w, tex_h, 0,
-		    GL_RGBA, GL_UNSIGNED_BYTE, init_msg.bytes);
 	} else {
 		free(msg);
 	}
@@ -279,9 +302,14 @@ init_msg_sys_fini(void)
 	if (!inited)
 		return;
 
+	text_cache_flush(face);
 	VERIFY(FT_Done_Face(face) == 0);
 	VERIFY(FT_Done_FreeType(ft) == 0);
 	clear_init_msg();
+	if (init_tex.texture != 0)
+		glDeleteTextures(1, &init_tex.texture);
+	free(init_tex.bytes);
+	memset(&init_tex, 0, sizeof (init_tex));
 	XPLMUnregisterFlightLoopCallback(init_msg_sched_cb, NULL);
 	inited = B_FALSE;
 }
@@ -0,0 +1,340 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+
+#include "airdata.h"
+#include "dbg_log.h"
+#include "xraas2.h"
+
+#include "journal.h"
+
+/*
+ * Binary event journal. When enabled (`journal = true' in X-RAAS.cfg),
+ * every decision X-RAAS makes that is visible to the crew or changes its
+ * internal state machine is appended to a journal file as a fixed-size
+ * journal_rec_t (see journal_fmt.h): annunciations, ND alerts, flight
+ * state changes, rwy_key table changes & TA/TL transitions. Records carry
+ * the sim time and, for the monitors' annunciations, the runway which the
+ * monitor was evaluating. One file is written per aircraft load, into
+ * Output/X-RAAS/journal. tools/journal_dump decodes them.
+ *
+ * Records are buffered in memory and written out when the buffer fills
+ * up or JOURNAL_FLUSH_INTVAL of sim time passes. Each sim hour gets a
+ * budget of JOURNAL_HOUR_BUDGET records (128 KiB), so even a monitor
+ * flapping on and off can't fill up the disk. Once the budget is spent,
+ * a JE_BUDGET record is written and the rest of the hour is dropped.
+ */
+
+#define	JOURNAL_DIR		"journal"
+#define	JOURNAL_BUF_RECS	128
+#define	JOURNAL_FLUSH_INTVAL	10	/* seconds of sim time */
+#define	JOURNAL_HOUR_BUDGET	4096	/* records per sim hour */
+
+static struct {
+	FILE		*fp;
+	char		*path;
+	journal_rec_t	buf[JOURNAL_BUF_RECS];
+	unsigned	n_buf;
+	double		last_flush;
+	unsigned	n_recs;
+	unsigned	n_dropped;
+
+	long		hour;
+	unsigned	n_hour;
+
+	/* runway set by journal_rwy */
+	char		rwy[JOURNAL_RWY_LEN];
+	int		n_tbls;
+	unsigned	flt_state;
+} journal;
+
+static void
+journal_close(void)
+{
+	fclose(journal.fp);
+	journal.fp = NULL;
+	free(journal.path);
+	journal.path = NULL;
+}
+
+static void
+journal_flush(void)
+{
+	if (journal.n_buf == 0)
+		return;
+	if (fwrite(journal.buf, sizeof (journal_rec_t), journal.n_buf,
+	    journal.fp) != journal.n_buf || fflush(journal.fp) != 0) {
+		logMsg("Error writing event journal %s: %s. Journal "
+		    "disabled.", journal.path, strerror(errno));
+		journal_close();
+		return;
+	}
+	journal.n_buf = 0;
+	journal.last_flush = adc->sim_time;
+}
+
+static journal_rec_t *
+journal_rec(journal_ev_t type)
+{
+	journal_rec_t *rec;
+	long hour = adc->sim_time / 3600;
+
+	if (journal.fp == NULL)
+		return (NULL);
+
+	if (type != JE_NAME && type != JE_MSG_CONT) {
+		if (hour != journal.hour) {
+			journal.hour = hour;
+			journal.n_hour = 0;
+		}
+		if (journal.n_hour > JOURNAL_HOUR_BUDGET) {
+			journal.n_dropped++;
+			return (NULL);
+		}
+		if (journal.n_hour++ == JOURNAL_HOUR_BUDGET) {
+			dbg_log(journal, 1, "hour %ld budget exhausted", hour);
+			journal.n_dropped++;
+			type = JE_BUDGET;
+		}
+	}
+
+	if (journal.n_buf == JOURNAL_BUF_RECS)
+		journal_flush();
+	if (journal.fp == NULL)
+		return (NULL);
+	rec = &journal.buf[journal.n_buf++];
+	memset(rec, 0, sizeof (*rec));
+	rec->sim_time = MAX(adc->sim_time, 0) * 1000;
+	rec->type = type;
+	if (type == JE_BUDGET) {
+		rec->value = JOURNAL_HOUR_BUDGET;
+		return (NULL);
+	}
+	journal.n_recs++;
+
+	return (rec);
+}
+
+/*
+ * Must be called once per flight loop, after all other journal calls.
+ */
+static void
+journal_flush_check(void)
+{
+	if (journal.fp != NULL && (adc->sim_time < journal.last_flush ||
+	    adc->sim_time - journal.last_flush >= JOURNAL_FLUSH_INTVAL))
+		journal_flush();
+}
+
+static void
+journal_name(int kind, int id, const char *name)
+{
+	journal_rec_t *rec = journal_rec(JE_NAME);
+
+	if (rec == NULL)
+		return;
+	rec->aux = id;
+	rec->value = kind;
+	memcpy(rec->u.name, name, strnlen(name, sizeof (rec->u.name)));
+}
+
+/*
+ * Opens a new journal file for the aircraft with ICAO code `acf_icao',
+ * if the journal is enabled in the config.
+ */
+void
+journal_init(const char *acf_icao)
+{
+	char *dir, filename[64];
+	time_t now = time(NULL);
+	journal_hdr_t hdr;
+
+	ASSERT(journal.fp == NULL);
+	memset(&journal, 0, sizeof (journal));
+	if (!xraas_state->config.journal)
+		return;
+
+#ifdef	XRAAS_IS_EMBEDDED
+	dir = mkpathname(xraas_plugindir, JOURNAL_DIR, NULL);
+#else	/* !XRAAS_IS_EMBEDDED */
+	dir = mkpathname(xraas_xpdir, "Output", "X-RAAS", JOURNAL_DIR, NULL);
+#endif	/* !XRAAS_IS_EMBEDDED */
+	if (!create_directory_recursive(dir)) {
+		free(dir);
+		return;
+	}
+	strftime(filename, sizeof (filename), "%Y-%m-%d_%H%M%S.xrj",
+	    localtime(&now));
+	journal.path = mkpathname(dir, filename, NULL);
+	free(dir);
+
+	journal.fp = fopen(journal.path, "wb");
+	if (journal.fp == NULL) {
+		logMsg("Error creating event journal %s: %s", journal.path,
+		    strerror(errno));
+		free(journal.path);
+		journal.path = NULL;
+		return;
+	}
+
+	memset(&hdr, 0, sizeof (hdr));
+	hdr.magic = JOURNAL_MAGIC;
+	hdr.version = JOURNAL_VERSION;
+	hdr.rec_size = sizeof (journal_rec_t);
+	hdr.start_time = now;
+	memcpy(hdr.acf_icao, acf_icao, strnlen(acf_icao,
+	    sizeof (hdr.acf_icao)));
+	if (fwrite(&hdr, sizeof (hdr), 1, journal.fp) != 1) {
+		logMsg("Error writing event journal %s: %s", journal.path,
+		    strerror(errno));
+		journal_close();
+		return;
+	}
+	journal.hour = -1;
+	journal.last_flush = adc->sim_time;
+
+	for (int i = 0; i < NUM_MSGS; i++)
+		journal_name(JOURNAL_NAME_PHRASE, i, snd_msg_name(i));
+
+	dbg_log(journal, 1, "journal opened: %s", journal.path);
+}
+
+void
+journal_fini(void)
+{
+	if (journal.fp == NULL)
+		return;
+	journal_flush();
+	if (journal.fp == NULL)
+		return;
+	dbg_log(journal, 1, "journal closed: %u records, %u dropped",
+	    journal.n_recs, journal.n_dropped);
+	journal_close();
+}
+
+/*
+ * Sets the runway (arpt_id/rwy_id) which the following annunciations &
+ * ND alerts pertain to. Pass NULLs to clear it.
+ */
+void
+journal_rwy(const char *arpt_id, const char *rwy_id)
+{
+	if (journal.fp == NULL)
+		return;
+	if (arpt_id == NULL)
+		journal.rwy[0] = 0;
+	else
+		snprintf(journal.rwy, sizeof (journal.rwy), "%s/%s", arpt_id,
+		    rwy_id);
+}
+
+void
+journal_msg(const msg_type_t *msgs, size_t n_msgs, msg_prio_t prio,
+    unsigned flags)
+{
+	journal_rec_t *rec = journal_rec(JE_MSG);
+
+	if (rec == NULL)
+		return;
+	n_msgs = MIN(n_msgs, UINT8_MAX);
+	rec->aux = (prio & JOURNAL_MSG_PRIO_MASK) | flags;
+	rec->n_msgs = n_msgs;
+	memcpy(rec->u.ev.rwy, journal.rwy, sizeof (rec->u.ev.rwy));
+	for (size_t i = 0; i < n_msgs; i++) {
+		if (i != 0 && i % JOURNAL_REC_MSGS == 0) {
+			if ((rec = journal_rec(JE_MSG_CONT)) == NULL)
+				return;
+		}
+		rec->u.ev.msgs[i % JOURNAL_REC_MSGS] = msgs[i];
+	}
+}
+
+void
+journal_nd_alert(int value)
+{
+	journal_rec_t *rec = journal_rec(JE_ND_ALERT);
+
+	if (rec == NULL)
+		return;
+	rec->value = value;
+	memcpy(rec->u.ev.rwy, journal.rwy, sizeof (rec->u.ev.rwy));
+}
+
+/*
+ * Records the JOURNAL_FLT_* bits of the flight state, if they changed.
+ * Called at the end of every flight loop.
+ */
+void
+journal_flt_state(unsigned flt_state)
+{
+	journal_rec_t *rec;
+
+	if (flt_state != journal.flt_state &&
+	    (rec = journal_rec(JE_FLT_STATE)) != NULL) {
+		rec->value = flt_state;
+		journal.flt_state = flt_state;
+	}
+	journal_flush_check();
+}
+
+/*
+ * Allocates a name ID for rwy_key table `name'. Returns -1 if the
+ * journal isn't enabled.
+ */
+int
+journal_tbl_name(const char *name)
+{
+	if (journal.fp == NULL)
+		return (-1);
+	journal_name(JOURNAL_NAME_TBL, journal.n_tbls, name);
+	return (journal.n_tbls++);
+}
+
+void
+journal_rwy_key(int tbl_id, const char *key, bool_t set, int value)
+{
+	journal_rec_t *rec;
+
+	if (tbl_id < 0 ||
+	    (rec = journal_rec(set ? JE_RWY_KEY_SET : JE_RWY_KEY_REMOVE)) ==
+	    NULL)
+		return;
+	rec->aux = tbl_id;
+	rec->value = value;
+	memcpy(rec->u.ev.rwy, key, strnlen(key, sizeof (rec->u.ev.rwy)));
+}
+
+void
+journal_tatl(int TATL_state, int limit, const char *arpt_id)
+{
+	journal_rec_t *rec = journal_rec(JE_TATL);
+
+	if (rec == NULL)
+		return;
+	rec->aux = TATL_state;
+	rec->value = limit;
+	memcpy(rec->u.ev.rwy, arpt_id, strnlen(arpt_id,
+	    sizeof (rec->u.ev.rwy)));
+}
@@ -0,0 +1,48 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_JOURNAL_H_
+#define	_XRAAS_JOURNAL_H_
+
+#include <stdlib.h>
+
+#include <acfutils/types.h>
+
+#include "journal_fmt.h"
+#include "snd_sys.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+void journal_init(const char *acf_icao);
+void journal_fini(void);
+
+void journal_rwy(const char *arpt_id, const char *rwy_id);
+void journal_msg(const msg_type_t *msgs, size_t n_msgs, msg_prio_t prio,
+    unsigned flags);
+void journal_nd_alert(int value);
+void journal_flt_state(unsigned flt_state);
+int journal_tbl_name(const char *name);
+void journal_rwy_key(int tbl_id, const char *key, bool_t set, int value);
+void journal_tatl(int TATL_state, int limit, const char *arpt_id);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_JOURNAL_H_ */
@@ -0,0 +1,121 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_JOURNAL_FMT_H_
+#define	_XRAAS_JOURNAL_FMT_H_
+
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * On-disk format of the event journal (see journal.c). Kept free of any
+ * plugin dependencies, so tools/journal_dump.c can use it too. A journal
+ * file is a journal_hdr_t followed by any number of journal_rec_t's. All
+ * values are stored in the host's byte order, the magic number tells the
+ * decoder if that matches its own.
+ */
+
+#define	JOURNAL_MAGIC		0x4a525258u	/* "XRRJ" */
+#define	JOURNAL_VERSION		1
+#define	JOURNAL_REC_MSGS	8
+#define	JOURNAL_NAME_LEN	20
+#define	JOURNAL_RWY_LEN		12
+
+typedef enum {
+	/*
+	 * An annunciation. aux holds the msg_prio_t & JOURNAL_MSG_* flags,
+	 * n_msgs the total number of phrases, the first JOURNAL_REC_MSGS
+	 * of which are in msgs[]. The rest follow in JE_MSG_CONT records.
+	 */
+	JE_MSG = 1,
+	JE_MSG_CONT,
+	/* An ND alert. value holds the encoded alert (see ND_alert). */
+	JE_ND_ALERT,
+	/* Flight state change. value holds the new JOURNAL_FLT_* bits. */
+	JE_FLT_STATE,
+	/* rwy_key table change. aux holds the table's name ID. */
+	JE_RWY_KEY_SET,
+	JE_RWY_KEY_REMOVE,
+	/*
+	 * Transition altitude/level crossing. aux holds the new state
+	 * (0 = altitude, 1 = flight level), value the TA or TL crossed
+	 * and rwy the airport which supplied the TA/TL.
+	 */
+	JE_TATL,
+	/*
+	 * Defines name ID aux of kind value (JOURNAL_NAME_*) as `name'.
+	 * These are written before the records using them.
+	 */
+	JE_NAME,
+	/*
+	 * The flight hour's record budget is exhausted, further records
+	 * are dropped until the next sim hour starts. value holds the
+	 * budget.
+	 */
+	JE_BUDGET
+} journal_ev_t;
+
+/*
+ * JE_MSG aux flags: the message was suppressed by a higher priority one,
+ * replaced the message which was about to play, or was spoken by TTS.
+ */
+#define	JOURNAL_MSG_PRIO_MASK	0xff
+#define	JOURNAL_MSG_SUPPRESSED	0x100
+#define	JOURNAL_MSG_MODIFIED	0x200
+#define	JOURNAL_MSG_TTS		0x400
+
+/* JE_FLT_STATE bits */
+#define	JOURNAL_FLT_DEPARTED	0x1
+#define	JOURNAL_FLT_ARRIVING	0x2
+#define	JOURNAL_FLT_LANDING	0x4
+
+/* JE_NAME kinds */
+#define	JOURNAL_NAME_TBL	0	/* rwy_key table */
+#define	JOURNAL_NAME_PHRASE	1	/* msg_type_t */
+
+typedef struct {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	rec_size;
+	int64_t		start_time;	/* UNIX time */
+	char		acf_icao[8];
+} journal_hdr_t;
+
+typedef struct {
+	uint32_t	sim_time;	/* milliseconds */
+	uint8_t		type;		/* journal_ev_t */
+	uint8_t		n_msgs;
+	uint16_t	aux;
+	int32_t		value;
+	union {
+		struct {
+			/* "ARPT/RWY" of the triggering runway, or "" */
+			char	rwy[JOURNAL_RWY_LEN];
+			uint8_t	msgs[JOURNAL_REC_MSGS];
+		} ev;
+		char	name[JOURNAL_NAME_LEN];
+	} u;
+} journal_rec_t;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_JOURNAL_FMT_H_ */
@@ -15,6 +15,7 @@
  * Copyright 2017 Saso Kiselkov. All rights reserved.
  */
 
+#include <stddef.h>
 #include <string.h>
 
 #if	IBM
@@ -31,14 +32,20 @@
 #include <XPLMPlanes.h>
 #include <XPLMProcessing.h>
 
+#include <acfutils/airportdb.h>
 #include <acfutils/assert.h>
+#include <acfutils/avl.h>
 #include <acfutils/dr.h>
 #include <acfutils/helpers.h>
 #include <acfutils/perf.h>
 #include <acfutils/time.h>
 
+#include "acf_meta.h"
 #include "dbg_log.h"
 #include "init_msg.h"
+#include "journal.h"
+#include "nd_overlays.h"
+#include "stats.h"
 #include "text_rendering.h"
 #include "../api/c/XRAAS_ND_msg_decode.h"
 
@@ -47,7 +54,12 @@
 #define	DR_NAME			"xraas/ND_alert"
 #define	OVERLAY_DIS_DR		"xraas/ND_alert_overlay_disabled"
 #define	AMBER_FLAG		0x40
+#define	RWY_LEN_MASK		(0xff << 16)
 #define	ND_SCHED_INTVAL		1.0
+#define	ALERT_MARGIN		10
+#define	ATLAS_WIDTH		1024
+#define	NUM_RWY_IDS		38	/* 0 = taxiway, 37 = RWYS */
+#define	NUM_RWY_SUFFIXES	4	/* none, R, L, C */
 
 #define	NUM_DEBUG_PANEL_ROWS	32
 #define	NUM_DEBUG_PANEL_COLS	32
@@ -57,11 +69,23 @@
 #define	DEBUG_PANEL_PHASE	xplm_Phase_Gauges
 #define	DEBUG_PANEL_PHASE_FLAG	0
 #define	DEBUG_PANEL_FONT_SIZE	24
-typedef struct {
-	uint8_t	tex[DEBUG_PANEL_SIZE * DEBUG_PANEL_SIZE * 4];
-} debug_panel_t;
-static GLuint		*debug_textures = NULL;
-static debug_panel_t	*debug_panels = NULL;
+#define	DEBUG_ATLAS_SIZE	(NUM_DEBUG_PANEL_COLS * DEBUG_PANEL_SIZE)
+#define	DEBUG_ATLAS_BYTES	\
+	(DEBUG_ATLAS_SIZE * DEBUG_ATLAS_SIZE * 4)
+
+/*
+ * The debug panel labels all live in a single atlas texture and the
+ * panel outlines & label quads are kept in persistent vertex arrays, so
+ * drawing all of the panels takes just two draw calls.
+ */
+static struct {
+	GLuint		texture;
+	GLfloat		line_vtx[NUM_DEBUG_PANELS * 8 * 2];
+	GLfloat		quad_vtx[NUM_DEBUG_PANELS * 4 * 2];
+	GLfloat		quad_tex[NUM_DEBUG_PANELS * 4 * 2];
+	int		n_line_vtx;
+	int		n_quad_vtx;
+} *debug_panels = NULL;
 
 const char *ND_alert_overlay_default_font = "ShareTechMono" DIRSEP_S
 	"ShareTechMono-Regular.ttf";
@@ -80,11 +104,63 @@ static dr_t		dr_pitch, dr_roll, dr_hdg;
 static struct {
 	FT_Library	ft;
 	FT_Face		face;
+
+	/*
+	 * Long-lived texture and CPU staging buffer for alerts which
+	 * aren't in the atlas. Both only ever grow. Alerts are rendered
+	 * into the staging buffer and uploaded into the top left corner
+	 * of the texture using glTexSubImage2D.
+	 */
 	GLuint		texture;
+	int		tex_w, tex_h;
+	uint8_t		*buf;
+	size_t		buf_sz;
+
+	/*
+	 * The alert being displayed: either a sub-rectangle of
+	 * atlas.texture, or of overlay.texture. 0 if nothing is shown.
+	 */
+	GLuint		shown_tex;
 	int		width;
 	int		height;
-	uint8_t		*buf;
-} overlay = { NULL, NULL, 0, 0, 0, NULL };
+	float		s0, t0, s1, t1;
+} overlay = { NULL, NULL, 0, 0, 0, NULL, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+/*
+ * The set of possible ND alert messages is small, so rather than
+ * rendering a texture on every ND_alert() call, we pre-render all alert
+ * messages (in both colors) which can be raised for the runways of the
+ * airports around us into a single atlas texture. Raising an alert then
+ * merely selects the alert's rectangle inside of the atlas. The atlas
+ * is rebuilt from ND_alerts_prerender() whenever the set of runway IDs
+ * around us changes. Alerts which aren't in the atlas (those with a
+ * runway length field) are still rendered on demand into overlay.texture.
+ */
+typedef struct {
+	int		value;		/* ND alert dataref value */
+	int		x, y, w, h;	/* pixel rectangle in the atlas */
+	avl_node_t	node;
+} atlas_entry_t;
+
+static struct {
+	GLuint		texture;
+	int		width;
+	int		height;
+	avl_tree_t	entries;
+	bool_t		rwys[NUM_RWY_IDS][NUM_RWY_SUFFIXES];
+} atlas;
+
+static int
+atlas_entry_compar(const void *a, const void *b)
+{
+	const atlas_entry_t *ea = a, *eb = b;
+
+	if (ea->value < eb->value)
+		return (-1);
+	if (ea->value > eb->value)
+		return (1);
+	return (0);
+}
 
 typedef struct {
 	unsigned	x, y;
@@ -104,58 +180,81 @@ typedef struct {
 
 static acf_ND_overlay_info_t *overlay_info = NULL;
 
+/*
+ * Vertex & texture coordinates of the alert quads on all of our NDs.
+ * These only change when the displayed alert (or screen size) changes,
+ * so the draw callback can submit all NDs in a single draw call.
+ */
+static struct {
+	GLfloat		*vtx;		/* 8 floats per ND */
+	GLfloat		*tex;		/* 8 floats per ND */
+	int		n_vtx;
+	bool_t		dirty;
+	int		screen_x, screen_y;
+} overlay_quads = { NULL, NULL, 0, B_TRUE, 0, 0 };
+
+/*
+ * Writes a quad spanning (x1, y1) - (x2, y2) into a vertex array at
+ * `vtx' and its texture coordinates into `tex'. Textures are stored
+ * top row first, so the bottom of the quad maps to `t1'.
+ */
+static void
+put_quad(GLfloat *vtx, GLfloat *tex, float x1, float y1, float x2, float y2,
+    float s0, float t0, float s1, float t1)
+{
+	const GLfloat v[8] = { x1, y1, x1, y2, x2, y2, x2, y1 };
+	const GLfloat t[8] = { s0, t1, s0, t0, s1, t0, s1, t1 };
+
+	memcpy(vtx, v, sizeof (v));
+	memcpy(tex, t, sizeof (t));
+}
+
 static int
 debug_panel_draw_cb(XPLMDrawingPhase phase, int before, void *refcon)
 {
-	enum {
-	    SPACE_WIDTH = 2048,
-	    SPACE_HEIGHT = 2048,
-	    CELL_WIDTH = (SPACE_WIDTH / NUM_DEBUG_PANEL_COLS),
-	    CELL_HEIGHT = (SPACE_HEIGHT / NUM_DEBUG_PANEL_ROWS)
-	};
-
 	UNUSED(phase);
 	UNUSED(before);
 	UNUSED(refcon);
 
-	XPLMSetGraphicsState(0, 0, 0, 0, 1, 0, 0);
+	glEnableClientState(GL_VERTEX_ARRAY);
 
+	XPLMSetGraphicsState(0, 0, 0, 0, 1, 0, 0);
 	glColor3f(1, 1, 1);
 	glLineWidth(1);
-
-	glBegin(GL_LINES);
-	for (int x = 0; x < NUM_DEBUG_PANEL_COLS; x ++) {
-		for (int y = 0; y < NUM_DEBUG_PANEL_ROWS; y++) {
-			float cx = x * CELL_WIDTH + CELL_WIDTH / 2 -
-			    DEBUG_PANEL_SIZE / 2;
-			float cy = y * CELL_HEIGHT + CELL_HEIGHT / 2 -
-			    DEBUG_PANEL_SIZE / 2;
-
-			if (cx > SPACE_WIDTH || cy > SPACE_HEIGHT)
-				continue;
-			glVertex2f(cx - DEBUG_PANEL_SIZE / 2,
-			    cy - DEBUG_PANEL_SIZE / 2);
-			glVertex2f(cx - DEBUG_PANEL_SIZE / 2,
-			    cy + DEBUG_PANEL_SIZE / 2);
-			glVertex2f(cx - DEBUG_PANEL_SIZE / 2,
-			    cy + DEBUG_PANEL_SIZE / 2);
-			glVertex2f(cx + DEBUG_PANEL_SIZE / 2,
-			    cy + DEBUG_PANEL_SIZE / 2);
-			glVertex2f(cx + DEBUG_PANEL_SIZE / 2,
-			    cy + DEBUG_PANEL_SIZE / 2);
-			glVertex2f(cx + DEBUG_PANEL_SIZE / 2,
-			    cy - DEBUG_PANEL_SIZE / 2);
-			glVertex2f(cx + DEBUG_PANEL_SIZE / 2,
-			    cy - DEBUG_PANEL_SIZE / 2);
-			glVertex2f(cx - DEBUG_PANEL_SIZE / 2,
-			    cy - DEBUG_PANEL_SIZE / 2);
-		}
-	}
-	glEnd();
+	glVertexPointer(2, GL_FLOAT, 0, debug_panels->line_vtx);
+	glDrawArrays(GL_LINES, 0, debug_panels->n_line_vtx);
 
 	XPLMSetGraphicsState(0, 1, 0, 0, 1, 0, 0);
 	glDepthFunc(GL_LEQUAL);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBindTexture(GL_TEXTURE_2D, debug_panels->texture);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, debug_panels->quad_vtx);
+	glTexCoordPointer(2, GL_FLOAT, 0, debug_panels->quad_tex);
+	glDrawArrays(GL_QUADS, 0, debug_panels->n_quad_vtx);
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	return (0);
+}
+
+/*
+ * Builds the debug panel outline & label quad vertex arrays.
+ */
+static void
+debug_panel_build_vtx(void)
+{
+	enum {
+	    SPACE_WIDTH = 2048,
+	    SPACE_HEIGHT = 2048,
+	    CELL_WIDTH = (SPACE_WIDTH / NUM_DEBUG_PANEL_COLS),
+	    CELL_HEIGHT = (SPACE_HEIGHT / NUM_DEBUG_PANEL_ROWS)
+	};
+	GLfloat *lv = debug_panels->line_vtx;
+
+	debug_panels->n_line_vtx = 0;
+	debug_panels->n_quad_vtx = 0;
 
 	for (int x = 0; x < NUM_DEBUG_PANEL_COLS; x ++) {
 		for (int y = 0; y < NUM_DEBUG_PANEL_ROWS; y++) {
@@ -163,79 +262,142 @@ debug_panel_draw_cb(XPLMDrawingPhase phase, int before, void *refcon)
 			    DEBUG_PANEL_SIZE / 2;
 			float cy = y * CELL_HEIGHT + CELL_HEIGHT / 2 -
 			    DEBUG_PANEL_SIZE / 2;
+			float x1 = cx - DEBUG_PANEL_SIZE / 2;
+			float x2 = cx + DEBUG_PANEL_SIZE / 2;
+			float y1 = cy - DEBUG_PANEL_SIZE / 2;
+			float y2 = cy + DEBUG_PANEL_SIZE / 2;
+			/* panel (x, y) shows the label of panel index `i' */
+			int i = x * NUM_DEBUG_PANEL_COLS + y;
+			float s0 = (i % NUM_DEBUG_PANEL_COLS) /
+			    (float)NUM_DEBUG_PANEL_COLS;
+			float t0 = (i / NUM_DEBUG_PANEL_COLS) /
+			    (float)NUM_DEBUG_PANEL_ROWS;
+			int nq = debug_panels->n_quad_vtx;
+			const GLfloat outline[16] = {
+			    x1, y1, x1, y2,	x1, y2, x2, y2,
+			    x2, y2, x2, y1,	x2, y1, x1, y1
+			};
 
 			if (cx > SPACE_WIDTH || cy > SPACE_HEIGHT)
 				continue;
 
-			glBindTexture(GL_TEXTURE_2D,
-			    debug_textures[x * NUM_DEBUG_PANEL_COLS + y]);
-			glBegin(GL_QUADS);
-			glTexCoord2f(0.0, 1.0);
-			glVertex2f(cx - DEBUG_PANEL_SIZE / 2,
-			    cy - DEBUG_PANEL_SIZE / 2);
-			glTexCoord2f(0.0, 0.0);
-			glVertex2f(cx - DEBUG_PANEL_SIZE / 2,
-			    cy + DEBUG_PANEL_SIZE / 2);
-			glTexCoord2f(1.0, 0.0);
-			glVertex2f(cx + DEBUG_PANEL_SIZE / 2,
-			    cy + DEBUG_PANEL_SIZE / 2);
-			glTexCoord2f(1.0, 1.0);
-			glVertex2f(cx + DEBUG_PANEL_SIZE / 2,
-			    cy - DEBUG_PANEL_SIZE / 2);
-			glEnd();
+			memcpy(&lv[debug_panels->n_line_vtx * 2], outline,
+			    sizeof (outline));
+			debug_panels->n_line_vtx += 8;
+
+			put_quad(&debug_panels->quad_vtx[nq * 2],
+			    &debug_panels->quad_tex[nq * 2], x1, y1, x2, y2,
+			    s0, t0, s0 + 1.0 / NUM_DEBUG_PANEL_COLS,
+			    t0 + 1.0 / NUM_DEBUG_PANEL_ROWS);
+			debug_panels->n_quad_vtx += 4;
 		}
 	}
+}
 
-	return (0);
+/*
+ * Recomputes the alert quads for all NDs (or the screen overlay).
+ */
+static void
+overlay_build_quads(void)
+{
+	int n = 0;
+
+	if (overlay_info != NULL) {
+		for (ND_coords_t *nd = list_head(&overlay_info->NDs);
+		    nd != NULL; nd = list_next(&overlay_info->NDs, nd))
+			n++;
+	} else {
+		n = 1;
+	}
+	if (overlay_quads.n_vtx != n * 4) {
+		free(overlay_quads.vtx);
+		free(overlay_quads.tex);
+		overlay_quads.vtx = calloc(n * 8, sizeof (GLfloat));
+		overlay_quads.tex = calloc(n * 8, sizeof (GLfloat));
+		overlay_quads.n_vtx = n * 4;
+	}
+
+#define	ND_QUAD(i, x, y, w, h, hoff, voff) \
+	put_quad(&overlay_quads.vtx[(i) * 8], &overlay_quads.tex[(i) * 8], \
+	    (x) + ((w) - overlay.width) * (hoff), \
+	    (y) + (h) * (voff) - overlay.height, \
+	    (x) + ((w) + overlay.width) * (hoff), (y) + (h) * (voff), \
+	    overlay.s0, overlay.t0, overlay.s1, overlay.t1)
+	if (overlay_info != NULL) {
+		int i = 0;
+		for (ND_coords_t *nd = list_head(&overlay_info->NDs);
+		    nd != NULL; nd = list_next(&overlay_info->NDs, nd), i++) {
+			ND_QUAD(i, nd->x, nd->y, nd->w, nd->h, nd->hoff,
+			    nd->voff);
+		}
+	} else {
+		ND_QUAD(0, 0, 0, overlay_quads.screen_x,
+		    overlay_quads.screen_y, 0.5, 0.98);
+	}
+#undef	ND_QUAD
+
+	overlay_quads.dirty = B_FALSE;
 }
 
 static void
-nd_alert_draw_at(int x, int y, int w, int h, double hoff, double voff)
+nd_alert_draw(void)
 {
+	if (overlay.shown_tex == 0 || !xraas_is_on() ||
+	    view_is_external())
+		return;
+
+	if (overlay_info == NULL) {
+		int screen_x, screen_y;
+		XPLMGetScreenSize(&screen_x, &screen_y);
+		if (screen_x != overlay_quads.screen_x ||
+		    screen_y != overlay_quads.screen_y) {
+			overlay_quads.screen_x = screen_x;
+			overlay_quads.screen_y = screen_y;
+			overlay_quads.dirty = B_TRUE;
+		}
+	}
+	if (overlay_quads.dirty)
+		overlay_build_quads();
+
 	/* only disable lighting, everything else is on */
 	XPLMSetGraphicsState(1, 1, 0, 1, 1, 1, 1);
-
-	glBegin(GL_QUADS);
-	glTexCoord2f(0.0, 1.0);
-	glVertex2f(x + (w - overlay.width) * hoff,
-	    y + (h * voff) - overlay.height);
-	glTexCoord2f(0.0, 0.0);
-	glVertex2f(x + (w - overlay.width) * hoff, y + h * voff);
-	glTexCoord2f(1.0, 0.0);
-	glVertex2f(x + (w + overlay.width) * hoff, y + h * voff);
-	glTexCoord2f(1.0, 1.0);
-	glVertex2f(x + (w + overlay.width) * hoff,
-	    y + h * voff - overlay.height);
-	glEnd();
+	glBindTexture(GL_TEXTURE_2D, overlay.shown_tex);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, overlay_quads.vtx);
+	glTexCoordPointer(2, GL_FLOAT, 0, overlay_quads.tex);
+	glDrawArrays(GL_QUADS, 0, overlay_quads.n_vtx);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 }
 
 static int
 nd_alert_draw_cb(XPLMDrawingPhase phase, int before, void *refcon)
 {
+	uint64_t t = stats_start();
+
 	UNUSED(phase);
 	UNUSED(before);
 	UNUSED(refcon);
 
-	if (overlay.buf == NULL || !xraas_is_on() || view_is_external())
-		return (1);
-
-	glBindTexture(GL_TEXTURE_2D, overlay.texture);
-
-	if (overlay_info != NULL) {
-		for (ND_coords_t *nd = list_head(&overlay_info->NDs);
-		    nd != NULL; nd = list_next(&overlay_info->NDs, nd)) {
-			nd_alert_draw_at(nd->x, nd->y, nd->w, nd->h,
-			    nd->hoff, nd->voff);
-		}
-	} else {
-		int screen_x, screen_y;
-		XPLMGetScreenSize(&screen_x, &screen_y);
-		nd_alert_draw_at(0, 0, screen_x, screen_y, 0.5, 0.98);
-	}
+	nd_alert_draw();
+	stats_end(STATS_ND_ALERT_DRAW, t);
 
 	return (1);
 }
 
+/*
+ * Stops displaying the current alert (if any). The overlay texture and
+ * staging buffer are kept around for the next alert.
+ */
+static void
+overlay_clear(void)
+{
+	overlay.shown_tex = 0;
+	overlay_quads.dirty = B_TRUE;
+}
+
 static float
 alert_sched_cb(float elapsed_since_last_call, float elapsed_since_last_floop,
     int counter, void *refcon)
@@ -247,55 +409,66 @@ alert_sched_cb(float elapsed_since_last_call, float elapsed_since_last_floop,
 
 	if (alert_status != 0 && (microclock() - alert_start_time >
 	    (unsigned)SEC2USEC(xraas_state->config.nd_alert_timeout))) {
-		if (overlay.buf != NULL) {
-			glDeleteTextures(1, &overlay.texture);
-			free(overlay.buf);
-			overlay.buf = NULL;
-		}
+		overlay_clear();
 		alert_status = 0;
 	}
 
 	return (ND_SCHED_INTVAL);
 }
 
-static void
-ND_integ_debug_init(void)
+/*
+ * Renders the labels of all debug panels into one RGBA atlas. Label of
+ * panel `i' lands in atlas cell (i % NUM_DEBUG_PANEL_COLS,
+ * i / NUM_DEBUG_PANEL_COLS).
+ */
+static uint8_t *
+debug_atlas_render(void)
 {
+	uint8_t *buf = calloc(DEBUG_ATLAS_BYTES, 1);
 	int w, h;
 
-	dbg_log(nd_alert, 1, "ND_integ_debug_init %dx%d (%dx%d)",
-	    NUM_DEBUG_PANEL_COLS, NUM_DEBUG_PANEL_ROWS, DEBUG_PANEL_SIZE,
-	    DEBUG_PANEL_SIZE);
-
-	ASSERT(debug_textures == NULL);
-	ASSERT(debug_panels == NULL);
-
 	get_text_block_size("0000", overlay.face, DEBUG_PANEL_FONT_SIZE,
 	    &w, &h);
-	debug_textures = calloc(NUM_DEBUG_PANELS, sizeof (*debug_textures));
-	debug_panels = calloc(NUM_DEBUG_PANELS, sizeof (*debug_panels));
 	for (int i = 0; i < NUM_DEBUG_PANELS; i++) {
 		char text[8];
+		int x = (i % NUM_DEBUG_PANEL_COLS) * DEBUG_PANEL_SIZE +
+		    (DEBUG_PANEL_SIZE - w) / 2;
+		int y = (i / NUM_DEBUG_PANEL_COLS) * DEBUG_PANEL_SIZE +
+		    (DEBUG_PANEL_SIZE + h) / 2;
+
 		snprintf(text, sizeof (text), "%02x%02x",
 		    i / NUM_DEBUG_PANEL_COLS, i % NUM_DEBUG_PANEL_COLS);
-		int x = (DEBUG_PANEL_SIZE - w) / 2;
-		int y = (DEBUG_PANEL_SIZE + h) / 2;
 		VERIFY(render_text_block(text, overlay.face,
-		    DEBUG_PANEL_FONT_SIZE,  x, y, 255, 255, 255,
-		    debug_panels[i].tex, DEBUG_PANEL_SIZE, DEBUG_PANEL_SIZE));
-	}
-	glGenTextures(NUM_DEBUG_PANELS, debug_textures);
-	for (int i = 0; i < NUM_DEBUG_PANELS; i++) {
-		glBindTexture(GL_TEXTURE_2D, debug_textures[i]);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
-		    GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-		    GL_NEAREST);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, DEBUG_PANEL_SIZE,
-		    DEBUG_PANEL_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-		    debug_panels[i].tex);
+		    DEBUG_PANEL_FONT_SIZE, x, y, 255, 255, 255, buf,
+		    DEBUG_ATLAS_SIZE, DEBUG_ATLAS_SIZE));
 	}
 
+	return (buf);
+}
+
+static void
+ND_integ_debug_init(void)
+{
+	uint8_t *buf;
+
+	dbg_log(nd_alert, 1, "ND_integ_debug_init %dx%d (%dx%d)",
+	    NUM_DEBUG_PANEL_COLS, NUM_DEBUG_PANEL_ROWS, DEBUG_PANEL_SIZE,
+	    DEBUG_PANEL_SIZE);
+
+	ASSERT(debug_panels == NULL);
+
+	buf = debug_atlas_render();
+
+	debug_panels = calloc(1, sizeof (*debug_panels));
+	glGenTextures(1, &debug_panels->texture);
+	glBindTexture(GL_TEXTURE_2D, debug_panels->texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, DEBUG_ATLAS_SIZE,
+	    DEBUG_ATLAS_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, buf);
+	free(buf);
+	debug_panel_build_vtx();
+
 	XPLMRegisterDrawCallback(debug_panel_draw_cb, DEBUG_PANEL_PHASE,
 	    DEBUG_PANEL_PHASE_FLAG, NULL);
 }
@@ -309,9 +482,10 @@ ND_integ_debug_init(void)
  *
  * This function attempts to match the currently loaded aircraft with our
  * ND position configuration file in data/ND_overlays.cfg. The file is
- * parsed here. It consists of a set of whitespace-separated keywords with
- * optional arguments. String arguments allow for "%XY" escape sequences.
- * See unescape_percent in helpers.c.
+ * parsed and indexed by nd_overlays.c. It consists of a set of
+ * whitespace-separated keywords with optional arguments. String
+ * arguments allow for "%XY" escape sequences. See unescape_percent in
+ * helpers.c.
  * A typical config file will consists from one or more blocks like this:
  *	icao	ABCD
  *	studio	Foo%20Bar%20Studios
@@ -355,18 +529,14 @@ ND_integ_debug_init(void)
 static void
 ND_integ_init(void)
 {
-	char		buf[128] = { 0 };
-	bool_t		debug_on = B_FALSE;
-	FILE		*fp;
-	char		*filename;
-	ND_coords_t	*nd = NULL;
-	char		my_icao[8] = { 0 }, my_author[256] = { 0 };
-	char		my_studio[256] = { 0 }, my_acf[256] = { 0 };
-	char		acf_path[512] = { 0 };
-	char		*line = NULL;
-	size_t		line_len = 0;
-	dr_t		icao_dr, auth_dr;
-	bool_t		skip = B_FALSE;
+	bool_t			debug_on;
+	const ND_overlay_t	*ovl;
+	char			my_icao[8] = { 0 }, my_author[256] = { 0 };
+	char			my_acf[256] = { 0 };
+	char			acf_path[512] = { 0 };
+	acf_meta_t		meta = { 0 };
+	bool_t			have_meta = B_FALSE;
+	dr_t			icao_dr, auth_dr;
 
 	fdr_find(&icao_dr, "sim/aircraft/view/acf_ICAO");
 	fdr_find(&auth_dr, "sim/aircraft/view/acf_author");
@@ -375,186 +545,48 @@ ND_integ_init(void)
 	dr_gets(&icao_dr, my_icao, sizeof (my_icao));
 	dr_gets(&auth_dr, my_author, sizeof (my_author));
 
-	/*
-	 * Unfortunately the studio isn't available via datarefs, so parse
-	 * our acf file instead.
-	 */
-	fp = fopen(acf_path, "r");
-	if (fp == NULL)
-		return;
-	while (getline(&line, &line_len, fp) > 0) {
-		if (strstr(line, "P acf/_studio ") == line) {
-			strip_space(line);
-			strlcpy(my_studio, &line[14], sizeof (my_studio));
-			break;
+	dbg_log(nd_alert, 3, "attempting ND_overlays.cfg match, %s/%s/%s",
+	    my_icao, my_acf, my_author);
+
+	for (ovl = ND_overlays_find(my_icao, &debug_on); ovl != NULL;
+	    ovl = ovl->next) {
+		/*
+		 * Unfortunately the studio isn't available via datarefs, so
+		 * grab it from our acf file instead. Only do so if we have a
+		 * block for our ICAO type which actually filters on it.
+		 */
+		if (ovl->studio != NULL && !have_meta) {
+			(void) acf_meta_get(acf_path, &meta);
+			have_meta = B_TRUE;
 		}
+		if (ND_overlay_match(ovl, meta.studio, my_author, my_acf))
+			break;
 	}
-	fclose(fp);
-
-	dbg_log(nd_alert, 3, "attempting ND_overlays.cfg match, %s/%s/%s/%s",
-	    my_icao, my_acf, my_studio, my_author);
 
-	filename = mkpathname(xraas_plugindir, "data", "ND_overlays.cfg", NULL);
-	fp = fopen(filename, "r");
-	free(filename);
-	if (fp == NULL)
-		return;
-
-#define	FILTER_PARAM(param) \
-	do { \
-		char param[256]; \
-		int res; \
-		if (overlay_info == NULL) \
-			continue; \
-		if (fscanf(fp, "%255s", param) != 1) { \
-			logMsg("Error parsing ND_overlays.cfg: expected " \
-			    "string following \"" #param "\"."); \
-			goto errout; \
-		} \
-		unescape_percent(param); \
-		res = strcmp(param, my_ ## param); \
-		dbg_log(nd_alert, 3, #param "(\"%s\") %s my_" #param, \
-		    param, (res == 0 ? "==" : "!=")); \
-		if (res != 0) { \
-			list_destroy(&overlay_info->NDs); \
-			free(overlay_info); \
-			overlay_info = NULL; \
-			skip = B_TRUE; \
-		} \
-	} while (0)
-
-#define	PARSE_ND_PARAM(param, fmt, typename) \
-	do { \
-		if (overlay_info == NULL) \
-			continue; \
-		if (nd == NULL) { \
-			logMsg("Error parsing ND_overlays.cfg: " \
-			    "\"" #param "\" must be preceded by \"nd\"."); \
-			goto errout; \
-		} \
-		if (fscanf(fp, fmt, &nd->param) != 1) { \
-			logMsg("Error parsing ND_overlays.cfg: expected " \
-			    typename " following \"" #param "\"."); \
-			goto errout; \
-		} \
-		dbg_log(nd_alert, 3, "ND->" #param " = " fmt, nd->param); \
-	} while (0)
-
-	while (!feof(fp) && fscanf(fp, "%127s", buf) == 1) {
-		if (buf[0] == '#') {
-			while (fgetc(fp) != '\n' && !feof(fp))
-				;
-			continue;
-		}
-		if (!skip)
-			dbg_log(nd_alert, 4, "found keyword \"%s\"", buf);
-		if (strcmp(buf, "debug") == 0) {
-			debug_on = B_TRUE;
-			dbg_log(nd_alert, 3, "ND debug on");
-		} else if (strcmp(buf, "icao") == 0) {
-			char icao[8];
-			int res;
-			if (overlay_info != NULL) {
-				/* We're done parsing the entry we wanted */
-				break;
-			}
-			if (fscanf(fp, "%7s", icao) != 1) {
-				logMsg("Error parsing ND_overlays.cfg: "
-				    "expected string following \"icao\".");
-				goto errout;
-			}
-			unescape_percent(icao);
-			res = strcmp(icao, my_icao);
-			dbg_log(nd_alert, 3, "icao(\"%s\") %s my_icao", icao,
-			    (res == 0 ? "==" : "!="));
-			if (res == 0) {
-				overlay_info = calloc(1,
-				    sizeof (*overlay_info));
-				list_create(&overlay_info->NDs,
-				    sizeof (ND_coords_t),
-				    offsetof(ND_coords_t, node));
-				overlay_info->bg_alpha = 0.5;
-				skip = B_FALSE;
-			} else {
-				skip = B_TRUE;
-			}
-		} else if (strcmp(buf, "studio") == 0) {
-			FILTER_PARAM(studio);
-		} else if (strcmp(buf, "acf") == 0) {
-			FILTER_PARAM(acf);
-		} else if (strcmp(buf, "author") == 0) {
-			FILTER_PARAM(author);
-		} else if (strcmp(buf, "fontsz") == 0) {
-			if (overlay_info == NULL)
-				continue;
-			if (fscanf(fp, "%d", &overlay_info->font_sz) != 1) {
-				logMsg("Error parsing ND_overlays.cfg: "
-				    "expected integer following \"fontsz\".");
-				goto errout;
-			}
-			dbg_log(nd_alert, 3, "fontsz: %d",
-			    overlay_info->font_sz);
-		} else if (strcmp(buf, "bgalpha") == 0) {
-			if (overlay_info == NULL)
-				continue;
-			if (fscanf(fp, "%lf", &overlay_info->bg_alpha) != 1) {
-				logMsg("Error parsing ND_overlays.cfg: "
-				    "expected float following \"bgalpha\".");
-				goto errout;
-			}
-			dbg_log(nd_alert, 3, "bgalpha: %.3f",
-			    overlay_info->bg_alpha);
-		} else if (strcmp(buf, "nd") == 0) {
-			if (overlay_info == NULL)
-				continue;
-			nd = calloc(1, sizeof (*nd));
+	if (ovl != NULL) {
+		dbg_log(nd_alert, 1, "ND_integ_init: match %s/%s/%s/%s",
+		    my_icao, my_acf, meta.studio, my_author);
+		overlay_info = calloc(1, sizeof (*overlay_info));
+		list_create(&overlay_info->NDs, sizeof (ND_coords_t),
+		    offsetof(ND_coords_t, node));
+		overlay_info->font_sz = ovl->font_sz;
+		overlay_info->bg_alpha = ovl->bg_alpha;
+		for (size_t i = 0; i < ovl->n_nds; i++) {
+			ND_coords_t *nd = calloc(1, sizeof (*nd));
+
+			nd->x = ovl->nds[i].x;
+			nd->y = ovl->nds[i].y;
+			nd->w = ovl->nds[i].w;
+			nd->h = ovl->nds[i].h;
+			nd->hoff = ovl->nds[i].hoff;
+			nd->voff = ovl->nds[i].voff;
 			list_insert_tail(&overlay_info->NDs, nd);
-			nd->hoff = 0.5;
-			nd->voff = 0.5;
-			dbg_log(nd_alert, 3, "new ND");
-		} else if (strcmp(buf, "x") == 0) {
-			PARSE_ND_PARAM(x, "%d", "integer");
-		} else if (strcmp(buf, "y") == 0) {
-			PARSE_ND_PARAM(y, "%d", "integer");
-		} else if (strcmp(buf, "w") == 0) {
-			PARSE_ND_PARAM(w, "%d", "integer");
-		} else if (strcmp(buf, "h") == 0) {
-			PARSE_ND_PARAM(h, "%d", "integer");
-		} else if (strcmp(buf, "hoff") == 0) {
-			PARSE_ND_PARAM(hoff, "%lf", "float");
-		} else if (strcmp(buf, "voff") == 0) {
-			PARSE_ND_PARAM(voff, "%lf", "float");
-		} else if (!skip) {
-			logMsg("Error parsing ND_overlays.cfg: "
-			    "unknown keyword \"%s\".", buf);
-			goto errout;
 		}
-	}
-#undef	FILTER_PARAM
-#undef	PARSE_ND_PARAM
-
-	if (overlay_info != NULL) {
-		dbg_log(nd_alert, 1, "ND_integ_init: match %s/%s/%s/%s",
-		    my_icao, my_acf, my_studio, my_author);
+		debug_on = ovl->debug;
 	}
 
 	if (debug_on)
 		ND_integ_debug_init();
-
-	fclose(fp);
-	return;
-
-errout:
-	if (overlay_info != NULL) {
-		ND_coords_t *nd;
-		while ((nd = list_head(&overlay_info->NDs)) != NULL) {
-			list_remove_head(&overlay_info->NDs);
-			free(nd);
-		}
-		free(overlay_info);
-		overlay_info = NULL;
-	}
-	fclose(fp);
 }
 
 bool_t
@@ -587,6 +619,10 @@ ND_alerts_init(void)
 
 	ND_integ_init();
 
+	memset(&atlas, 0, sizeof (atlas));
+	avl_create(&atlas.entries, atlas_entry_compar,
+	    sizeof (atlas_entry_t), offsetof(atlas_entry_t, node));
+
 	dr_create_i(&dr, &alert_status, B_FALSE, DR_NAME);
 	dr_create_i(&dr_overlay, &alert_overlay_dis, B_TRUE, OVERLAY_DIS_DR);
 	XPLMRegisterFlightLoopCallback(alert_sched_cb, ND_SCHED_INTVAL, NULL);
@@ -607,51 +643,46 @@ ND_alerts_init(void)
 	return (B_TRUE);
 }
 
-/*
- * Grabs the current setting of the ND alert, decodes it into text and
- * renders a texture suitable for display either on the ND alert overlay,
- * or on the ND in the VC of a supported aircraft (see ND_integ_init).
- */
 static void
-render_alert_texture(void)
+alert_font_params(int *font_size, double *bg_alpha)
 {
-	char msg[16];
-	int color, r, g, b, text_w, text_h, font_size;
-	double bg_alpha;
-	enum {
-	    MARGIN_SIZE = 10
-	};
-
-	VERIFY(XRAAS_ND_msg_decode(alert_status, msg, &color) != 0);
-
 	if (overlay_info != NULL) {
-		font_size = overlay_info->font_sz;
-		bg_alpha = overlay_info->bg_alpha;
+		*font_size = overlay_info->font_sz;
+		*bg_alpha = overlay_info->bg_alpha;
 	} else {
-		font_size = xraas_state->config.nd_alert_overlay_font_size;
-		bg_alpha = 0.67;
+		*font_size = xraas_state->config.nd_alert_overlay_font_size;
+		*bg_alpha = 0.67;
 	}
+}
 
-	if (!get_text_block_size(msg, overlay.face, font_size, &text_w,
-	    &text_h))
-		return;
+/*
+ * Decodes ND alert `value' and returns the pixel size its texture needs
+ * (including the margin around the text).
+ */
+static bool_t
+alert_text_size(int value, int font_size, int *w, int *h)
+{
+	char msg[16];
+	int color;
 
-	/* If the old alert is still being displayed, avoid leaking it. */
-	if (overlay.buf != NULL) {
-		glDeleteTextures(1, &overlay.texture);
-		free(overlay.buf);
-		overlay.buf = NULL;
-	}
+	VERIFY(XRAAS_ND_msg_decode(value, msg, &color) != 0);
+	return (get_text_box_size(msg, overlay.face, font_size, ALERT_MARGIN,
+	    w, h));
+}
 
-	overlay.width = text_w + 2 * MARGIN_SIZE;
-	overlay.height = text_h + 2 * MARGIN_SIZE;
-	overlay.buf = calloc(overlay.width * overlay.height * 4, 1);
+/*
+ * Renders ND alert `value' into the (x, y, w, h) rectangle of an RGBA
+ * buffer `buf' of `buf_w' x `buf_h' pixels.
+ */
+static bool_t
+alert_render_rect(int value, int font_size, double bg_alpha, uint8_t *buf,
+    int buf_w, int buf_h, int x, int y, int w, int h)
+{
+	char msg[16];
+	int color;
+	uint8_t r, g, b;
 
-	/* fill with a black, semi-transparent background */
-	if (bg_alpha != 0) {
-		for (int i = 0; i < overlay.width * overlay.height; i++)
-			overlay.buf[i * 4 + 3] = (uint8_t)(255 * bg_alpha);
-	}
+	VERIFY(XRAAS_ND_msg_decode(value, msg, &color) != 0);
 
 	if (color == XRAAS_ND_ALERT_GREEN) {
 		r = 0;
@@ -663,20 +694,250 @@ render_alert_texture(void)
 		b = 0;
 	}
 
-	if (!render_text_block(msg, overlay.face, font_size, MARGIN_SIZE,
-	    MARGIN_SIZE + font_size, r, g, b, overlay.buf, overlay.width,
-	    overlay.height)) {
-		free(overlay.buf);
-		overlay.buf = NULL;
-		return;
+	return (render_text_box(msg, overlay.face, font_size, ALERT_MARGIN,
+	    bg_alpha, r, g, b, buf, buf_w, buf_h, x, y, w, h));
+}
+
+static void
+atlas_flush(void)
+{
+	atlas_entry_t *e;
+	void *cookie = NULL;
+
+	if (atlas.texture != 0 && overlay.shown_tex == atlas.texture)
+		overlay_clear();
+	while ((e = avl_destroy_nodes(&atlas.entries, &cookie)) != NULL)
+		free(e);
+	if (atlas.texture != 0) {
+		glDeleteTextures(1, &atlas.texture);
+		atlas.texture = 0;
 	}
+	atlas.width = 0;
+	atlas.height = 0;
+}
+
+static void
+atlas_add(int value)
+{
+	atlas_entry_t *e = calloc(1, sizeof (*e));
 
-	glGenTextures(1, &overlay.texture);
-	glBindTexture(GL_TEXTURE_2D, overlay.texture);
+	e->value = value;
+	avl_add(&atlas.entries, e);
+}
+
+/*
+ * Builds the atlas texture for all alert messages which can be raised
+ * for the runway IDs in atlas.rwys.
+ */
+static void
+atlas_build(void)
+{
+	static const nd_alert_msg_type_t rwy_msgs[] = {
+	    ND_ALERT_APP, ND_ALERT_ON
+	};
+	int font_size, x = 0, y = 0, row_h = 0, n = 0;
+	double bg_alpha;
+	uint8_t *buf;
+
+	atlas_flush();
+	alert_font_params(&font_size, &bg_alpha);
+
+	for (int color = 0; color <= AMBER_FLAG; color += AMBER_FLAG) {
+		for (int msg = ND_ALERT_FLAPS; msg <= ND_ALERT_DEEP_LAND;
+		    msg++) {
+			if (msg != ND_ALERT_APP && msg != ND_ALERT_ON)
+				atlas_add(msg | color);
+		}
+		for (size_t i = 0; i < ARRAY_NUM_ELEM(rwy_msgs); i++) {
+			atlas_add(rwy_msgs[i] | color);
+			atlas_add(rwy_msgs[i] | color | (37 << 8));
+			for (int num = 1; num < NUM_RWY_IDS - 1; num++) {
+				for (int sfx = 0; sfx < NUM_RWY_SUFFIXES;
+				    sfx++) {
+					if (!atlas.rwys[num][sfx])
+						continue;
+					atlas_add(rwy_msgs[i] | color |
+					    (num << 8) | (sfx << 14));
+				}
+			}
+		}
+	}
+
+	/* measure & pack the entries into rows */
+	for (atlas_entry_t *e = avl_first(&atlas.entries); e != NULL;
+	    e = AVL_NEXT(&atlas.entries, e)) {
+		if (!alert_text_size(e->value, font_size, &e->w, &e->h))
+			goto errout;
+		ASSERT3S(e->w, <=, ATLAS_WIDTH);
+		if (x + e->w > ATLAS_WIDTH) {
+			x = 0;
+			y += row_h;
+			row_h = 0;
+		}
+		e->x = x;
+		e->y = y;
+		x += e->w;
+		row_h = MAX(row_h, e->h);
+		n++;
+	}
+	atlas.width = ATLAS_WIDTH;
+	atlas.height = y + row_h;
+
+	buf = calloc(atlas.width * atlas.height * 4, 1);
+	for (atlas_entry_t *e = avl_first(&atlas.entries); e != NULL;
+	    e = AVL_NEXT(&atlas.entries, e)) {
+		if (!alert_render_rect(e->value, font_size, bg_alpha, buf,
+		    atlas.width, atlas.height, e->x, e->y, e->w, e->h)) {
+			free(buf);
+			goto errout;
+		}
+	}
+
+	glGenTextures(1, &atlas.texture);
+	glBindTexture(GL_TEXTURE_2D, atlas.texture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, overlay.width, overlay.height,
-	    0, GL_RGBA, GL_UNSIGNED_BYTE, overlay.buf);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlas.width, atlas.height,
+	    0, GL_RGBA, GL_UNSIGNED_BYTE, buf);
+	free(buf);
+
+	dbg_log(nd_alert, 1, "pre-rendered %d ND alerts into %dx%d atlas",
+	    n, atlas.width, atlas.height);
+
+	return;
+errout:
+	atlas_flush();
+}
+
+/*
+ * Grabs the current setting of the ND alert and selects its texture for
+ * display either on the ND alert overlay, or on the ND in the VC of a
+ * supported aircraft (see ND_integ_init). If the alert isn't in the
+ * pre-rendered atlas, it is decoded into text and rendered on the spot.
+ */
+static void
+render_alert_texture(void)
+{
+	int font_size, text_w, text_h;
+	double bg_alpha;
+	size_t sz;
+
+	overlay_clear();
+
+	if (atlas.texture != 0 && (alert_status & RWY_LEN_MASK) == 0) {
+		atlas_entry_t srch = { .value = alert_status };
+		atlas_entry_t *e = avl_find(&atlas.entries, &srch, NULL);
+
+		if (e != NULL) {
+			overlay.shown_tex = atlas.texture;
+			overlay.width = e->w;
+			overlay.height = e->h;
+			overlay.s0 = e->x / (float)atlas.width;
+			overlay.s1 = (e->x + e->w) / (float)atlas.width;
+			overlay.t0 = e->y / (float)atlas.height;
+			overlay.t1 = (e->y + e->h) / (float)atlas.height;
+			return;
+		}
+	}
+
+	alert_font_params(&font_size, &bg_alpha);
+	if (!alert_text_size(alert_status, font_size, &text_w, &text_h))
+		return;
+
+	sz = text_w * text_h * 4;
+	if (sz > overlay.buf_sz) {
+		free(overlay.buf);
+		overlay.buf = malloc(sz);
+		overlay.buf_sz = sz;
+	}
+	if (!alert_render_rect(alert_status, font_size, bg_alpha, overlay.buf,
+	    text_w, text_h, 0, 0, text_w, text_h))
+		return;
+
+	if (text_w > overlay.tex_w || text_h > overlay.tex_h) {
+		/*
+		 * Grow the texture to fit. The backing store is undefined
+		 * until written, but we only ever sample the region we've
+		 * just uploaded into.
+		 */
+		overlay.tex_w = MAX(overlay.tex_w, text_w);
+		overlay.tex_h = MAX(overlay.tex_h, text_h);
+		if (overlay.texture == 0)
+			glGenTextures(1, &overlay.texture);
+		glBindTexture(GL_TEXTURE_2D, overlay.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+		    GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+		    GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, overlay.tex_w,
+		    overlay.tex_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	} else {
+		glBindTexture(GL_TEXTURE_2D, overlay.texture);
+	}
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, text_w, text_h, GL_RGBA,
+	    GL_UNSIGNED_BYTE, overlay.buf);
+
+	overlay.shown_tex = overlay.texture;
+	overlay.width = text_w;
+	overlay.height = text_h;
+	overlay.s0 = 0;
+	overlay.t0 = 0;
+	overlay.s1 = text_w / (float)overlay.tex_w;
+	overlay.t1 = text_h / (float)overlay.tex_h;
+}
+
+/*
+ * Called whenever the list of airports around us is reloaded. If the
+ * set of runway IDs of these airports has changed, the pre-rendered ND
+ * alert atlas is rebuilt.
+ */
+void
+ND_alerts_prerender(const list_t *arpts)
+{
+	bool_t rwys[NUM_RWY_IDS][NUM_RWY_SUFFIXES];
+	bool_t reselect;
+
+	if (!inited || !xraas_state->config.nd_alerts_enabled ||
+	    (!xraas_state->config.nd_alert_overlay_enabled &&
+	    overlay_info == NULL))
+		return;
+
+	memset(rwys, 0, sizeof (rwys));
+	for (const airport_t *arpt = list_head(arpts); arpt != NULL;
+	    arpt = list_next(arpts, arpt)) {
+		for (const runway_t *rwy = avl_first(&arpt->rwys); rwy != NULL;
+		    rwy = AVL_NEXT(&arpt->rwys, rwy)) {
+			for (int i = 0; i < 2; i++) {
+				const char *id = rwy->ends[i].id;
+				int num = atoi(id);
+				int sfx = 0;
+
+				if (num < 1 || num > 36)
+					continue;
+				switch (strlen(id) == 3 ? id[2] : 0) {
+				case 'R':
+					sfx = 1;
+					break;
+				case 'L':
+					sfx = 2;
+					break;
+				case 'C':
+					sfx = 3;
+					break;
+				}
+				rwys[num][sfx] = B_TRUE;
+			}
+		}
+	}
+
+	if (atlas.texture != 0 && memcmp(rwys, atlas.rwys, sizeof (rwys)) == 0)
+		return;
+	memcpy(atlas.rwys, rwys, sizeof (rwys));
+	reselect = (atlas.texture != 0 && overlay.shown_tex == atlas.texture);
+	atlas_build();
+	/* re-select the alert being displayed in the new atlas */
+	if (reselect && alert_status != 0)
+		render_alert_texture();
 }
 
 void
@@ -687,22 +948,27 @@ ND_alerts_fini()
 	if (!inited)
 		return;
 
-	if (overlay.buf != NULL) {
+	atlas_flush();
+	avl_destroy(&atlas.entries);
+	overlay_clear();
+	if (overlay.texture != 0)
 		glDeleteTextures(1, &overlay.texture);
-		free(overlay.buf);
-		overlay.buf = NULL;
-	}
+	free(overlay.buf);
 
-	if (debug_textures != NULL) {
-		glDeleteTextures(NUM_DEBUG_PANELS, debug_textures);
-		free(debug_textures);
+	if (debug_panels != NULL) {
+		glDeleteTextures(1, &debug_panels->texture);
 		free(debug_panels);
-		debug_textures = NULL;
 		debug_panels = NULL;
 		XPLMUnregisterDrawCallback(debug_panel_draw_cb,
 		    DEBUG_PANEL_PHASE, DEBUG_PANEL_PHASE_FLAG, NULL);
 	}
 
+	free(overlay_quads.vtx);
+	free(overlay_quads.tex);
+	memset(&overlay_quads, 0, sizeof (overlay_quads));
+	overlay_quads.dirty = B_TRUE;
+
+	text_cache_flush(overlay.face);
 	VERIFY(FT_Done_Face(overlay.face) == 0);
 	VERIFY(FT_Done_FreeType(overlay.ft) == 0);
 
@@ -780,6 +1046,7 @@ ND_alert(nd_alert_msg_type_t msg, nd_alert_level_t level, const char *rwy_id,
 			msg |= ((dist / 100) & 0xff) << 16;
 	}
 
+	journal_nd_alert(msg);
 	alert_status = msg;
 	alert_start_time = microclock();
 
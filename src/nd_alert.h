@@ -78,6 +78,7 @@ void ND_alerts_fini(void);
 void ND_alert(nd_alert_msg_type_t msg, nd_alert_level_t level,
     const char *rwy_id, int dist);
 void ND_alert_overlay_enable(void);
+void ND_alerts_prerender(const list_t *arpts);
 int ND_alert_status(void);
 
 #ifdef	__cplusplus
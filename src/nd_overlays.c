@@ -0,0 +1,390 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/avl.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+
+#include "dbg_log.h"
+#include "xraas2.h"
+
+#include "nd_overlays.h"
+
+/*
+ * In-memory database of data/ND_overlays.cfg (see ND_integ_init in
+ * nd_alert.c for a description of the file format). The file is parsed
+ * once and indexed by aircraft ICAO code, so matching an aircraft is a
+ * single tree lookup followed by a walk over the (usually one or two)
+ * blocks for that ICAO code. The file is only re-parsed if its size or
+ * modification time change.
+ */
+
+#define	ND_OVERLAYS_CFG		"ND_overlays.cfg"
+#define	DEFAULT_BG_ALPHA	0.5
+#define	DEFAULT_OFF		0.5
+
+typedef struct {
+	char		icao[8];
+	ND_overlay_t	*first;
+	ND_overlay_t	*last;
+	avl_node_t	node;
+} icao_bucket_t;
+
+static struct {
+	bool_t		loaded;
+	bool_t		exists;
+	time_t		mtime;
+	off_t		size;
+	/* a "debug" keyword appears anywhere in the file */
+	bool_t		debug;
+	avl_tree_t	icaos;
+} db;
+
+static int
+icao_bucket_compar(const void *a, const void *b)
+{
+	const icao_bucket_t *ba = a, *bb = b;
+	int res = strcmp(ba->icao, bb->icao);
+
+	if (res < 0)
+		return (-1);
+	if (res > 0)
+		return (1);
+	return (0);
+}
+
+static void
+overlay_free(ND_overlay_t *ovl)
+{
+	free(ovl->studio);
+	free(ovl->author);
+	free(ovl->acf);
+	free(ovl->nds);
+	free(ovl);
+}
+
+static void
+db_flush(void)
+{
+	icao_bucket_t *bucket;
+	void *cookie = NULL;
+
+	if (!db.loaded)
+		return;
+	while ((bucket = avl_destroy_nodes(&db.icaos, &cookie)) != NULL) {
+		ND_overlay_t *ovl, *next;
+
+		for (ovl = bucket->first; ovl != NULL; ovl = next) {
+			next = ovl->next;
+			overlay_free(ovl);
+		}
+		free(bucket);
+	}
+	avl_destroy(&db.icaos);
+	db.loaded = B_FALSE;
+	db.debug = B_FALSE;
+}
+
+static void
+db_add(ND_overlay_t *ovl)
+{
+	icao_bucket_t srch, *bucket;
+	avl_index_t where;
+
+	strlcpy(srch.icao, ovl->icao, sizeof (srch.icao));
+	bucket = avl_find(&db.icaos, &srch, &where);
+	if (bucket == NULL) {
+		bucket = calloc(1, sizeof (*bucket));
+		strlcpy(bucket->icao, ovl->icao, sizeof (bucket->icao));
+		avl_insert(&db.icaos, bucket, where);
+		bucket->first = ovl;
+	} else {
+		bucket->last->next = ovl;
+	}
+	bucket->last = ovl;
+}
+
+static bool_t
+parse_str(FILE *fp, const char *keyword, char **str)
+{
+	char buf[256];
+
+	if (fscanf(fp, "%255s", buf) != 1) {
+		logMsg("Error parsing %s: expected string following \"%s\".",
+		    ND_OVERLAYS_CFG, keyword);
+		return (B_FALSE);
+	}
+	unescape_percent(buf);
+	free(*str);
+	*str = strdup(buf);
+
+	return (B_TRUE);
+}
+
+/*
+ * Adds the just finished aircraft block to the database. Incomplete
+ * blocks are dropped. Returns false if the block was dropped.
+ */
+static bool_t
+block_done(ND_overlay_t *ovl)
+{
+	if (ovl->font_sz <= 0) {
+		logMsg("Error parsing %s: block for \"%s\" is missing a valid "
+		    "\"fontsz\", ignoring it.", ND_OVERLAYS_CFG, ovl->icao);
+		overlay_free(ovl);
+		return (B_FALSE);
+	}
+	ovl->debug = db.debug;
+	db_add(ovl);
+	return (B_TRUE);
+}
+
+/*
+ * Parses the entire ND_overlays.cfg into the database. An aircraft block
+ * containing an error is dropped with a warning and the parser skips
+ * ahead to the next "icao" keyword, so one bad block doesn't take the
+ * rest of the aircraft down with it.
+ */
+static void
+db_parse(const char *filename)
+{
+	FILE *fp = fopen(filename, "r");
+	char buf[128], icao[8];
+	ND_overlay_t *ovl = NULL;
+	ND_overlay_nd_t *nd = NULL;
+	bool_t skip = B_FALSE;
+	int n_blocks = 0, n_bad = 0;
+
+	if (fp == NULL)
+		return;
+
+#define	CHECK_OVL(keyword) \
+	do { \
+		if (ovl == NULL) { \
+			logMsg("Error parsing %s: \"" keyword "\" must be " \
+			    "preceded by \"icao\".", ND_OVERLAYS_CFG); \
+			goto bad_block; \
+		} \
+	} while (0)
+
+#define	PARSE_PARAM(ptr, param, fmt, typename) \
+	do { \
+		if (fscanf(fp, fmt, (ptr)) != 1) { \
+			logMsg("Error parsing %s: expected " typename \
+			    " following \"" param "\".", ND_OVERLAYS_CFG); \
+			goto bad_block; \
+		} \
+	} while (0)
+
+#define	PARSE_ND_PARAM(param, fmt, typename) \
+	do { \
+		if (nd == NULL) { \
+			logMsg("Error parsing %s: \"" #param "\" must be " \
+			    "preceded by \"nd\".", ND_OVERLAYS_CFG); \
+			goto bad_block; \
+		} \
+		PARSE_PARAM(&nd->param, #param, fmt, typename); \
+	} while (0)
+
+	while (fscanf(fp, "%127s", buf) == 1) {
+		if (buf[0] == '#') {
+			int c;
+			while ((c = fgetc(fp)) != '\n' && c != EOF)
+				;
+			continue;
+		}
+		if (skip && strcmp(buf, "icao") != 0 &&
+		    strcmp(buf, "debug") != 0)
+			continue;
+		if (strcmp(buf, "debug") == 0) {
+			db.debug = B_TRUE;
+		} else if (strcmp(buf, "icao") == 0) {
+			if (ovl != NULL) {
+				if (block_done(ovl))
+					n_blocks++;
+				else
+					n_bad++;
+				ovl = NULL;
+			}
+			nd = NULL;
+			skip = B_FALSE;
+			PARSE_PARAM(icao, "icao", "%7s", "string");
+			unescape_percent(icao);
+			ovl = calloc(1, sizeof (*ovl));
+			strlcpy(ovl->icao, icao, sizeof (ovl->icao));
+			ovl->bg_alpha = DEFAULT_BG_ALPHA;
+		} else if (strcmp(buf, "studio") == 0) {
+			CHECK_OVL("studio");
+			if (!parse_str(fp, "studio", &ovl->studio))
+				goto bad_block;
+		} else if (strcmp(buf, "author") == 0) {
+			CHECK_OVL("author");
+			if (!parse_str(fp, "author", &ovl->author))
+				goto bad_block;
+		} else if (strcmp(buf, "acf") == 0) {
+			CHECK_OVL("acf");
+			if (!parse_str(fp, "acf", &ovl->acf))
+				goto bad_block;
+		} else if (strcmp(buf, "fontsz") == 0) {
+			CHECK_OVL("fontsz");
+			PARSE_PARAM(&ovl->font_sz, "fontsz", "%d", "integer");
+		} else if (strcmp(buf, "bgalpha") == 0) {
+			CHECK_OVL("bgalpha");
+			PARSE_PARAM(&ovl->bg_alpha, "bgalpha", "%lf", "float");
+		} else if (strcmp(buf, "nd") == 0) {
+			CHECK_OVL("nd");
+			ovl->nds = realloc(ovl->nds,
+			    (ovl->n_nds + 1) * sizeof (*ovl->nds));
+			nd = &ovl->nds[ovl->n_nds++];
+			memset(nd, 0, sizeof (*nd));
+			nd->hoff = DEFAULT_OFF;
+			nd->voff = DEFAULT_OFF;
+		} else if (strcmp(buf, "x") == 0) {
+			PARSE_ND_PARAM(x, "%d", "integer");
+		} else if (strcmp(buf, "y") == 0) {
+			PARSE_ND_PARAM(y, "%d", "integer");
+		} else if (strcmp(buf, "w") == 0) {
+			PARSE_ND_PARAM(w, "%d", "integer");
+		} else if (strcmp(buf, "h") == 0) {
+			PARSE_ND_PARAM(h, "%d", "integer");
+		} else if (strcmp(buf, "hoff") == 0) {
+			PARSE_ND_PARAM(hoff, "%lf", "float");
+		} else if (strcmp(buf, "voff") == 0) {
+			PARSE_ND_PARAM(voff, "%lf", "float");
+		} else {
+			logMsg("Error parsing %s: unknown keyword \"%s\".",
+			    ND_OVERLAYS_CFG, buf);
+			goto bad_block;
+		}
+		continue;
+bad_block:
+		/* drop the current block & skip ahead to the next one */
+		if (ovl != NULL) {
+			logMsg("%s: ignoring the block for \"%s\".",
+			    ND_OVERLAYS_CFG, ovl->icao);
+			overlay_free(ovl);
+			ovl = NULL;
+			n_bad++;
+		}
+		nd = NULL;
+		skip = B_TRUE;
+	}
+#undef	CHECK_OVL
+#undef	PARSE_PARAM
+#undef	PARSE_ND_PARAM
+
+	if (ovl != NULL) {
+		if (block_done(ovl))
+			n_blocks++;
+		else
+			n_bad++;
+	}
+	fclose(fp);
+
+	dbg_log(nd_alert, 1, "parsed %s: %d blocks (%d ignored), "
+	    "%lu aircraft types", ND_OVERLAYS_CFG, n_blocks, n_bad,
+	    avl_numnodes(&db.icaos));
+}
+
+/*
+ * Makes sure the database reflects the current contents of the config
+ * file, (re)parsing it if necessary.
+ */
+static void
+db_refresh(void)
+{
+	char *filename = mkpathname(xraas_plugindir, "data", ND_OVERLAYS_CFG,
+	    NULL);
+	struct stat st;
+	bool_t exists = (stat(filename, &st) == 0);
+
+	if (db.loaded && exists == db.exists && (!exists ||
+	    (st.st_mtime == db.mtime && st.st_size == db.size))) {
+		free(filename);
+		return;
+	}
+
+	db_flush();
+	avl_create(&db.icaos, icao_bucket_compar, sizeof (icao_bucket_t),
+	    offsetof(icao_bucket_t, node));
+	db.loaded = B_TRUE;
+	db.exists = exists;
+	if (exists) {
+		db.mtime = st.st_mtime;
+		db.size = st.st_size;
+		db_parse(filename);
+	}
+	free(filename);
+}
+
+/*
+ * Returns the first aircraft block for ICAO code `icao', or NULL if there
+ * is none. Further blocks for the same ICAO code follow via `next'. The
+ * returned blocks remain valid until the next call to ND_overlays_find
+ * or ND_overlays_fini. `debug' is set if the config file enables the
+ * ND debug panels (but see ND_overlay_t->debug for matched blocks).
+ */
+const ND_overlay_t *
+ND_overlays_find(const char *icao, bool_t *debug)
+{
+	icao_bucket_t srch, *bucket;
+
+	db_refresh();
+	*debug = db.debug;
+	strlcpy(srch.icao, icao, sizeof (srch.icao));
+	bucket = avl_find(&db.icaos, &srch, NULL);
+
+	return (bucket != NULL ? bucket->first : NULL);
+}
+
+/*
+ * Checks the studio, author & acf predicates of an aircraft block.
+ */
+bool_t
+ND_overlay_match(const ND_overlay_t *ovl, const char *studio,
+    const char *author, const char *acf)
+{
+#define	MATCH_PARAM(param) \
+	do { \
+		if (ovl->param != NULL) { \
+			int res = strcmp(ovl->param, param); \
+			dbg_log(nd_alert, 3, #param "(\"%s\") %s my_" #param, \
+			    ovl->param, (res == 0 ? "==" : "!=")); \
+			if (res != 0) \
+				return (B_FALSE); \
+		} \
+	} while (0)
+	MATCH_PARAM(studio);
+	MATCH_PARAM(author);
+	MATCH_PARAM(acf);
+#undef	MATCH_PARAM
+
+	return (B_TRUE);
+}
+
+void
+ND_overlays_fini(void)
+{
+	db_flush();
+}
@@ -0,0 +1,63 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_ND_OVERLAYS_H_
+#define	_XRAAS_ND_OVERLAYS_H_
+
+#include <stdlib.h>
+
+#include <acfutils/types.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	int		x, y, w, h;
+	double		hoff, voff;
+} ND_overlay_nd_t;
+
+/*
+ * A single aircraft block from data/ND_overlays.cfg. The studio, author
+ * and acf predicates are NULL if the block doesn't filter on them.
+ * Blocks with the same ICAO code are chained through `next' in the order
+ * in which they appear in the file.
+ */
+typedef struct ND_overlay {
+	char			icao[8];
+	char			*studio;
+	char			*author;
+	char			*acf;
+	int			font_sz;
+	double			bg_alpha;
+	size_t			n_nds;
+	ND_overlay_nd_t		*nds;
+	/* a "debug" keyword precedes the end of this block */
+	bool_t			debug;
+	struct ND_overlay	*next;
+} ND_overlay_t;
+
+const ND_overlay_t *ND_overlays_find(const char *icao, bool_t *debug);
+bool_t ND_overlay_match(const ND_overlay_t *ovl, const char *studio,
+    const char *author, const char *acf);
+void ND_overlays_fini(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_ND_OVERLAYS_H_ */
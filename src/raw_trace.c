@@ -0,0 +1,300 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if	IBM
+#include <windows.h>
+#else	/* !IBM */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif	/* !IBM */
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+
+#include "dbg_log.h"
+#include "xraas2.h"
+
+#include "raw_trace.h"
+
+/*
+ * Raw trace mode. The highest volume debug messages (the air data dumps
+ * in airdata.c and the rwy_key table changes) are expensive to format on
+ * the hot path. When `raw_trace = true' in X-RAAS.cfg, those sites don't
+ * call dbg_log, but instead copy their arguments into a fixed-size binary
+ * record (see raw_trace_fmt.h), regardless of the debug level. Nothing is
+ * formatted: tools/raw_trace_dump renders the records offline into the
+ * same text that dbg_log would have written.
+ *
+ * The records go into a ring in a memory-mapped file of raw_trace_size
+ * MiB in Output/X-RAAS/raw_trace, so writing one is just a memcpy and the
+ * OS takes care of getting it to disk, even if the sim crashes. Once the
+ * ring is full, the oldest records are overwritten, so a soak test can
+ * run for as long as it wants and the file keeps the latest part of it.
+ * Writers reserve slots with an atomic increment of the header's sequence
+ * counter, so ff_a320_update can trace from the A320's avionics thread.
+ */
+
+#define	RAW_TRACE_DIR		"raw_trace"
+
+static struct {
+	bool_t			active;
+	char			*path;
+	size_t			size;
+	raw_trace_hdr_t		*hdr;
+	raw_trace_rec_t		*recs;
+#if	IBM
+	HANDLE			fh;
+	HANDLE			mh;
+#endif	/* IBM */
+} rt;
+
+static void *
+map_file(const char *path, size_t size)
+{
+#if	IBM
+	void *p;
+
+	rt.fh = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+	    FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (rt.fh == INVALID_HANDLE_VALUE) {
+		logMsg("Error creating raw trace file %s: error %d", path,
+		    (int)GetLastError());
+		return (NULL);
+	}
+	rt.mh = CreateFileMappingA(rt.fh, NULL, PAGE_READWRITE,
+	    (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+	if (rt.mh == NULL) {
+		logMsg("Error mapping raw trace file %s: error %d", path,
+		    (int)GetLastError());
+		CloseHandle(rt.fh);
+		return (NULL);
+	}
+	p = MapViewOfFile(rt.mh, FILE_MAP_WRITE, 0, 0, size);
+	if (p == NULL) {
+		logMsg("Error mapping raw trace file %s: error %d", path,
+		    (int)GetLastError());
+		CloseHandle(rt.mh);
+		CloseHandle(rt.fh);
+		return (NULL);
+	}
+	return (p);
+#else	/* !IBM */
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	void *p;
+
+	if (fd == -1) {
+		logMsg("Error creating raw trace file %s: %s", path,
+		    strerror(errno));
+		return (NULL);
+	}
+	if (ftruncate(fd, size) != 0) {
+		logMsg("Error sizing raw trace file %s: %s", path,
+		    strerror(errno));
+		close(fd);
+		return (NULL);
+	}
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	/* the mapping holds its own reference to the file */
+	close(fd);
+	if (p == MAP_FAILED) {
+		logMsg("Error mapping raw trace file %s: %s", path,
+		    strerror(errno));
+		return (NULL);
+	}
+	return (p);
+#endif	/* !IBM */
+}
+
+static void
+unmap_file(void *p, size_t size)
+{
+#if	IBM
+	UNUSED(size);
+	FlushViewOfFile(p, 0);
+	UnmapViewOfFile(p);
+	CloseHandle(rt.mh);
+	CloseHandle(rt.fh);
+#else	/* !IBM */
+	msync(p, size, MS_SYNC);
+	munmap(p, size);
+#endif	/* !IBM */
+}
+
+void
+raw_trace_init(void)
+{
+	char *dir, filename[64];
+	time_t now = time(NULL);
+	size_t n_recs;
+
+	ASSERT(!rt.active);
+	memset(&rt, 0, sizeof (rt));
+	if (!xraas_state->config.raw_trace)
+		return;
+
+	n_recs = ((size_t)MAX(xraas_state->config.raw_trace_size, 1) << 20) /
+	    sizeof (raw_trace_rec_t);
+
+#ifdef	XRAAS_IS_EMBEDDED
+	dir = mkpathname(xraas_plugindir, RAW_TRACE_DIR, NULL);
+#else	/* !XRAAS_IS_EMBEDDED */
+	dir = mkpathname(xraas_xpdir, "Output", "X-RAAS", RAW_TRACE_DIR,
+	    NULL);
+#endif	/* !XRAAS_IS_EMBEDDED */
+	if (!create_directory_recursive(dir)) {
+		free(dir);
+		return;
+	}
+	strftime(filename, sizeof (filename), "%Y-%m-%d_%H%M%S.xrt",
+	    localtime(&now));
+	rt.path = mkpathname(dir, filename, NULL);
+	free(dir);
+
+	rt.size = sizeof (raw_trace_hdr_t) + n_recs * sizeof (raw_trace_rec_t);
+	rt.hdr = map_file(rt.path, rt.size);
+	if (rt.hdr == NULL) {
+		free(rt.path);
+		rt.path = NULL;
+		return;
+	}
+	rt.recs = (raw_trace_rec_t *)(rt.hdr + 1);
+	rt.hdr->magic = RAW_TRACE_MAGIC;
+	rt.hdr->version = RAW_TRACE_VERSION;
+	rt.hdr->rec_size = sizeof (raw_trace_rec_t);
+	rt.hdr->n_recs = n_recs;
+	rt.hdr->start_time = now;
+	rt.hdr->next_seq = 0;
+
+	rt.active = B_TRUE;
+	dbg_log(startup, 1, "raw trace opened: %s (%lu records)", rt.path,
+	    (unsigned long)n_recs);
+}
+
+/*
+ * Must be called after all tracing sites have stopped, i.e. after
+ * adc_fini and after the rwy_key tables have been destroyed.
+ */
+void
+raw_trace_fini(void)
+{
+	if (!rt.active)
+		return;
+	rt.active = B_FALSE;
+	dbg_log(startup, 1, "raw trace closed: %llu records",
+	    (unsigned long long)rt.hdr->next_seq);
+	unmap_file(rt.hdr, rt.size);
+	free(rt.path);
+	memset(&rt, 0, sizeof (rt));
+}
+
+/*
+ * Reserves the next record in the ring. The record must be handed to
+ * rec_commit once it has been filled in.
+ */
+static raw_trace_rec_t *
+rec_alloc(raw_trace_ev_t type, int line, double sim_time, uint64_t *seq)
+{
+	raw_trace_rec_t *rec;
+
+	*seq = __atomic_add_fetch(&rt.hdr->next_seq, 1, __ATOMIC_RELAXED);
+	rec = &rt.recs[(*seq - 1) % rt.hdr->n_recs];
+	/* invalidate the slot while it's being overwritten */
+	__atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+	rec->sim_time = sim_time;
+	rec->type = type;
+	rec->line = line;
+	rec->pad = 0;
+
+	return (rec);
+}
+
+static void
+rec_commit(raw_trace_rec_t *rec, uint64_t seq)
+{
+	__atomic_store_n(&rec->seq, seq, __ATOMIC_RELEASE);
+}
+
+bool_t
+raw_trace_adc(raw_trace_ev_t type, int line, const adc_t *adc)
+{
+	raw_trace_rec_t *rec;
+	raw_trace_adc_t *ra;
+	uint64_t seq;
+
+	if (!rt.active)
+		return (B_FALSE);
+
+	rec = rec_alloc(type, line, adc->sim_time, &seq);
+	ra = &rec->u.adc;
+	memset(ra, 0, sizeof (*ra));
+	ra->baro_alt = adc->baro_alt;
+	ra->baro_set = adc->baro_set;
+	ra->rad_alt = adc->rad_alt;
+	ra->lat = adc->lat;
+	ra->lon = adc->lon;
+	ra->elev = adc->elev;
+	ra->hdg = adc->hdg;
+	ra->pitch = adc->pitch;
+	ra->cas = adc->cas;
+	ra->gs = adc->gs;
+	ra->trans_alt = adc->trans_alt;
+	ra->trans_lvl = adc->trans_lvl;
+	ra->takeoff_flaps_min = adc->takeoff_flaps_min;
+	ra->takeoff_flaps_max = adc->takeoff_flaps_max;
+	ra->landing_flaps_min = adc->landing_flaps_min;
+	ra->landing_flaps_max = adc->landing_flaps_max;
+	ra->vref = adc->vref;
+	ra->vapp = adc->vapp;
+	ra->ils_info.active = adc->ils_info.active;
+	ra->ils_info.freq = adc->ils_info.freq;
+	ra->ils_info.hdef = adc->ils_info.hdef;
+	ra->ils_info.vdef = adc->ils_info.vdef;
+	memcpy(ra->ils_info.id, adc->ils_info.id, sizeof (ra->ils_info.id));
+	rec_commit(rec, seq);
+
+	return (B_TRUE);
+}
+
+bool_t
+raw_trace_rwy_key(raw_trace_ev_t type, int line, const char *tbl,
+    const char *key, int value)
+{
+	raw_trace_rec_t *rec;
+	uint64_t seq;
+
+	if (!rt.active)
+		return (B_FALSE);
+
+	rec = rec_alloc(type, line, adc->sim_time, &seq);
+	/* fixed-width fields, not necessarily NUL-terminated */
+	memset(&rec->u.rwy_key, 0, sizeof (rec->u.rwy_key));
+	memcpy(rec->u.rwy_key.tbl, tbl,
+	    strnlen(tbl, sizeof (rec->u.rwy_key.tbl)));
+	memcpy(rec->u.rwy_key.key, key,
+	    strnlen(key, sizeof (rec->u.rwy_key.key)));
+	rec->u.rwy_key.value = value;
+	rec_commit(rec, seq);
+
+	return (B_TRUE);
+}
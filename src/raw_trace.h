@@ -0,0 +1,45 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_RAW_TRACE_H_
+#define	_XRAAS_RAW_TRACE_H_
+
+#include <acfutils/types.h>
+
+#include "airdata.h"
+#include "raw_trace_fmt.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+void raw_trace_init(void);
+void raw_trace_fini(void);
+
+/*
+ * These return B_FALSE if raw tracing is off, in which case the caller
+ * should log the event using dbg_log as usual.
+ */
+bool_t raw_trace_adc(raw_trace_ev_t type, int line, const adc_t *adc);
+bool_t raw_trace_rwy_key(raw_trace_ev_t type, int line, const char *tbl,
+    const char *key, int value);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_RAW_TRACE_H_ */
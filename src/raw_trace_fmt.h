@@ -0,0 +1,133 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_RAW_TRACE_FMT_H_
+#define	_XRAAS_RAW_TRACE_FMT_H_
+
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * On-disk format of the raw trace file (see raw_trace.c). Kept free of any
+ * plugin dependencies, so tools/raw_trace_dump.c can use it too. The file
+ * is a raw_trace_hdr_t followed by a ring of hdr.n_recs raw_trace_rec_t's.
+ * Each record carries a sequence number, which is written last, so the
+ * records are put back in order by sorting them on it. Unused slots (and
+ * slots that were being written when the sim died) have seq = 0. All
+ * values are stored in the host's byte order.
+ */
+
+#define	RAW_TRACE_MAGIC		0x54525258u	/* "XRRT" */
+#define	RAW_TRACE_VERSION	1
+#define	RAW_TRACE_TBL_LEN	24
+#define	RAW_TRACE_KEY_LEN	16
+
+/*
+ * The air data text format used by the adc debug messages. Shared with
+ * the trace renderer, so that it prints exactly what dbg_log would have.
+ * ADC_PRINTF_ARGS works on both adc_t and raw_trace_adc_t.
+ */
+#define	ADC_PRINTF_FMT \
+	"ALT:%05.0fft/%02.2finHg/%04.0fm POS:%02.04fdeg/%03.04fdeg/%05.0fm " \
+	"ATT:%03.0fdeg/%02.1fdeg SPD:%03.0fkt/%03.0fmps TR:%05dft/%05dft " \
+	"FL:%0.02f-%0.02f/%0.02f-%0.02f VR:%03.0fkt/%03.0fkt " \
+	"ILS:%d/%.2f/%s/%.01f/%.01f"
+#define	ADC_PRINTF_ARGS(adc) \
+	(adc)->baro_alt, (adc)->baro_set, (adc)->rad_alt, (adc)->lat, \
+	(adc)->lon, (adc)->elev, (adc)->hdg, (adc)->pitch, (adc)->cas, \
+	(adc)->gs, (int)(adc)->trans_alt, (int)(adc)->trans_lvl, \
+	(adc)->takeoff_flaps_min, (adc)->takeoff_flaps_max, \
+	(adc)->landing_flaps_min, (adc)->landing_flaps_max, \
+	(adc)->vref, (adc)->vapp, (int)(adc)->ils_info.active, \
+	(adc)->ils_info.active ? (adc)->ils_info.freq : 0.0, \
+	(adc)->ils_info.active ? (adc)->ils_info.id : "", \
+	(adc)->ils_info.active ? (adc)->ils_info.hdef : 0.0, \
+	(adc)->ils_info.active ? (adc)->ils_info.vdef : 0.0
+
+typedef enum {
+	RT_ADC_COLLECT = 1,	/* "[adc/2] collect; " in adc_collect */
+	RT_FF_A320_UPDATE,	/* "[ff_a320/4] update; " in ff_a320_update */
+	RT_RWY_KEY_CREATE,	/* "[rwy_key/2] create(tbl)" */
+	RT_RWY_KEY_DESTROY,	/* "[rwy_key/2] destroy(tbl)" */
+	RT_RWY_KEY_EMPTY,	/* "[rwy_key/2] empty(tbl)" */
+	RT_RWY_KEY_SET,		/* "[rwy_key/1] tbl[key] = value" */
+	RT_RWY_KEY_REMOVE	/* "[rwy_key/1] tbl[key] = nil" */
+} raw_trace_ev_t;
+
+/* The adc_t fields printed by ADC_PRINTF_FMT, same names as in adc_t */
+typedef struct {
+	double		baro_alt;
+	double		baro_set;
+	double		rad_alt;
+	double		lat;
+	double		lon;
+	double		elev;
+	double		hdg;
+	double		pitch;
+	double		cas;
+	double		gs;
+	int32_t		trans_alt;
+	int32_t		trans_lvl;
+	double		takeoff_flaps_min;
+	double		takeoff_flaps_max;
+	double		landing_flaps_min;
+	double		landing_flaps_max;
+	double		vref;
+	double		vapp;
+	struct {
+		double	freq;
+		double	hdef;
+		double	vdef;
+		uint8_t	active;
+		char	id[8];
+	} ils_info;
+} raw_trace_adc_t;
+
+typedef struct {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	rec_size;
+	uint32_t	n_recs;
+	uint32_t	pad;
+	int64_t		start_time;	/* UNIX time */
+	uint64_t	next_seq;	/* sequence number of the last record */
+} raw_trace_hdr_t;
+
+typedef struct {
+	uint64_t	seq;		/* 1-based, 0 = slot not valid */
+	double		sim_time;	/* seconds */
+	uint16_t	type;		/* raw_trace_ev_t */
+	uint16_t	line;		/* source line of the traced site */
+	uint32_t	pad;
+	union {
+		raw_trace_adc_t	adc;
+		struct {
+			char	tbl[RAW_TRACE_TBL_LEN];
+			char	key[RAW_TRACE_KEY_LEN];
+			int32_t	value;
+		} rwy_key;
+	} u;
+} raw_trace_rec_t;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_RAW_TRACE_FMT_H_ */
@@ -31,6 +31,8 @@
 #include <acfutils/airportdb.h>
 
 #include "dbg_log.h"
+#include "journal.h"
+#include "raw_trace.h"
 #include "rwy_key_tbl.h"
 
 #define	RWY_ID_KEY_SZ			16
@@ -57,10 +59,12 @@ compar(const void *a, const void *b)
 void
 rwy_key_tbl_create(rwy_key_tbl_t *tbl, const char *name)
 {
-	dbg_log(rwy_key, 2, "create(%s)", name);
+	if (!raw_trace_rwy_key(RT_RWY_KEY_CREATE, __LINE__, name, "", 0))
+		dbg_log(rwy_key, 2, "create(%s)", name);
 	avl_create(&tbl->tree, compar, sizeof (rwy_key_t),
 	    offsetof(rwy_key_t, node));
 	tbl->name = strdup(name);
+	tbl->journal_id = journal_tbl_name(name);
 }
 
 static void
@@ -76,7 +80,8 @@ rwy_key_tbl_contents_destroy(rwy_key_tbl_t *tbl)
 void
 rwy_key_tbl_destroy(rwy_key_tbl_t *tbl)
 {
-	dbg_log(rwy_key, 2, "destroy(%s)", tbl->name);
+	if (!raw_trace_rwy_key(RT_RWY_KEY_DESTROY, __LINE__, tbl->name, "", 0))
+		dbg_log(rwy_key, 2, "destroy(%s)", tbl->name);
 	rwy_key_tbl_contents_destroy(tbl);
 	avl_destroy(&tbl->tree);
 	free(tbl->name);
@@ -85,7 +90,11 @@ rwy_key_tbl_destroy(rwy_key_tbl_t *tbl)
 void
 rwy_key_tbl_empty(rwy_key_tbl_t *tbl)
 {
-	dbg_log(rwy_key, 2, "empty(%s)", tbl->name);
+	if (!raw_trace_rwy_key(RT_RWY_KEY_EMPTY, __LINE__, tbl->name, "", 0))
+		dbg_log(rwy_key, 2, "empty(%s)", tbl->name);
+	/* an empty key in the journal stands for the entire table */
+	if (avl_numnodes(&tbl->tree) != 0)
+		journal_rwy_key(tbl->journal_id, "", B_FALSE, 0);
 	rwy_key_tbl_contents_destroy(tbl);
 	avl_destroy(&tbl->tree);
 	avl_create(&tbl->tree, compar, sizeof (rwy_key_t),
@@ -100,8 +109,12 @@ rwy_key_tbl_remove(rwy_key_tbl_t *tbl, const char *arpt_id, const char *rwy_id)
 
 	snprintf(srch.key, sizeof (srch.key), "%s/%s", arpt_id, rwy_id);
 	if ((key = avl_find(&tbl->tree, &srch, NULL)) != NULL) {
-		dbg_log(rwy_key, 1, "%s[%s/%s] = nil", tbl->name, arpt_id,
-		    rwy_id);
+		if (!raw_trace_rwy_key(RT_RWY_KEY_REMOVE, __LINE__, tbl->name,
+		    key->key, 0)) {
+			dbg_log(rwy_key, 1, "%s[%s/%s] = nil", tbl->name,
+			    arpt_id, rwy_id);
+		}
+		journal_rwy_key(tbl->journal_id, key->key, B_FALSE, 0);
 		avl_remove(&tbl->tree, key);
 		free(key);
 	}
@@ -121,8 +134,12 @@ rwy_key_tbl_set(rwy_key_tbl_t *tbl, const char *arpt_id, const char *rwy_id,
 		avl_insert(&tbl->tree, key, where);
 	}
 	if (key->value != value) {
-		dbg_log(rwy_key, 1, "%s[%s/%s] = %d", tbl->name, arpt_id,
-		    rwy_id, value);
+		if (!raw_trace_rwy_key(RT_RWY_KEY_SET, __LINE__, tbl->name,
+		    key->key, value)) {
+			dbg_log(rwy_key, 1, "%s[%s/%s] = %d", tbl->name,
+			    arpt_id, rwy_id, value);
+		}
+		journal_rwy_key(tbl->journal_id, key->key, B_TRUE, value);
 		key->value = value;
 	}
 }
@@ -151,8 +168,12 @@ rwy_key_tbl_remove_distant(rwy_key_tbl_t *tbl, const list_t *curarpt_list)
 			}
 		}
 		if (!found) {
-			dbg_log(rwy_key, 1, "%s[%s] = nil", tbl->name,
-			    key->key);
+			if (!raw_trace_rwy_key(RT_RWY_KEY_REMOVE, __LINE__,
+			    tbl->name, key->key, 0)) {
+				dbg_log(rwy_key, 1, "%s[%s] = nil", tbl->name,
+				    key->key);
+			}
+			journal_rwy_key(tbl->journal_id, key->key, B_FALSE, 0);
 			avl_remove(&tbl->tree, key);
 			free(key);
 		}
@@ -36,6 +36,7 @@ extern "C" {
 typedef struct {
 	avl_tree_t	tree;
 	char		*name;
+	int		journal_id;
 } rwy_key_tbl_t;
 
 void rwy_key_tbl_create(rwy_key_tbl_t *tbl, const char *name);
@@ -16,19 +16,23 @@
  */
 
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <XPLMProcessing.h>
 #include <XPLMUtilities.h>
 
 #include <acfutils/assert.h>
+#include <acfutils/dr.h>
 #include <acfutils/list.h>
 #include <acfutils/wav.h>
 #include <acfutils/time.h>
 
 #include "dbg_log.h"
 #include "init_msg.h"
+#include "journal.h"
 #include "snd_sys.h"
+#include "stats.h"
 
 typedef struct {
 	msg_type_t	*msgs;
@@ -37,9 +41,85 @@ typedef struct {
 	msg_prio_t	prio;
 	int64_t		started;
 
+	int64_t		queued_t;	/* play_msg time */
+	int64_t		first_play_t;	/* first wav_play time */
+
+	int64_t		paused_t;	/* 0 if not paused */
+	bool_t		ducked;		/* held by higher prio */
+	int64_t		pass_played;	/* usec played */
+
 	list_node_t	node;
 } ann_t;
 
+/*
+ * Annunciation latency statistics. For every message priority we keep
+ * a rolling window of the most recent trigger-to-first-sample and
+ * trigger-to-completion delays. The window percentiles are exported via
+ * the xraas/snd/latency/ datarefs (in milliseconds, each an array indexed
+ * by priority, LOW first) and summarized in the log periodically.
+ */
+#define	NUM_PRIOS		3
+#define	PRIO2IDX(prio)		((int)(prio) - MSG_PRIO_LOW)
+#define	LAT_WINDOW		64	/* samples per priority */
+#define	LAT_LOG_INTVAL		SEC2USEC(60)
+
+typedef struct {
+	int64_t		samples[LAT_WINDOW];	/* microseconds */
+	int		n;
+	int		next;
+	float		p50, p95, max;		/* milliseconds */
+} lat_window_t;
+
+static struct {
+	lat_window_t	start[NUM_PRIOS];	/* to first sample */
+	lat_window_t	done[NUM_PRIOS];	/* to completion */
+	bool_t		changed;
+	int64_t		last_log;
+
+	/* exported values, indexed by PRIO2IDX */
+	float		start_p50[NUM_PRIOS];
+	float		start_p95[NUM_PRIOS];
+	float		start_max[NUM_PRIOS];
+	float		done_p50[NUM_PRIOS];
+	float		done_p95[NUM_PRIOS];
+	float		done_max[NUM_PRIOS];
+	int		played[NUM_PRIOS];
+	int		suppressed[NUM_PRIOS];
+	int		preempted[NUM_PRIOS];
+
+	dr_t		start_p50_dr, start_p95_dr, start_max_dr;
+	dr_t		done_p50_dr, done_p95_dr, done_max_dr;
+	dr_t		played_dr, suppressed_dr, preempted_dr;
+} lat;
+
+/*
+ * The mixer keeps one playback channel per message priority. Only the
+ * highest priority non-empty channel is audible. A channel that gets
+ * interrupted (by a higher priority channel, or by GPWS) is paused at
+ * its current word instead of being discarded. Once it gets the output
+ * back, it resumes from the interrupted word if the pause was shorter
+ * than SND_RESUME_MAX_PAUSE, otherwise it repeats the whole phrase.
+ * Annunciations ducked by a higher priority channel for longer than
+ * SND_DUCK_MAX_HOLD are considered stale and dropped.
+ *
+ * Mixer metrics are exported via the xraas/snd/mixer/ datarefs, each
+ * an array indexed by priority, LOW first.
+ */
+#define	SND_RESUME_MAX_PAUSE	SEC2USEC(3)
+#define	SND_DUCK_MAX_HOLD	SEC2USEC(10)
+
+static struct {
+	int		depth[NUM_PRIOS];	/* queue depth */
+	int		depth_max[NUM_PRIOS];
+	float		wasted[NUM_PRIOS];	/* ms of airtime */
+	int		resumed[NUM_PRIOS];	/* at cut-off word */
+	int		restarted[NUM_PRIOS];	/* from 1st word */
+	int		dropped[NUM_PRIOS];	/* stale, ducked */
+
+	dr_t		depth_dr, depth_max_dr, wasted_dr;
+	dr_t		resumed_dr, restarted_dr, dropped_dr;
+} mix;
+
 typedef struct msg {
 	const char *name;
 	const char *text;
@@ -86,10 +166,167 @@ static msg_t voice_msgs[NUM_MSGS] = {
 
 static bool_t inited = B_FALSE;
 static bool_t view_is_ext = B_FALSE;
-static list_t playback_queue;
+static list_t channels[NUM_PRIOS];	/* playback queue per priority */
 static alc_t *alc = NULL;
 static bool_t openal_shared = B_FALSE;
 
+static int
+lat_sample_compar(const void *a, const void *b)
+{
+	const int64_t *ia = a, *ib = b;
+
+	if (*ia < *ib)
+		return (-1);
+	if (*ia > *ib)
+		return (1);
+	return (0);
+}
+
+static void
+lat_record(lat_window_t *win, int64_t delay)
+{
+	int64_t sorted[LAT_WINDOW];
+
+	win->samples[win->next] = delay;
+	win->next = (win->next + 1) % LAT_WINDOW;
+	if (win->n < LAT_WINDOW)
+		win->n++;
+
+	memcpy(sorted, win->samples, win->n * sizeof (*sorted));
+	qsort(sorted, win->n, sizeof (*sorted), lat_sample_compar);
+	win->p50 = sorted[(win->n - 1) / 2] / 1000.0;
+	win->p95 = sorted[((win->n - 1) * 95) / 100] / 1000.0;
+	win->max = sorted[win->n - 1] / 1000.0;
+	lat.changed = B_TRUE;
+}
+
+static void
+lat_ann_started(ann_t *ann, int64_t now)
+{
+	int i = PRIO2IDX(ann->prio);
+
+	if (ann->first_play_t != 0)
+		return;
+	ann->first_play_t = now;
+	lat_record(&lat.start[i], now - ann->queued_t);
+	lat.start_p50[i] = lat.start[i].p50;
+	lat.start_p95[i] = lat.start[i].p95;
+	lat.start_max[i] = lat.start[i].max;
+	dbg_log(snd, 2, "prio %d trigger-to-audio %.1f ms", ann->prio,
+	    (now - ann->queued_t) / 1000.0);
+}
+
+static void
+lat_ann_done(ann_t *ann, int64_t now)
+{
+	int i = PRIO2IDX(ann->prio);
+
+	lat_record(&lat.done[i], now - ann->queued_t);
+	lat.done_p50[i] = lat.done[i].p50;
+	lat.done_p95[i] = lat.done[i].p95;
+	lat.done_max[i] = lat.done[i].max;
+	lat.played[i]++;
+}
+
+static void
+lat_log_summary(int64_t now)
+{
+	static const char *prio_names[NUM_PRIOS] = { "low", "med", "high" };
+
+	if (now - lat.last_log < LAT_LOG_INTVAL)
+		return;
+	lat.last_log = now;
+	if (!lat.changed)
+		return;
+	lat.changed = B_FALSE;
+
+	for (int i = 0; i < NUM_PRIOS; i++) {
+		if (lat.start[i].n == 0 && lat.suppressed[i] == 0 &&
+		    lat.preempted[i] == 0)
+			continue;
+		logMsg("snd latency %s: start p50/p95/max %.0f/%.0f/%.0f ms, "
+		    "done p50/p95/max %.0f/%.0f/%.0f ms, played %d, "
+		    "suppressed %d, preempted %d", prio_names[i],
+		    lat.start[i].p50, lat.start[i].p95, lat.start[i].max,
+		    lat.done[i].p50, lat.done[i].p95, lat.done[i].max,
+		    lat.played[i], lat.suppressed[i], lat.preempted[i]);
+	}
+}
+
+static void
+lat_init(void)
+{
+	memset(&lat, 0, sizeof (lat));
+	lat.last_log = microclock();
+
+	dr_create_vf(&lat.start_p50_dr, lat.start_p50, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/latency/start_p50");
+	dr_create_vf(&lat.start_p95_dr, lat.start_p95, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/latency/start_p95");
+	dr_create_vf(&lat.start_max_dr, lat.start_max, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/latency/start_max");
+	dr_create_vf(&lat.done_p50_dr, lat.done_p50, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/latency/done_p50");
+	dr_create_vf(&lat.done_p95_dr, lat.done_p95, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/latency/done_p95");
+	dr_create_vf(&lat.done_max_dr, lat.done_max, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/latency/done_max");
+	dr_create_vi(&lat.played_dr, lat.played, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/latency/played");
+	dr_create_vi(&lat.suppressed_dr, lat.suppressed, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/latency/suppressed");
+	dr_create_vi(&lat.preempted_dr, lat.preempted, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/latency/preempted");
+}
+
+static void
+lat_fini(void)
+{
+	lat.changed = B_TRUE;
+	lat.last_log = 0;
+	lat_log_summary(microclock());
+
+	dr_delete(&lat.start_p50_dr);
+	dr_delete(&lat.start_p95_dr);
+	dr_delete(&lat.start_max_dr);
+	dr_delete(&lat.done_p50_dr);
+	dr_delete(&lat.done_p95_dr);
+	dr_delete(&lat.done_max_dr);
+	dr_delete(&lat.played_dr);
+	dr_delete(&lat.suppressed_dr);
+	dr_delete(&lat.preempted_dr);
+}
+
+static void
+mix_init(void)
+{
+	memset(&mix, 0, sizeof (mix));
+
+	dr_create_vi(&mix.depth_dr, mix.depth, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/mixer/queue_depth");
+	dr_create_vi(&mix.depth_max_dr, mix.depth_max, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/mixer/queue_depth_max");
+	dr_create_vf(&mix.wasted_dr, mix.wasted, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/mixer/wasted_ms");
+	dr_create_vi(&mix.resumed_dr, mix.resumed, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/mixer/resumed");
+	dr_create_vi(&mix.restarted_dr, mix.restarted, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/mixer/restarted");
+	dr_create_vi(&mix.dropped_dr, mix.dropped, NUM_PRIOS, B_FALSE,
+	    "xraas/snd/mixer/dropped");
+}
+
+static void
+mix_fini(void)
+{
+	dr_delete(&mix.depth_dr);
+	dr_delete(&mix.depth_max_dr);
+	dr_delete(&mix.wasted_dr);
+	dr_delete(&mix.resumed_dr);
+	dr_delete(&mix.restarted_dr);
+	dr_delete(&mix.dropped_dr);
+}
+
 static void
 set_sound_on(bool_t flag)
 {
@@ -98,27 +335,150 @@ set_sound_on(bool_t flag)
 		    flag ? xraas_state->config.voice_volume : 0);
 }
 
-static int
-resolve_priority_ordering(ann_t *ann, msg_prio_t new_prio)
+static void
+ann_free(ann_t *ann)
 {
-	if (ann->prio > new_prio) {
-		/* current message overrides us, be quiet */
-		dbg_log(snd, 1, "priority too low, suppressing.");
-		return (-1);
+	free(ann->msgs);
+	free(ann);
+}
+
+static void
+channel_insert(ann_t *ann)
+{
+	int i = PRIO2IDX(ann->prio);
+
+	list_insert_tail(&channels[i], ann);
+	mix.depth[i]++;
+	mix.depth_max[i] = MAX(mix.depth_max[i], mix.depth[i]);
+}
+
+static void
+channel_remove(ann_t *ann)
+{
+	int i = PRIO2IDX(ann->prio);
+
+	list_remove(&channels[i], ann);
+	mix.depth[i]--;
+	ASSERT3S(mix.depth[i], >=, 0);
+}
+
+/*
+ * Returns the annunciation which currently owns the audio output, i.e.
+ * the head of the highest priority non-empty channel.
+ */
+static ann_t *
+active_ann(void)
+{
+	for (int i = NUM_PRIOS - 1; i >= 0; i--) {
+		ann_t *ann = list_head(&channels[i]);
+		if (ann != NULL)
+			return (ann);
+	}
+	return (NULL);
+}
+
+/*
+ * Interrupts an annunciation at its current word. The word is replayed
+ * from its start once the annunciation resumes, so the portion of it
+ * that had already been played counts as wasted airtime.
+ */
+static void
+ann_pause(ann_t *ann, int64_t now, bool_t ducked)
+{
+	if (ann->paused_t == 0) {
+		if (ann->cur_msg >= 0) {
+			wav_t *wav = voice_msgs[ann->msgs[ann->cur_msg]].wav;
+
+			wav_stop(wav);
+			mix.wasted[PRIO2IDX(ann->prio)] += MIN(now -
+			    ann->started, SEC2USEC(wav->duration)) / 1000.0;
+		}
+		ann->paused_t = now;
 	}
-	if (ann->prio == new_prio) {
-		/* same priority, append */
-		return (0);
+	ann->ducked |= ducked;
+}
+
+/*
+ * Picks an interrupted annunciation back up. After a short interruption
+ * we continue with the word that was cut off, otherwise the listener
+ * has likely lost the context, so the whole phrase is repeated.
+ */
+static void
+ann_resume(ann_t *ann, int64_t now)
+{
+	int i = PRIO2IDX(ann->prio);
+
+	ASSERT(ann->paused_t != 0);
+	if (now - ann->paused_t <= SND_RESUME_MAX_PAUSE) {
+		dbg_log(snd, 1, "resuming prio %d annunciation at word %d",
+		    ann->prio, ann->cur_msg);
+		/* the advance logic in snd_sched replays cur_msg */
+		if (ann->cur_msg >= 0)
+			ann->cur_msg--;
+		mix.resumed[i]++;
+	} else {
+		dbg_log(snd, 1, "restarting prio %d annunciation", ann->prio);
+		mix.wasted[i] += ann->pass_played / 1000.0;
+		ann->pass_played = 0;
+		ann->cur_msg = -1;
+		mix.restarted[i]++;
 	}
+	ann->paused_t = 0;
+	ann->ducked = B_FALSE;
+	ann->started = 0;
+}
 
-	/* we override the queue head, remove it and retry */
-	dbg_log(snd, 1, "priority higher, stopping current annunciation.");
-	list_remove(&playback_queue, ann);
-	if (ann->cur_msg != -1)
-		wav_stop(voice_msgs[ann->msgs[ann->cur_msg]].wav);
-	free(ann->msgs);
-	free(ann);
-	return (1);
+static void
+channels_drain(void)
+{
+	for (int i = 0; i < NUM_PRIOS; i++) {
+		ann_t *ann;
+
+		while ((ann = list_head(&channels[i])) != NULL) {
+			if (ann->cur_msg >= 0 && ann->paused_t == 0) {
+				wav_stop(
+				    voice_msgs[ann->msgs[ann->cur_msg]].wav);
+			}
+			channel_remove(ann);
+			ann_free(ann);
+		}
+	}
+}
+
+/*
+ * Applies the priority rules for a newly arriving message. If a higher
+ * priority channel is busy, the new message is suppressed and we return
+ * B_FALSE. Otherwise any lower priority channel that is currently
+ * speaking is ducked, so it is held at its current word until we are
+ * done and then resumes from there.
+ */
+static bool_t
+resolve_priority_ordering(msg_prio_t new_prio)
+{
+	int64_t now = microclock();
+
+	for (int i = NUM_PRIOS - 1; i > PRIO2IDX(new_prio); i--) {
+		if (!list_is_empty(&channels[i])) {
+			/* current message overrides us, be quiet */
+			dbg_log(snd, 1, "priority too low, suppressing.");
+			lat.suppressed[PRIO2IDX(new_prio)]++;
+			lat.changed = B_TRUE;
+			return (B_FALSE);
+		}
+	}
+	for (int i = PRIO2IDX(new_prio) - 1; i >= 0; i--) {
+		ann_t *ann = list_head(&channels[i]);
+
+		if (ann == NULL || ann->ducked)
+			continue;
+		dbg_log(snd, 1, "priority higher, ducking current "
+		    "annunciation.");
+		lat.preempted[i]++;
+		lat.changed = B_TRUE;
+		ann_pause(ann, now, B_TRUE);
+	}
+
+	return (B_TRUE);
 }
 
 void
@@ -137,34 +497,30 @@ play_msg(msg_type_t *msg, size_t msg_len, msg_prio_t prio)
 		dbg_log(snd, 1, "TTS: \"%s\"", buf);
 		XPLMSpeakString(buf);
 		free(buf);
+		journal_msg(msg, msg_len, prio, JOURNAL_MSG_TTS);
 		free(msg);
 		return;
 	}
 
 	ASSERT(inited);
 
-top:
-	if ((ann = list_head(&playback_queue)) != NULL) {
-		switch (resolve_priority_ordering(ann, prio)) {
-		case -1:
-			free(msg);
-			return;
-		case 0:
-			break;
-		case 1:
-			goto top;
-		}
+	if (!resolve_priority_ordering(prio)) {
+		journal_msg(msg, msg_len, prio, JOURNAL_MSG_SUPPRESSED);
+		free(msg);
+		return;
 	}
+	journal_msg(msg, msg_len, prio, 0);
 	/*
-	 * At this point the queue only contains messages of equal priotity
-	 * to our own, queue up at the end.
+	 * At this point no channel above ours is busy, queue up at the
+	 * end of our own channel.
 	 */
 	ann = calloc(1, sizeof (*ann));
 	ann->msgs = msg;
 	ann->num_msgs = msg_len;
 	ann->prio = prio;
 	ann->cur_msg = -1;
-	list_insert_tail(&playback_queue, ann);
+	ann->queued_t = microclock();
+	channel_insert(ann);
 }
 
 bool_t
@@ -177,19 +533,10 @@ modify_cur_msg(msg_type_t *msg, size_t msg_len, msg_prio_t prio)
 
 	ASSERT(inited);
 
-top:
-	if ((ann = list_head(&playback_queue)) != NULL) {
-		switch (resolve_priority_ordering(ann, prio)) {
-		case -1:
-			return (B_FALSE);
-		case 0:
-			break;
-		case 1:
-			goto top;
-		}
-	}
+	if (!resolve_priority_ordering(prio))
+		return (B_FALSE);
 
-	ann = list_head(&playback_queue);
+	ann = list_head(&channels[PRIO2IDX(prio)]);
 	if (ann == NULL) {
 		/* nothing to modify, so just play */
 		play_msg(msg, msg_len, prio);
@@ -202,6 +549,7 @@ top:
 		free(ann->msgs);
 		ann->msgs = msg;
 		ann->num_msgs = msg_len;
+		journal_msg(msg, msg_len, prio, JOURNAL_MSG_MODIFIED);
 		return (B_TRUE);
 	} else {
 		/* messages don't match or we're too late, fail */
@@ -210,20 +558,17 @@ top:
 }
 
 static float
-snd_sched_cb(float elapsed_since_last_call, float elapsed_since_last_floop,
-    int counter, void *refcon)
+snd_sched(void)
 {
 	int64_t now;
 	ann_t *ann;
 
 	ASSERT(inited);
 
-	UNUSED(elapsed_since_last_call);
-	UNUSED(elapsed_since_last_floop);
-	UNUSED(counter);
-	UNUSED(refcon);
+	now = microclock();
+	lat_log_summary(now);
 
-	ann = list_head(&playback_queue);
+	ann = active_ann();
 	if (ann == NULL)
 		return (-1.0);
 
@@ -244,14 +589,13 @@ snd_sched_cb(float elapsed_since_last_call, float elapsed_since_last_floop,
 	}
 
 	/*
-	 * Stop audio when GPWS is overriding us - we'll restart the
+	 * Stop audio when GPWS is overriding us - we'll resume the
 	 * annunciation once it's over.
 	 */
 	if (GPWS_has_priority()) {
-		if (ann->cur_msg >= 0) {
+		if (ann->cur_msg >= 0 && ann->paused_t == 0) {
 			dbg_log(snd, 1, "GPWS priority override, pausing");
-			wav_stop(voice_msgs[ann->msgs[ann->cur_msg]].wav);
-			ann->cur_msg = -1;
+			ann_pause(ann, now, B_FALSE);
 		}
 		return (-1.0);
 	}
@@ -259,23 +603,39 @@ snd_sched_cb(float elapsed_since_last_call, float elapsed_since_last_floop,
 	/* Stop audio when power is down and drain the queue. */
 	if (!xraas_is_on()) {
 		dbg_log(snd, 1, "lost power, stopping sound");
-		if (ann->cur_msg >= 0)
-			wav_stop(voice_msgs[ann->msgs[ann->cur_msg]].wav);
-		do {
-			list_remove(&playback_queue, ann);
-			free(ann->msgs);
-			free(ann);
-		} while ((ann = list_head(&playback_queue)) != NULL);
+		channels_drain();
 		return (-1.0);
 	}
 
-	now = microclock();
+	/*
+	 * A ducked annunciation which has been held for too long is no
+	 * longer relevant, drop it instead of wasting more airtime on it.
+	 */
+	while (ann != NULL && ann->ducked &&
+	    now - ann->paused_t > SND_DUCK_MAX_HOLD) {
+		dbg_log(snd, 1, "prio %d annunciation held too long, dropping",
+		    ann->prio);
+		mix.wasted[PRIO2IDX(ann->prio)] += ann->pass_played / 1000.0;
+		mix.dropped[PRIO2IDX(ann->prio)]++;
+		channel_remove(ann);
+		ann_free(ann);
+		ann = active_ann();
+	}
+	if (ann == NULL)
+		return (-1.0);
+	if (ann->paused_t != 0)
+		ann_resume(ann, now);
 
 	ASSERT(ann->cur_msg < ann->num_msgs);
 	if (ann->cur_msg == -1 || now - ann->started >
 	    SEC2USEC(voice_msgs[ann->msgs[ann->cur_msg]].wav->duration)) {
-		if (ann->cur_msg >= 0)
-			wav_stop(voice_msgs[ann->msgs[ann->cur_msg]].wav);
+		if (ann->cur_msg >= 0) {
+			wav_t *wav = voice_msgs[ann->msgs[ann->cur_msg]].wav;
+
+			wav_stop(wav);
+			if (ann->started != 0)
+				ann->pass_played += SEC2USEC(wav->duration);
+		}
 		ann->cur_msg++;
 		if (ann->cur_msg < ann->num_msgs) {
 			ann->started = now;
@@ -284,17 +644,37 @@ snd_sched_cb(float elapsed_since_last_call, float elapsed_since_last_floop,
 				log_init_msg(B_TRUE, INIT_ERR_MSG_TIMEOUT, NULL,
 				    NULL, "Cannot play sound, OpenAL error.\n"
 				    "See Log.txt for more information.");
+			} else {
+				lat_ann_started(ann, now);
 			}
 		} else {
-			list_remove(&playback_queue, ann);
-			free(ann->msgs);
-			free(ann);
+			lat_ann_done(ann, now);
+			channel_remove(ann);
+			ann_free(ann);
 		}
 	}
 
 	return (-1.0);
 }
 
+static float
+snd_sched_cb(float elapsed_since_last_call, float elapsed_since_last_floop,
+    int counter, void *refcon)
+{
+	uint64_t t = stats_start();
+	float res;
+
+	UNUSED(elapsed_since_last_call);
+	UNUSED(elapsed_since_last_floop);
+	UNUSED(counter);
+	UNUSED(refcon);
+
+	res = snd_sched();
+	stats_end(STATS_SND_SCHED, t);
+
+	return (res);
+}
+
 bool_t
 snd_sys_init(const char *plugindir)
 {
@@ -346,7 +726,12 @@ snd_sys_init(const char *plugindir)
 		free(pathname);
 	}
 
-	list_create(&playback_queue, sizeof (ann_t), offsetof(ann_t, node));
+	for (int i = 0; i < NUM_PRIOS; i++) {
+		list_create(&channels[i], sizeof (ann_t),
+		    offsetof(ann_t, node));
+	}
+	lat_init();
+	mix_init();
 	XPLMRegisterFlightLoopCallback(snd_sched_cb, -1.0, NULL);
 
 	inited = B_TRUE;
@@ -375,15 +760,13 @@ snd_sys_fini(void)
 		return;
 	ASSERT(!xraas_state->config.use_tts);
 
-	for (ann_t *ann = list_head(&playback_queue); ann != NULL;
-	    ann = list_head(&playback_queue)) {
-		list_remove(&playback_queue, ann);
-		free(ann->msgs);
-		free(ann);
-	}
+	channels_drain();
 
 	XPLMUnregisterFlightLoopCallback(snd_sched_cb, NULL);
-	list_destroy(&playback_queue);
+	for (int i = 0; i < NUM_PRIOS; i++)
+		list_destroy(&channels[i]);
+	lat_fini();
+	mix_fini();
 
 	for (msg_type_t msg = 0; msg < NUM_MSGS; msg++) {
 		if (voice_msgs[msg].wav != NULL) {
@@ -399,6 +782,17 @@ snd_sys_fini(void)
 	inited = B_FALSE;
 }
 
+/*
+ * Returns the short name of message `msg' (also the base name of its
+ * WAV file).
+ */
+const char *
+snd_msg_name(msg_type_t msg)
+{
+	ASSERT3U(msg, <, NUM_MSGS);
+	return (voice_msgs[msg].name);
+}
+
 void
 snd_sys_set_shared(bool_t flag)
 {
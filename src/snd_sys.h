@@ -78,6 +78,7 @@ bool_t modify_cur_msg(msg_type_t *msg, size_t msg_len, msg_prio_t prio);
 bool_t snd_sys_init(const char *plugindir);
 void snd_sys_fini(void);
 void snd_sys_set_shared(bool_t flag);
+const char *snd_msg_name(msg_type_t msg);
 
 #ifdef	__cplusplus
 }
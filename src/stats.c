@@ -0,0 +1,306 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#include <string.h>
+
+#if	IBM
+#include <windows.h>
+#elif	APL
+#include <mach/mach_time.h>
+#else	/* LIN */
+#include <time.h>
+#endif	/* LIN */
+
+#include <XPLMUtilities.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/dr.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+
+#include "stats.h"
+
+/*
+ * Hot path timing counters. The flight loop & drawing callbacks wrap
+ * each of their stages in stats_start/stats_end, which adds the time the
+ * stage took to the stage's histogram. The histograms have SUB_BKTS
+ * buckets per power of two nanoseconds, so recording a sample is just a
+ * few integer operations and the percentiles are exact to within 12.5%.
+ * Everything is cumulative since the plugin was enabled or the last
+ * "xraas/stats/reset" command.
+ *
+ * stats_publish (called from the flight loop) refreshes the per-stage
+ * xraas/stats/{min,avg,p99,max}_us & xraas/stats/count dataref arrays,
+ * indexed by stats_stage_t. The "xraas/stats/dump" command writes all
+ * stages to the log.
+ *
+ * All timed stages run on the sim's main thread, so nothing is locked.
+ */
+
+#define	SUB_BITS	3
+#define	SUB_BKTS	(1 << SUB_BITS)
+#define	MAX_EXP		35	/* 2^35 ns = 34 seconds */
+#define	NUM_BKTS	((MAX_EXP - SUB_BITS + 2) * SUB_BKTS)
+
+typedef struct {
+	uint64_t	n;
+	uint64_t	sum;	/* ns */
+	uint64_t	min;	/* ns */
+	uint64_t	max;	/* ns */
+	uint32_t	bkts[NUM_BKTS];
+} stage_t;
+
+static const char *const stage_names[NUM_STATS_STAGES] = {
+	"raas_exec",			/* STATS_RAAS_EXEC */
+	"adc_collect",			/* STATS_ADC_COLLECT */
+	"load_nearest_airports",	/* STATS_LOAD_NEAREST_ARPTS */
+	"ground_runway_approach",	/* STATS_GND_RWY_APCH */
+	"ground_on_runway_aligned",	/* STATS_GND_ON_RWY */
+	"air_runway_approach",		/* STATS_AIR_RWY_APCH */
+	"altimeter_setting",		/* STATS_ALTM_SETTING */
+	"snd_sched_cb",			/* STATS_SND_SCHED */
+	"nd_alert_draw_cb",		/* STATS_ND_ALERT_DRAW */
+	"dbg_gui_draw_cb"		/* STATS_DBG_GUI_DRAW */
+};
+
+static struct {
+	bool_t		inited;
+	stage_t		stages[NUM_STATS_STAGES];
+
+	/* tick to ns conversion factor */
+	uint64_t	tick_num;
+	uint64_t	tick_den;
+
+	float		min_us[NUM_STATS_STAGES];
+	float		avg_us[NUM_STATS_STAGES];
+	float		p99_us[NUM_STATS_STAGES];
+	float		max_us[NUM_STATS_STAGES];
+	int		count[NUM_STATS_STAGES];
+	dr_t		min_us_dr;
+	dr_t		avg_us_dr;
+	dr_t		p99_us_dr;
+	dr_t		max_us_dr;
+	dr_t		count_dr;
+
+	XPLMCommandRef	dump_cmd;
+	XPLMCommandRef	reset_cmd;
+} stats;
+
+/*
+ * Returns the current value of the platform's high resolution clock.
+ * Ticks are converted to ns using tick_num / tick_den.
+ */
+static inline uint64_t
+ticks(void)
+{
+#if	IBM
+	LARGE_INTEGER cnt;
+	QueryPerformanceCounter(&cnt);
+	return (cnt.QuadPart);
+#elif	APL
+	return (mach_absolute_time());
+#else	/* LIN */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000000llu + ts.tv_nsec);
+#endif	/* LIN */
+}
+
+static void
+ticks_init(void)
+{
+#if	IBM
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	stats.tick_num = 1000000000llu;
+	stats.tick_den = freq.QuadPart;
+#elif	APL
+	mach_timebase_info_data_t tb;
+	mach_timebase_info(&tb);
+	stats.tick_num = tb.numer;
+	stats.tick_den = tb.denom;
+#else	/* LIN */
+	stats.tick_num = 1;
+	stats.tick_den = 1;
+#endif	/* LIN */
+}
+
+static unsigned
+ns2bkt(uint64_t ns)
+{
+	unsigned e;
+
+	if (ns < SUB_BKTS)
+		return (ns);
+	e = 63 - __builtin_clzll(ns);
+	if (e > MAX_EXP)
+		return (NUM_BKTS - 1);
+	return ((e - SUB_BITS + 1) * SUB_BKTS +
+	    ((ns >> (e - SUB_BITS)) & (SUB_BKTS - 1)));
+}
+
+/*
+ * Returns the (exclusive) upper bound of bucket `bkt' in ns.
+ */
+static uint64_t
+bkt2ns(unsigned bkt)
+{
+	unsigned e, sub;
+
+	if (bkt < SUB_BKTS)
+		return (bkt + 1);
+	e = bkt / SUB_BKTS + SUB_BITS - 1;
+	sub = bkt % SUB_BKTS;
+	return ((uint64_t)(SUB_BKTS + sub + 1) << (e - SUB_BITS));
+}
+
+static uint64_t
+stage_p99(const stage_t *st)
+{
+	uint64_t thresh = st->n - st->n / 100, n = 0;
+
+	for (unsigned i = 0; i < NUM_BKTS; i++) {
+		n += st->bkts[i];
+		if (n >= thresh)
+			return (MIN(bkt2ns(i), st->max));
+	}
+	return (st->max);
+}
+
+uint64_t
+stats_start(void)
+{
+	return (ticks());
+}
+
+void
+stats_end(stats_stage_t stage, uint64_t start)
+{
+	stage_t *st = &stats.stages[stage];
+	uint64_t ns = ((ticks() - start) * stats.tick_num) / stats.tick_den;
+
+	ASSERT3U(stage, <, NUM_STATS_STAGES);
+	if (st->n == 0 || ns < st->min)
+		st->min = ns;
+	if (ns > st->max)
+		st->max = ns;
+	st->n++;
+	st->sum += ns;
+	st->bkts[ns2bkt(ns)]++;
+}
+
+/*
+ * Refreshes the xraas/stats datarefs.
+ */
+void
+stats_publish(void)
+{
+	for (int i = 0; i < NUM_STATS_STAGES; i++) {
+		const stage_t *st = &stats.stages[i];
+
+		if (st->n == 0) {
+			stats.min_us[i] = 0;
+			stats.avg_us[i] = 0;
+			stats.p99_us[i] = 0;
+			stats.max_us[i] = 0;
+		} else {
+			stats.min_us[i] = st->min / 1000.0;
+			stats.avg_us[i] = (st->sum / st->n) / 1000.0;
+			stats.p99_us[i] = stage_p99(st) / 1000.0;
+			stats.max_us[i] = st->max / 1000.0;
+		}
+		stats.count[i] = MIN(st->n, (uint64_t)INT32_MAX);
+	}
+}
+
+static void
+stats_dump(void)
+{
+	stats_publish();
+	logMsg("X-RAAS timing stats (us):");
+	for (int i = 0; i < NUM_STATS_STAGES; i++) {
+		if (stats.count[i] == 0)
+			continue;
+		logMsg("  %-26s n %8d  min %8.1f  avg %8.1f  p99 %8.1f  "
+		    "max %8.1f", stage_names[i], stats.count[i],
+		    stats.min_us[i], stats.avg_us[i], stats.p99_us[i],
+		    stats.max_us[i]);
+	}
+}
+
+static int
+stats_cmd_cb(XPLMCommandRef cmd, XPLMCommandPhase phase, void *refcon)
+{
+	UNUSED(refcon);
+	if (phase != xplm_CommandBegin)
+		return (1);
+	if (cmd == stats.dump_cmd) {
+		stats_dump();
+	} else {
+		memset(stats.stages, 0, sizeof (stats.stages));
+		stats_publish();
+	}
+	return (1);
+}
+
+void
+stats_init(void)
+{
+	ASSERT(!stats.inited);
+
+	memset(stats.stages, 0, sizeof (stats.stages));
+	ticks_init();
+	stats_publish();
+
+	dr_create_vf(&stats.min_us_dr, stats.min_us, NUM_STATS_STAGES,
+	    B_FALSE, "xraas/stats/min_us");
+	dr_create_vf(&stats.avg_us_dr, stats.avg_us, NUM_STATS_STAGES,
+	    B_FALSE, "xraas/stats/avg_us");
+	dr_create_vf(&stats.p99_us_dr, stats.p99_us, NUM_STATS_STAGES,
+	    B_FALSE, "xraas/stats/p99_us");
+	dr_create_vf(&stats.max_us_dr, stats.max_us, NUM_STATS_STAGES,
+	    B_FALSE, "xraas/stats/max_us");
+	dr_create_vi(&stats.count_dr, stats.count, NUM_STATS_STAGES,
+	    B_FALSE, "xraas/stats/count");
+
+	stats.dump_cmd = XPLMCreateCommand("xraas/stats/dump",
+	    "Writes X-RAAS' timing statistics to Log.txt");
+	stats.reset_cmd = XPLMCreateCommand("xraas/stats/reset",
+	    "Resets X-RAAS' timing statistics");
+	XPLMRegisterCommandHandler(stats.dump_cmd, stats_cmd_cb, 0, NULL);
+	XPLMRegisterCommandHandler(stats.reset_cmd, stats_cmd_cb, 0, NULL);
+
+	stats.inited = B_TRUE;
+}
+
+void
+stats_fini(void)
+{
+	if (!stats.inited)
+		return;
+
+	XPLMUnregisterCommandHandler(stats.dump_cmd, stats_cmd_cb, 0, NULL);
+	XPLMUnregisterCommandHandler(stats.reset_cmd, stats_cmd_cb, 0, NULL);
+
+	dr_delete(&stats.min_us_dr);
+	dr_delete(&stats.avg_us_dr);
+	dr_delete(&stats.p99_us_dr);
+	dr_delete(&stats.max_us_dr);
+	dr_delete(&stats.count_dr);
+
+	stats.inited = B_FALSE;
+}
@@ -0,0 +1,56 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+#ifndef	_XRAAS_STATS_H_
+#define	_XRAAS_STATS_H_
+
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * Timed stages. These index the xraas/stats dataref arrays, so new
+ * stages must only ever be added at the end.
+ */
+typedef enum {
+	STATS_RAAS_EXEC,	/* all of raas_exec */
+	STATS_ADC_COLLECT,
+	STATS_LOAD_NEAREST_ARPTS,
+	STATS_GND_RWY_APCH,	/* ground_runway_approach */
+	STATS_GND_ON_RWY,	/* ground_on_runway_aligned */
+	STATS_AIR_RWY_APCH,	/* air_runway_approach */
+	STATS_ALTM_SETTING,	/* altimeter_setting */
+	STATS_SND_SCHED,	/* snd_sched_cb */
+	STATS_ND_ALERT_DRAW,	/* nd_alert_draw_cb */
+	STATS_DBG_GUI_DRAW,	/* dbg_gui draw_cb */
+	NUM_STATS_STAGES
+} stats_stage_t;
+
+void stats_init(void);
+void stats_fini(void);
+void stats_publish(void);
+
+uint64_t stats_start(void);
+void stats_end(stats_stage_t stage, uint64_t start);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _XRAAS_STATS_H_ */
@@ -23,7 +23,15 @@
  * Copyright 2017 Saso Kiselkov. All rights reserved.
  */
 
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef	__SSE2__
+#include <emmintrin.h>
+#endif
+
 #include <acfutils/assert.h>
+#include <acfutils/avl.h>
 #include <acfutils/helpers.h>
 
 #include "text_rendering.h"
@@ -46,17 +54,169 @@ static const struct {
 
 #define	LINE_MARGIN_MULTIPLIER	1.2
 
+/*
+ * Glyph cache. Every (face, pixel size) pair we've been asked to render
+ * with gets a glyph_set_t holding the metrics and a tightly packed copy
+ * of the 8-bit coverage bitmap of every character we've seen so far.
+ * This way FreeType is only invoked once per glyph per size and text
+ * measurement and rendering boil down to table lookups plus blits.
+ * Owners of an FT_Face must call text_cache_flush() before disposing
+ * of the face, so that a new face allocated at the same address can't
+ * pick up stale glyphs.
+ */
+#define	NUM_GLYPHS	256
+
+typedef struct {
+	bool_t		loaded;
+	unsigned	width;
+	unsigned	rows;
+	int		left;
+	int		top;
+	int		advance;
+	uint8_t		*bitmap;	/* width * rows bytes */
+} glyph_t;
+
+typedef struct {
+	FT_Face		face;
+	int		font_size;
+	glyph_t		glyphs[NUM_GLYPHS];
+	avl_node_t	node;
+} glyph_set_t;
+
+static bool_t glyph_sets_inited = B_FALSE;
+static avl_tree_t glyph_sets;
+
+static int
+glyph_set_compar(const void *a, const void *b)
+{
+	const glyph_set_t *ga = a, *gb = b;
+
+	if ((uintptr_t)ga->face < (uintptr_t)gb->face)
+		return (-1);
+	if ((uintptr_t)ga->face > (uintptr_t)gb->face)
+		return (1);
+	if (ga->font_size < gb->font_size)
+		return (-1);
+	if (ga->font_size > gb->font_size)
+		return (1);
+	return (0);
+}
+
+static glyph_set_t *
+glyph_set_get(FT_Face face, int font_size)
+{
+	glyph_set_t srch = { .face = face, .font_size = font_size };
+	glyph_set_t *gs;
+	avl_index_t where;
+
+	if (!glyph_sets_inited) {
+		avl_create(&glyph_sets, glyph_set_compar, sizeof (glyph_set_t),
+		    offsetof(glyph_set_t, node));
+		glyph_sets_inited = B_TRUE;
+	}
+
+	gs = avl_find(&glyph_sets, &srch, &where);
+	if (gs == NULL) {
+		gs = calloc(1, sizeof (*gs));
+		gs->face = face;
+		gs->font_size = font_size;
+		avl_insert(&glyph_sets, gs, where);
+	}
+
+	return (gs);
+}
+
+static void
+glyph_set_free(glyph_set_t *gs)
+{
+	for (int i = 0; i < NUM_GLYPHS; i++)
+		free(gs->glyphs[i].bitmap);
+	free(gs);
+}
+
+/*
+ * Returns the cached glyph for character `c', rasterizing it on first
+ * use. The glyph set's face must already be at the set's pixel size.
+ */
+static const glyph_t *
+glyph_get(glyph_set_t *gs, char c)
+{
+	glyph_t *g = &gs->glyphs[(uint8_t)c];
+	FT_GlyphSlot slot;
+	FT_Error err;
+
+	if (g->loaded)
+		return (g);
+
+	if ((err = FT_Load_Char(gs->face, (uint8_t)c, FT_LOAD_RENDER)) != 0) {
+		logMsg("Error rendering glyph for '%c': %d", c, err);
+		return (NULL);
+	}
+	slot = gs->face->glyph;
+	g->width = slot->bitmap.width;
+	g->rows = slot->bitmap.rows;
+	g->left = slot->bitmap_left;
+	g->top = slot->bitmap_top;
+	g->advance = slot->advance.x >> 6;
+	if (g->width * g->rows != 0) {
+		g->bitmap = malloc(g->width * g->rows);
+		for (unsigned row = 0; row < g->rows; row++) {
+			memcpy(&g->bitmap[row * g->width],
+			    &slot->bitmap.buffer[row * slot->bitmap.pitch],
+			    g->width);
+		}
+	}
+	g->loaded = B_TRUE;
+
+	return (g);
+}
+
+static glyph_set_t *
+glyph_set_prepare(FT_Face face, int font_size)
+{
+	FT_Error err;
+
+	if ((err = FT_Set_Pixel_Sizes(face, 0, font_size)) != 0) {
+		logMsg("Error setting font size to %d: %d", font_size, err);
+		return (NULL);
+	}
+	return (glyph_set_get(face, font_size));
+}
+
+/*
+ * Drops all cached glyphs of `face'. Must be called before the face is
+ * passed to FT_Done_Face.
+ */
+void
+text_cache_flush(FT_Face face)
+{
+	glyph_set_t *gs, *gs_next;
+
+	if (!glyph_sets_inited)
+		return;
+
+	for (gs = avl_first(&glyph_sets); gs != NULL; gs = gs_next) {
+		gs_next = AVL_NEXT(&glyph_sets, gs);
+		if (gs->face == face) {
+			avl_remove(&glyph_sets, gs);
+			glyph_set_free(gs);
+		}
+	}
+	if (avl_numnodes(&glyph_sets) == 0) {
+		avl_destroy(&glyph_sets);
+		glyph_sets_inited = B_FALSE;
+	}
+}
+
 bool_t
 get_text_block_size(const char *text, FT_Face face, int font_size,
     int *width, int *height)
 {
-	FT_Error err;
 	size_t h = font_size * LINE_MARGIN_MULTIPLIER, w = 0, line_w = 0;
+	glyph_set_t *gs;
 
-	if ((err = FT_Set_Pixel_Sizes(face, 0, font_size)) != 0) {
-		logMsg("Error setting font size to %d: %d", font_size, err);
+	if ((gs = glyph_set_prepare(face, font_size)) == NULL)
 		return (B_FALSE);
-	}
 
 	for (int i = 0, n = strlen(text); i < n; i++) {
 		if (text[i] == '\n') {
@@ -64,21 +224,11 @@ get_text_block_size(const char *text, FT_Face face, int font_size,
 			w = MAX(w, line_w);
 			line_w = 0;
 		} else {
-			FT_UInt glyph_index = FT_Get_Char_Index(face, text[i]);
+			const glyph_t *g = glyph_get(gs, text[i]);
 
-			if ((err = FT_Load_Glyph(face, glyph_index,
-			    FT_LOAD_DEFAULT)) != 0) {
-				logMsg("Error loading glyph for '%c': %d",
-				    text[i], err);
+			if (g == NULL)
 				return (B_FALSE);
-			}
-			if ((err = FT_Render_Glyph(face->glyph,
-			    FT_RENDER_MODE_NORMAL)) != 0) {
-				logMsg("Error rendering glyph for '%c': %d",
-				    text[i], err);
-				return (B_FALSE);
-			}
-			line_w += face->glyph->advance.x >> 6;
+			line_w += g->advance;
 		}
 	}
 	w = MAX(w, line_w);
@@ -89,23 +239,96 @@ get_text_block_size(const char *text, FT_Face face, int font_size,
 	return (B_TRUE);
 }
 
+/*
+ * Blends RGBA pixel channel `x' towards color channel `y' using coverage
+ * `a' (0..255) in exact integer arithmetic, rounding to nearest:
+ *	(x * (255 - a) + y * a + 127) / 255
+ * The division by 255 is computed as (v + 1 + (v >> 8)) >> 8, which is
+ * exact for all v < 65535 (our maximum is 255 * 255 + 127).
+ */
+#define	DIV255(v)		(((v) + 1 + ((v) >> 8)) >> 8)
+#define	BLEND_INT(x, y, a)	DIV255((x) * (255 - (a)) + (y) * (a) + 127)
+
+/*
+ * Blends one row of `n' glyph coverage values in `src' in color (r, g, b)
+ * over the RGBA pixels starting at `dst'.
+ */
+static void
+blend_row(uint8_t *dst, const uint8_t *src, unsigned n,
+    uint8_t r, uint8_t g, uint8_t b)
+{
+	unsigned i = 0;
+
+#ifdef	__SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c255 = _mm_set1_epi16(255);
+	const __m128i c127 = _mm_set1_epi16(127);
+	const __m128i c1 = _mm_set1_epi16(1);
+	const __m128i color = _mm_setr_epi16(r, g, b, 255, r, g, b, 255);
+
+	/* 4 pixels (16 bytes of RGBA) per iteration */
+	for (; i + 4 <= n; i += 4) {
+		uint32_t cov;
+		__m128i a, a_lo, a_hi, d, d_lo, d_hi;
+
+		memcpy(&cov, &src[i], sizeof (cov));
+		if (cov == 0)
+			continue;
+
+		/* replicate each coverage byte across its pixel's channels */
+		a = _mm_cvtsi32_si128(cov);
+		a = _mm_unpacklo_epi8(a, a);
+		a = _mm_unpacklo_epi16(a, a);
+		a_lo = _mm_unpacklo_epi8(a, zero);
+		a_hi = _mm_unpackhi_epi8(a, zero);
+
+		d = _mm_loadu_si128((const __m128i *)&dst[i * 4]);
+		d_lo = _mm_unpacklo_epi8(d, zero);
+		d_hi = _mm_unpackhi_epi8(d, zero);
+
+#define	BLEND_SSE2(d, a)	\
+	do { \
+		__m128i v = _mm_add_epi16(_mm_add_epi16( \
+		    _mm_mullo_epi16(d, _mm_sub_epi16(c255, a)), \
+		    _mm_mullo_epi16(color, a)), c127); \
+		v = _mm_add_epi16(_mm_add_epi16(v, c1), \
+		    _mm_srli_epi16(v, 8)); \
+		(d) = _mm_srli_epi16(v, 8); \
+	} while (0)
+		BLEND_SSE2(d_lo, a_lo);
+		BLEND_SSE2(d_hi, a_hi);
+#undef	BLEND_SSE2
+
+		_mm_storeu_si128((__m128i *)&dst[i * 4],
+		    _mm_packus_epi16(d_lo, d_hi));
+	}
+#endif	/* __SSE2__ */
+
+	for (; i < n; i++) {
+		unsigned a = src[i];
+		uint8_t *p = &dst[i * 4];
+
+		if (a == 0)
+			continue;
+		p[0] = BLEND_INT(p[0], r, a);
+		p[1] = BLEND_INT(p[1], g, a);
+		p[2] = BLEND_INT(p[2], b, a);
+		p[3] = BLEND_INT(p[3], 255, a);
+	}
+}
+
 static void
-blit_glyph(const FT_Bitmap *bitmap, uint8_t *rgba_texture,
+blit_glyph(const glyph_t *glyph, uint8_t *rgba_texture,
     unsigned tex_width, unsigned tex_height, unsigned x, unsigned y,
     uint8_t r, uint8_t g, uint8_t b)
 {
-	for (unsigned i = 0; i < bitmap->rows * bitmap->width; i++) {
-		unsigned gx = i % bitmap->width, gy = i / bitmap->width;
-		unsigned tex_coord = (((gy + y) * tex_width) + (gx + x)) * 4;
-
-		ASSERT(tex_coord < (tex_width * tex_height * 4));
-
-#define	BLEND_LIN(x, y, r)	(x) = (x) + ((y - x) * ((r) / 255.0))
-		BLEND_LIN(rgba_texture[tex_coord + 0], r, bitmap->buffer[i]);
-		BLEND_LIN(rgba_texture[tex_coord + 1], g, bitmap->buffer[i]);
-		BLEND_LIN(rgba_texture[tex_coord + 2], b, bitmap->buffer[i]);
-		BLEND_LIN(rgba_texture[tex_coord + 3], 255, bitmap->buffer[i]);
-#undef	BLEND_LIN
+	ASSERT3U(x + glyph->width, <=, tex_width);
+	ASSERT3U(y + glyph->rows, <=, tex_height);
+	UNUSED(tex_height);
+
+	for (unsigned gy = 0; gy < glyph->rows; gy++) {
+		blend_row(&rgba_texture[((gy + y) * tex_width + x) * 4],
+		    &glyph->bitmap[gy * glyph->width], glyph->width, r, g, b);
 	}
 }
 
@@ -114,39 +337,82 @@ render_text_block(const char *text, FT_Face face, int font_size, int x, int y,
     uint8_t r, uint8_t g, uint8_t b,
     uint8_t *rgba_texture, int texture_width, int texture_height)
 {
-	FT_Error err;
 	int start_x = x;
+	glyph_set_t *gs;
 
-	if ((err = FT_Set_Pixel_Sizes(face, 0, font_size)) != 0) {
-		logMsg("Error setting font size to %d: %d", font_size, err);
+	if ((gs = glyph_set_prepare(face, font_size)) == NULL)
 		return (B_FALSE);
-	}
 
 	for (int i = 0, n = strlen(text); i < n; i++) {
 		if (text[i] == '\n') {
 			y += font_size * LINE_MARGIN_MULTIPLIER;
 			x = start_x;
 		} else {
-			FT_GlyphSlot slot;
+			const glyph_t *glyph = glyph_get(gs, text[i]);
 
-			if ((err = FT_Load_Char(face, text[i],
-			    FT_LOAD_RENDER)) != 0) {
-				logMsg("Error rendering glyph for '%c': %d",
-				    text[i], err);
+			if (glyph == NULL)
 				return (B_FALSE);
+			if (glyph->bitmap != NULL) {
+				blit_glyph(glyph, rgba_texture,
+				    texture_width, texture_height,
+				    x + glyph->left, y - glyph->top, r, g, b);
 			}
-			slot = face->glyph;
-			blit_glyph(&slot->bitmap, rgba_texture,
-			    texture_width, texture_height,
-			    x + slot->bitmap_left, y - slot->bitmap_top,
-			    r, g, b);
-			x += face->glyph->advance.x >> 6;
+			x += glyph->advance;
 		}
 	}
 
 	return (B_TRUE);
 }
 
+/*
+ * Returns the size of a text box as rendered by render_text_box: the
+ * text block plus a `margin' pixel border on each side.
+ */
+bool_t
+get_text_box_size(const char *text, FT_Face face, int font_size, int margin,
+    int *width, int *height)
+{
+	if (!get_text_block_size(text, face, font_size, width, height))
+		return (B_FALSE);
+	*width += 2 * margin;
+	*height += 2 * margin;
+
+	return (B_TRUE);
+}
+
+/*
+ * Renders a text box into the (x, y, w, h) rectangle of an RGBA texture
+ * buffer. The rectangle is filled with a black background with opacity
+ * `bg_alpha' (0.0 - 1.0) and the text is drawn in color (r, g, b) inset
+ * by `margin' pixels. This is how both the ND alerts and the init
+ * messages are drawn.
+ */
+bool_t
+render_text_box(const char *text, FT_Face face, int font_size, int margin,
+    double bg_alpha, uint8_t r, uint8_t g, uint8_t b,
+    uint8_t *rgba_texture, int texture_width, int texture_height,
+    int x, int y, int w, int h)
+{
+	const uint8_t bg = (uint8_t)(255 * bg_alpha);
+
+	ASSERT3S(x + w, <=, texture_width);
+	ASSERT3S(y + h, <=, texture_height);
+
+	for (int row = y; row < y + h; row++) {
+		uint8_t *p = &rgba_texture[(row * texture_width + x) * 4];
+
+		memset(p, 0, w * 4);
+		if (bg != 0) {
+			for (int col = 0; col < w; col++)
+				p[col * 4 + 3] = bg;
+		}
+	}
+
+	return (render_text_block(text, face, font_size, x + margin,
+	    y + margin + font_size, r, g, b, rgba_texture, texture_width,
+	    texture_height));
+}
+
 const char *
 ft_err2str(FT_Error err)
 {
@@ -42,6 +42,13 @@ bool_t get_text_block_size(const char *text, FT_Face face, int font_size,
 bool_t render_text_block(const char *text, FT_Face face, int font_size,
     int x, int y, uint8_t r, uint8_t g, uint8_t b,
     uint8_t *rgba_texture, int texture_width, int texture_height);
+bool_t get_text_box_size(const char *text, FT_Face face, int font_size,
+    int margin, int *width, int *height);
+bool_t render_text_box(const char *text, FT_Face face, int font_size,
+    int margin, double bg_alpha, uint8_t r, uint8_t g, uint8_t b,
+    uint8_t *rgba_texture, int texture_width, int texture_height,
+    int x, int y, int w, int h);
+void text_cache_flush(FT_Face face);
 const char *ft_err2str(FT_Error err);
 
 #ifdef	__cplusplus
@@ -33,6 +33,7 @@
 #include <acfutils/assert.h>
 #include <acfutils/avl.h>
 #include <acfutils/conf.h>
+#include <acfutils/crc64.h>
 #include <acfutils/dr.h>
 #include <acfutils/geom.h>
 #include <acfutils/helpers.h>
@@ -43,14 +44,22 @@
 #include <acfutils/types.h>
 #include <acfutils/wav.h>
 
+#include "acf_drs.h"
+#include "acf_meta.h"
+#include "adc_rec.h"
 #include "airdata.h"
+#include "cfg_reload.h"
 #include "dbg_gui.h"
 #include "dbg_log.h"
 #include "gui.h"
 #include "init_msg.h"
+#include "journal.h"
 #include "nd_alert.h"
+#include "nd_overlays.h"
+#include "raw_trace.h"
 #include "rwy_key_tbl.h"
 #include "snd_sys.h"
+#include "stats.h"
 #include "xraas2.h"
 #include "xraas_cfg.h"
 
@@ -90,7 +99,6 @@
 #define	STOPPED_THRESH			2.06		/* m/s, 4 knots */
 
 #define	LANDING_ROLLOUT_TIME_FACT	1		/* seconds */
-#define	RADALT_GRD_THRESH		5		/* feet */
 #define	RADALT_FLARE_THRESH		100		/* feet */
 #define	RADALT_DEPART_THRESH		100		/* feet */
 #define	STARTUP_DELAY			3		/* seconds */
@@ -308,14 +316,26 @@ const char *xraas_acf_livpath = acf_livpath;
 const char *xraas_plugindir = plugindir;
 
 static dr_t sim_time_dr;
+static bool_t acf_drs_resolved = B_FALSE;
 
-static const char *FJS737[] = { "B732", NULL };
-static const char *IXEG737[] = { "B733", NULL };
-static const char *FF757_767[] = { "B752", "B753", "B763", NULL };
-static const char *FF777[] = { "B772", "B773", "B77L", "B77W", NULL };
-static const char *JAR[] = {
-	"A318", "A319", "A320", "A321", "A322", "A333", "A338", "A339", NULL
-};
+/*
+ * Passes the current air data sample & override values to the air data
+ * recorder.
+ */
+static void
+record_adc(void)
+{
+	adc_rec_ovrd_t ovrds[NUM_OVERRIDES];
+
+	for (int i = 0; i < NUM_OVERRIDES; i++) {
+		ovrds[i].name = overrides[i].name;
+		if (overrides[i].type == xplmType_Int)
+			ovrds[i].value = overrides[i].value_i;
+		else
+			ovrds[i].value = overrides[i].value_f;
+	}
+	adc_rec_sample(adc, ovrds, NUM_OVERRIDES);
+}
 
 static void
 overrides_init(void)
@@ -382,14 +402,12 @@ reset_airport_rwy_table(rwy_key_tbl_t *tbl, const airport_t *arpt)
 }
 
 /*
- * Converts an quantity which is calculated per execution cycle of X-RAAS
- * into a per-minute quantity, so the caller need not worry about X-RAAS
- * execution frequency.
+ * Returns the current (filtered) climb rate in feet per minute.
  */
 static double
-conv_per_min(double x)
+clb_rate_fpm(void)
 {
-	return (x * (60 / EXEC_INTVAL));
+	return (MET2FEET(adc_vs()) * 60);
 }
 
 /*
@@ -439,30 +457,6 @@ GPWS_has_priority(void)
 	    B_FALSE);
 }
 
-static bool_t
-chk_acf_dr(const char **icaos, const char *author, const char *drname)
-{
-	char icao[8];
-
-	memset(icao, 0, sizeof (icao));
-	XPLMGetDatab(drs->ICAO, icao, 0, sizeof (icao) - 1);
-
-	if (author != NULL) {
-		char acf_author[64];
-		memset(acf_author, 0, sizeof (acf_author));
-		XPLMGetDatab(drs->author, acf_author, 0,
-		    sizeof (acf_author) - 1);
-		if (strcmp(acf_author, author) != 0)
-			return (B_FALSE);
-	}
-
-	for (const char **icaos_i = icaos; *icaos_i != NULL; icaos_i++) {
-		if (strcmp(icao, *icaos_i) == 0)
-			return (XPLMFindDataRef(drname) != NULL);
-	}
-	return (B_FALSE);
-}
-
 /*
  * Checks if the aircraft has a terrain override mode on the GPWS and if it
  * does, returns true if it GPWS terrain warnings are overridden, otherwise
@@ -471,22 +465,12 @@ chk_acf_dr(const char **icaos, const char *author, const char *drname)
 static bool_t
 gpws_terr_ovrd(void)
 {
+	bool_t ovrd;
+
 	if (overrides[OVRD_GPWS_TERR_OVRD].value_i != 0) {
 		return (overrides[OVRD_GPWS_TERR_OVRD_ACT].value_i != 0);
-	} else if (chk_acf_dr(FF757_767, NULL, "anim/75/button")) {
-		return (XPLMGetDatai(XPLMFindDataRef("anim/75/button")) == 1);
-	} else if (chk_acf_dr(FF777, NULL, "anim/51/button")) {
-		return (XPLMGetDatai(XPLMFindDataRef("anim/51/button")) == 1);
-	} else if (chk_acf_dr(IXEG737, NULL, "ixeg/733/misc/egpws_gear_act")) {
-		return (XPLMGetDatai(XPLMFindDataRef(
-		    "ixeg/733/misc/egpws_gear_act")) == 1);
-	} else if (chk_acf_dr(FJS737, "FlyJsim",
-	    "FJS/732/Annun/GPWS_InhibitSwitch")) {
-		return (XPLMGetDatai(XPLMFindDataRef(
-		    "FJS/732/Annun/GPWS_InhibitSwitch")) == 1);
-	} else if (chk_acf_dr(JAR, NULL, "sim/custom/xap/gpws_terr")) {
-		return (XPLMGetDatai(XPLMFindDataRef(
-		    "sim/custom/xap/gpws_terr")) == 1);
+	} else if (acf_drs_terr_ovrd(&ovrd)) {
+		return (ovrd);
 	} else if (ff_a320_is_loaded()) {
 		return (ff_a320_inhibit() || ff_a320_inhibit_ex());
 	}
@@ -502,18 +486,12 @@ gpws_terr_ovrd(void)
 static bool_t
 gpws_flaps_ovrd(void)
 {
+	bool_t ovrd;
+
 	if (overrides[OVRD_GPWS_FLAPS_OVRD].value_i != 0) {
 		return (overrides[OVRD_GPWS_FLAPS_OVRD_ACT].value_i != 0);
-	} else if (chk_acf_dr(FF757_767, NULL, "anim/72/button")) {
-		return (XPLMGetDatai(XPLMFindDataRef("anim/72/button")) == 1);
-	} else if (chk_acf_dr(FF777, NULL, "anim/79/button")) {
-		return (XPLMGetDatai(XPLMFindDataRef("anim/79/button")) == 1);
-	} else if (chk_acf_dr(IXEG737, NULL, "ixeg/733/misc/egpws_flap_act")) {
-		return (XPLMGetDatai(XPLMFindDataRef(
-		    "ixeg/733/misc/egpws_flap_act")) == 1);
-	} else if (chk_acf_dr(JAR, NULL, "sim/custom/xap/gpws_flap")) {
-		return (XPLMGetDatai(XPLMFindDataRef(
-		    "sim/custom/xap/gpws_flap")) != 0);
+	} else if (acf_drs_flaps_ovrd(&ovrd)) {
+		return (ovrd);
 	} else if (ff_a320_is_loaded()) {
 		return (ff_a320_inhibit() || ff_a320_inhibit_flaps());
 	}
@@ -606,6 +584,8 @@ load_nearest_airports(void)
 	rwy_key_tbl_remove_distant(&state.apch_rwy_ann, state.cur_arpts);
 	rwy_key_tbl_remove_distant(&state.air_apch_rwy_ann, state.cur_arpts);
 
+	ND_alerts_prerender(state.cur_arpts);
+
 #ifdef	XRAAS_IS_EMBEDDED
 	if (ff_a320_is_loaded())
 		ff_a320_find_nearest_rwy();
@@ -804,6 +784,8 @@ do_approaching_rwy(const airport_t *arpt, const runway_t *rwy,
 	ASSERT(rwy != NULL);
 	ASSERT(end == 0 || end == 1);
 
+	journal_rwy(arpt->icao, rwy->ends[end].id);
+
 	rwy_end = &rwy->ends[end];
 	rwy_id = rwy_end->id;
 
@@ -948,6 +930,7 @@ ground_runway_approach_arpt(const airport_t *arpt, vect2_t vel_v)
 		if (ground_runway_approach_arpt_rwy(arpt, rwy, pos_v, vel_v))
 			in_prox++;
 	}
+	journal_rwy(NULL, NULL);
 
 	return (in_prox);
 }
@@ -1098,6 +1081,8 @@ on_rwy_check(const char *arpt_id, const char *rwy_id, double hdg,
 	ASSERT(arpt_id != NULL);
 	ASSERT(rwy_id != NULL);
 
+	journal_rwy(arpt_id, rwy_id);
+
 	/*
 	 * If we are not at all on the appropriate runway heading, don't
 	 * generate any annunciations.
@@ -1254,7 +1239,7 @@ static bool_t
 decel_check(double dist_rmng)
 {
 	double cur_gs = adc->gs;
-	double decel_rate = (cur_gs - state.last_gs) / EXEC_INTVAL;
+	double decel_rate = adc_accel();
 	if (decel_rate >= 0)
 		return (B_FALSE);
 	double t = cur_gs / (-decel_rate);
@@ -1319,6 +1304,8 @@ stop_check(const runway_t *rwy, int end, double hdg, vect2_t pos_v)
 	double dist = vect2_abs(vect2_sub(opp_thr_v, pos_v));
 	double rhdg = fabs(rel_hdg(hdg, rwy_end->hdg));
 
+	journal_rwy(arpt_id, rwy_end->id);
+
 	if (gs < SPEED_THRESH) {
 		/*
 		 * If there's very little runway remaining, we always want to
@@ -1337,8 +1324,7 @@ stop_check(const runway_t *rwy, int end, double hdg, vect2_t pos_v)
 		return;
 
 	if (adc->rad_alt > RADALT_GRD_THRESH) {
-		double clb_rate = conv_per_min(MET2FEET(adc->elev -
-		    state.last_elev));
+		double clb_rate = clb_rate_fpm();
 		stop_check_reset(arpt_id, rwy_end->id);
 		if (state.departed && adc->rad_alt <= RADALT_DEPART_THRESH &&
 		    clb_rate < GOAROUND_CLB_RATE_THRESH)
@@ -1437,6 +1423,7 @@ ground_on_runway_aligned_arpt(const airport_t *arpt)
 			stop_check_reset(arpt_id, rwy->ends[1].id);
 		}
 	}
+	journal_rwy(NULL, NULL);
 
 	return (on_rwy);
 }
@@ -1550,7 +1537,6 @@ gpa_limit(double rwy_gpa, double dist_from_thr)
 static double
 get_land_spd(bool_t *vref)
 {
-	double val;
 	enum { MIN_APPCH_SPD = 60 };
 
 	ASSERT(vref != NULL);
@@ -1580,30 +1566,8 @@ get_land_spd(bool_t *vref)
 			return (NAN);
 	}
 
-	/* FlightFactor 777 */
-	if (chk_acf_dr(FF777, NULL, "T7Avionics/fms/vref")) {
-		val = XPLMGetDatai(XPLMFindDataRef("T7Avionics/fms/vref"));
-		if (val < MIN_APPCH_SPD)
-			return (NAN);
-		*vref = B_FALSE;
-		return (val);
-	/* JARDesigns A320 & A330 */
-	} else if (chk_acf_dr(JAR, NULL, "sim/custom/xap/pfd/vappr_knots")) {
-		/* First try the Vapp, otherwise fall back to Vref */
-		val = XPLMGetDatai(XPLMFindDataRef(
-		    "sim/custom/xap/pfd/vappr_knots"));
-		if (val < MIN_APPCH_SPD) {
-			*vref = B_FALSE;
-			val = XPLMGetDatai(XPLMFindDataRef(
-			    "sim/custom/xap/pfd/vref_knots"));
-		} else {
-			*vref = B_TRUE;
-		}
-		if (val < MIN_APPCH_SPD)
-			return (NAN);
-		return (val);
-	}
-	return (NAN);
+	/* aircraft-specific FMS datarefs, see data/acf_drs.cfg */
+	return (acf_drs_land_spd(MIN_APPCH_SPD, vref));
 }
 
 /*
@@ -1728,7 +1692,7 @@ apch_cfg_chk(const char *arpt_id, const char *rwy_id, double height_abv_thr,
 	ASSERT(arpt_id != NULL);
 	ASSERT(rwy_id != NULL);
 
-	double clb_rate = conv_per_min(MET2FEET(adc->elev - state.last_elev));
+	double clb_rate = clb_rate_fpm();
 	int too_fast_mon, too_high_mon, flaps_mon;
 
 	if (upper_gate) {
@@ -1831,6 +1795,8 @@ air_runway_approach_arpt_rwy(const airport_t *arpt, const runway_t *rwy,
 	double rwy_hdg = rwy_end->hdg;
 	bool_t in_prox_bbox = point_in_poly(pos_v, rwy_end->apch_bbox);
 
+	journal_rwy(arpt_id, rwy_id);
+
 	if (in_prox_bbox && fabs(rel_hdg(hdg, rwy_hdg)) < HDG_ALIGN_THRESH) {
 		msg_type_t *msg = NULL;
 		size_t msg_len = 0;
@@ -1937,6 +1903,7 @@ air_runway_approach_arpt(const airport_t *arpt)
 		    point_in_poly(pos_v, rwy->rwy_bbox))
 			in_apch_bbox++;
 	}
+	journal_rwy(NULL, NULL);
 
 	return (in_apch_bbox);
 }
@@ -1948,7 +1915,7 @@ air_runway_approach(void)
 		return;
 
 	unsigned in_apch_bbox = 0;
-	double clb_rate = conv_per_min(MET2FEET(adc->elev - state.last_elev));
+	double clb_rate = clb_rate_fpm();
 
 	for (const airport_t *arpt = list_head(state.cur_arpts); arpt != NULL;
 	    arpt = list_next(state.cur_arpts, arpt))
@@ -2164,6 +2131,7 @@ altimeter_setting(void)
 		state.TATL_state = TATL_STATE_FL;
 		dbg_log(altimeter, 1, "baro_alt (%d) > TA (%d) transitioning "
 		    "state.TATL_state = fl", baro_alt, TA);
+		journal_tatl(TATL_STATE_FL, TA, state.TATL_source);
 	}
 
 	if (TL != 0 && baro_alt < TL && state.TATL_state == TATL_STATE_FL) {
@@ -2171,6 +2139,7 @@ altimeter_setting(void)
 		state.TATL_state = TATL_STATE_ALT;
 		dbg_log(altimeter, 1, "baro_alt (%d) < TL (%d) "
 		    "transitioning state.TATL_state = alt", baro_alt, TL);
+		journal_tatl(TATL_STATE_ALT, TL, state.TATL_source);
 	}
 
 	if (state.TATL_transition != -1) {
@@ -2227,6 +2196,21 @@ altimeter_setting(void)
 	}
 }
 
+/*
+ * Returns the full path to a file named `name' in our cache directory.
+ * The caller is responsible for freeing the returned string.
+ */
+char *
+xraas_cache_path(const char *name)
+{
+#ifdef	XRAAS_IS_EMBEDDED
+	return (mkpathname(xraas_plugindir, XRAAS_CACHE_DIR, name, NULL));
+#else	/* !XRAAS_IS_EMBEDDED */
+	return (mkpathname(xpdir, "Output", "caches", XRAAS_CACHE_DIR, name,
+	    NULL));
+#endif	/* !XRAAS_IS_EMBEDDED */
+}
+
 /*
  * Returns true if X-RAAS has electrical power from the aircraft.
  */
@@ -2253,26 +2237,54 @@ xraas_is_on(void)
 	return (turned_on || state.config.override_electrical);
 }
 
+/*
+ * Binds the aircraft-specific datarefs (see acf_drs.c) of the loaded
+ * aircraft.
+ */
+static void
+resolve_acf_drs(void)
+{
+	char icao[8], author[64];
+
+	memset(icao, 0, sizeof (icao));
+	memset(author, 0, sizeof (author));
+	XPLMGetDatab(drs->ICAO, icao, 0, sizeof (icao) - 1);
+	XPLMGetDatab(drs->author, author, 0, sizeof (author) - 1);
+	acf_drs_resolve(icao, author);
+}
+
 static void
 raas_exec(void)
 {
+	uint64_t t;
+
 	dbg_log(pwr_state, 3, "raas_exec");
 
 	if (dr_getf(&sim_time_dr) < state.inited_time + STARTUP_DELAY) {
 		dbg_log(pwr_state, 1, "init delay");
 		return;
 	}
+	if (!acf_drs_resolved) {
+		/* by now the aircraft's plugins have created their datarefs */
+		resolve_acf_drs();
+		acf_drs_resolved = B_TRUE;
+	}
 
 	/*
 	 * Ahead of the enabling check so that we can provide sensible runway
 	 * info in the embedded FF A320 case.
 	 */
+	t = stats_start();
 	state.input_faulted = !adc_collect();
+	stats_end(STATS_ADC_COLLECT, t);
 	if (state.input_faulted) {
 		dbg_log(pwr_state, 1, "input_fault = true");
 		return;
 	}
+	record_adc();
+	t = stats_start();
 	load_nearest_airports();
+	stats_end(STATS_LOAD_NEAREST_ARPTS, t);
 
 #ifdef	XRAAS_IS_EMBEDDED
 	if (plugin_conflict) {
@@ -2342,30 +2354,44 @@ raas_exec(void)
 		state.long_landing_ann = B_FALSE;
 	}
 
+	t = stats_start();
 	ground_runway_approach();
+	stats_end(STATS_GND_RWY_APCH, t);
+	t = stats_start();
 	ground_on_runway_aligned();
+	stats_end(STATS_GND_ON_RWY, t);
+	t = stats_start();
 	air_runway_approach();
+	stats_end(STATS_AIR_RWY_APCH, t);
+	t = stats_start();
 	altimeter_setting();
+	stats_end(STATS_ALTM_SETTING, t);
 
 	if (adc->rad_alt > RADALT_DEPART_THRESH) {
 		for (int i = 0; !isnan(accel_stop_distances[i].min); i++)
 			accel_stop_distances[i].ann = B_FALSE;
 	}
 
-	state.last_elev = adc->elev;
-	state.last_gs = adc->gs;
+	journal_flt_state((state.departed ? JOURNAL_FLT_DEPARTED : 0) |
+	    (state.arriving ? JOURNAL_FLT_ARRIVING : 0) |
+	    (state.landing ? JOURNAL_FLT_LANDING : 0));
 }
 
 static float
 raas_exec_cb(float elapsed_since_last_call, float elapsed_since_last_floop,
     int counter, void *refcon)
 {
+	uint64_t t;
+
 	UNUSED(elapsed_since_last_call);
 	UNUSED(elapsed_since_last_floop);
 	UNUSED(counter);
 	UNUSED(refcon);
 
+	t = stats_start();
 	raas_exec();
+	stats_end(STATS_RAAS_EXEC, t);
+	stats_publish();
 
 	return (EXEC_INTVAL);
 }
@@ -2379,24 +2405,9 @@ raas_exec_cb(float elapsed_since_last_call, float elapsed_since_last_floop,
 static bool_t
 chk_acf_is_helo(void)
 {
-	FILE *fp = fopen(acf_path, "r");
-	char *line = NULL;
-	size_t linecap = 0;
-	bool_t result = B_FALSE;
-
-	if (fp != NULL) {
-		while (!feof(fp)) {
-			if (getline(&line, &linecap, fp) <= 0)
-				continue;
-			if (strstr(line, "P acf/_fly_like_a_helo") == line) {
-				result = (strstr(line,
-				    "P acf/_fly_like_a_helo 1") == line);
-				break;
-			}
-		}
-	}
-	free(line);
-	return (result);
+	acf_meta_t meta;
+
+	return (acf_meta_get(acf_path, &meta) && meta.is_helo);
 }
 #endif	/* ACF_TYPE == NO_ACF_TYPE */
 
@@ -2414,9 +2425,11 @@ void
 xraas_init(void)
 {
 	bool_t airportdb_created = B_FALSE;
+	bool_t adc_inited = B_FALSE;
 	char *sep;
 	char livpath[1024];
 	char *cachedir;
+	char acf_icao[8];
 
 	ASSERT(!xraas_inited);
 
@@ -2451,6 +2464,7 @@ xraas_init(void)
 	snprintf(acf_livpath, sizeof (acf_livpath), "%s%c%s", xpdir,
 	    DIRSEP, livpath);
 
+	cfg_reload_watch();
 	if (!load_configs(&state))
 		return;
 
@@ -2468,18 +2482,18 @@ xraas_init(void)
 #endif
 	}
 
+	if (state.config.debug_async_log)
+		dbg_log_async_init();
+	raw_trace_init();
+
 	if (!snd_sys_init(plugindir) || !ND_alerts_init() || !adc_init())
 		goto errout;
+	adc_inited = B_TRUE;
 
 	if (state.config.debug_graphical)
 		dbg_gui_init();
 
-#ifdef	XRAAS_IS_EMBEDDED
-	cachedir = mkpathname(xraas_plugindir, XRAAS_CACHE_DIR, NULL);
-#else	/* !XRAAS_IS_EMBEDDED */
-	cachedir = mkpathname(xpdir, "Output", "caches", XRAAS_CACHE_DIR,
-	    NULL);
-#endif	/* !XRAAS_IS_EMBEDDED */
+	cachedir = xraas_cache_path(NULL);
 	airportdb_create(&state.airportdb, xpdir, cachedir);
 	airportdb_created = B_TRUE;
 	free(cachedir);
@@ -2516,6 +2530,10 @@ xraas_init(void)
 	}
 #endif	/* ACF_TYPE == NO_ACF_TYPE */
 
+	memset(acf_icao, 0, sizeof (acf_icao));
+	XPLMGetDatab(drs->ICAO, acf_icao, 0, sizeof (acf_icao) - 1);
+	journal_init(acf_icao);
+	adc_rec_init();
 	rwy_key_tbl_create(&state.accel_stop_max_spd, "accel_stop_max_spd");
 	rwy_key_tbl_create(&state.on_rwy_ann, "on_rwy_ann");
 	rwy_key_tbl_create(&state.apch_rwy_ann, "apch_rwy_ann");
@@ -2552,6 +2570,10 @@ errout:
 	if (airportdb_created)
 		airportdb_destroy(&state.airportdb);
 	ND_alerts_fini();
+	if (adc_inited)
+		adc_fini();
+	raw_trace_fini();
+	dbg_log_async_fini();
 }
 
 void
@@ -2577,7 +2599,11 @@ xraas_fini(void)
 	airportdb_destroy(&state.airportdb);
 
 	ND_alerts_fini();
+	adc_rec_fini();
 	adc_fini();
+	acf_drs_fini();
+	journal_fini();
+	acf_drs_resolved = B_FALSE;
 
 	rwy_key_tbl_destroy(&state.accel_stop_max_spd);
 	rwy_key_tbl_destroy(&state.on_rwy_ann);
@@ -2599,16 +2625,76 @@ xraas_fini(void)
 		dbg_gui_fini();
 
 	dr_delete(&input_faulted_dr);
+	raw_trace_fini();
+	dbg_log_async_fini();
 
 	xraas_inited = B_FALSE;
 }
 
+/*
+ * Switches over to a new configuration (see cfg_reload.c). The new config
+ * replaces the old one in a single step between two flight loops, so the
+ * monitors never see a mix of the two. Only the subsystems which pick up
+ * their settings at init time and whose settings have changed are
+ * re-initialized. Changes which affect our startup go through a full
+ * xraas_fini & xraas_init. `origin' tells which file supplied each
+ * value, for the debug log.
+ */
+void
+xraas_config_apply(const xraas_config_t *config, const debug_config_t *dbg,
+    const config_origin_t *origin)
+{
+	unsigned reinit;
+
+	if (!xraas_inited) {
+		/* the new config might have enabled us or fixed an error */
+		xraas_init();
+		return;
+	}
+
+	reinit = config_reinit_flags(&state.config, config);
+	dbg_log(config, 1, "applying new config, reinit %x", reinit);
+	if (reinit & CONFIG_REINIT_ALL) {
+		xraas_fini();
+		xraas_init();
+		return;
+	}
+
+	if (reinit & CONFIG_REINIT_SND)
+		snd_sys_fini();
+	if (reinit & CONFIG_REINIT_ND_ALERTS)
+		ND_alerts_fini();
+	if (reinit & CONFIG_REINIT_DBG_GUI)
+		dbg_gui_fini();
+
+	state.config = *config;
+	xraas_debug_config = *dbg;
+	snd_sys_set_shared(state.config.openal_shared);
+	config_origin_log(origin);
+
+	if (((reinit & CONFIG_REINIT_SND) && !snd_sys_init(plugindir)) ||
+	    ((reinit & CONFIG_REINIT_ND_ALERTS) && !ND_alerts_init())) {
+		xraas_fini();
+		xraas_init();
+		return;
+	}
+	if ((reinit & CONFIG_REINIT_ND_ALERTS) && state.cur_arpts != NULL)
+		ND_alerts_prerender(state.cur_arpts);
+	if ((reinit & CONFIG_REINIT_DBG_GUI) && state.config.debug_graphical)
+		dbg_gui_init();
+}
+
 PLUGIN_API int
 XPluginStart(char *outName, char *outSig, char *outDesc)
 {
 	char *p;
 
 	log_init(XPLMDebugString, XRAAS2_PLUGIN_NAME);
+	/*
+	 * The CRC table is shared by all threads, so it must be set up
+	 * once, before any of them start (see cfg_reload.c).
+	 */
+	crc64_init();
 
 	/* Always use Unix-native paths on the Mac! */
 	XPLMEnableFeature("XPLM_USE_NATIVE_PATHS", 1);
@@ -2722,12 +2808,16 @@ PLUGIN_API void
 XPluginStop(void)
 {
 	overrides_fini();
+	ND_overlays_fini();
+	acf_meta_fini();
 	init_msg_sys_fini();
 }
 
 PLUGIN_API int
 XPluginEnable(void)
 {
+	stats_init();
+	cfg_reload_init();
 	xraas_init();
 	gui_init();
 	return (1);
@@ -2738,6 +2828,8 @@ XPluginDisable(void)
 {
 	gui_fini();
 	xraas_fini();
+	cfg_reload_fini();
+	stats_fini();
 }
 
 PLUGIN_API void
@@ -34,6 +34,7 @@ extern "C" {
 #define	TATL_FIELD_ELEV_UNSET		-1000000
 #define	RWY_PROXIMITY_TIME_FACT		2		/* seconds */
 #define	ARPT_LOAD_LIMIT			NM2MET(8)	/* meters */
+#define	RADALT_GRD_THRESH		5		/* feet */
 
 typedef enum TATL_state_e {
 	TATL_STATE_ALT,
@@ -75,65 +76,77 @@ enum {
 	NUM_MONITORS
 };
 
+typedef struct {
+	bool_t	enabled;
+
+	int		min_engines;		/* count */
+	int		min_mtow;		/* kg */
+	bool_t		allow_helos;
+	bool_t		auto_disable_notify;
+	bool_t		startup_notify;
+	bool_t		override_electrical;
+	bool_t		override_replay;
+	bool_t		use_tts;
+	bool_t		speak_units;
+	bool_t		use_imperial;
+
+	/* monitor enablings */
+	bool_t		monitors[NUM_MONITORS];
+
+	int		min_takeoff_dist;	/* meters */
+	int		min_landing_dist;	/* meters */
+	int		min_rotation_dist;	/* meters */
+	double		min_rotation_angle;	/* degrees */
+	int		stop_dist_cutoff;	/* meters */
+	bool_t		voice_female;
+	double		voice_volume;
+	bool_t		disable_ext_view;
+
+	double		min_landing_flap;	/* ratio, 0-1 */
+	double		min_takeoff_flap;	/* ratio, 0-1 */
+	double		max_takeoff_flap;	/* ratio, 0-1 */
+
+	bool_t		nd_alerts_enabled;
+	int		nd_alert_filter;	/* nd_alert_level_t */
+	bool_t		nd_alert_overlay_enabled;
+	bool_t		nd_alert_overlay_force;
+	int		nd_alert_timeout;		/* seconds */
+	char		nd_alert_overlay_font[MAX_PATH]; /* file name */
+	int		nd_alert_overlay_font_size; /* pixel value */
+
+	int		on_rwy_warn_initial;	/* seconds */
+	int		on_rwy_warn_repeat;	/* seconds */
+	int		on_rwy_warn_max_n;	/* count */
+
+	double		gpa_limit_mult;		/* multiplier */
+	double		gpa_limit_max;		/* degrees */
+
+	char		GPWS_priority_dataref[128];
+	char		GPWS_inop_dataref[128];
+
+	char		adc_backend[32];	/* "" = auto */
+	char		adc_replay_file[MAX_PATH];
+	bool_t		adc_rec;
+
+	bool_t		journal;
+
+	bool_t		raw_trace;
+	int		raw_trace_size;		/* MiB */
+
+	bool_t		us_runway_numbers;
+
+	bool_t		say_deep_landing;	/* Say 'DEEP landing' */
+	int		long_land_lim_abs;	/* meters */
+	double		long_land_lim_fract;	/* fraction, 0-1 */
+
+	bool_t		openal_shared;
+	bool_t		debug_graphical;
+	bool_t		debug_async_log;
+	bool_t		debug;
+} xraas_config_t;
+
 typedef struct xraas_state {
-	struct {
-		bool_t	enabled;
-
-		int		min_engines;		/* count */
-		int		min_mtow;		/* kg */
-		bool_t		allow_helos;
-		bool_t		auto_disable_notify;
-		bool_t		startup_notify;
-		bool_t		override_electrical;
-		bool_t		override_replay;
-		bool_t		use_tts;
-		bool_t		speak_units;
-		bool_t		use_imperial;
-
-		/* monitor enablings */
-		bool_t		monitors[NUM_MONITORS];
-
-		int		min_takeoff_dist;	/* meters */
-		int		min_landing_dist;	/* meters */
-		int		min_rotation_dist;	/* meters */
-		double		min_rotation_angle;	/* degrees */
-		int		stop_dist_cutoff;	/* meters */
-		bool_t		voice_female;
-		double		voice_volume;
-		bool_t		disable_ext_view;
-
-		double		min_landing_flap;	/* ratio, 0-1 */
-		double		min_takeoff_flap;	/* ratio, 0-1 */
-		double		max_takeoff_flap;	/* ratio, 0-1 */
-
-		bool_t		nd_alerts_enabled;
-		int		nd_alert_filter;	/* nd_alert_level_t */
-		bool_t		nd_alert_overlay_enabled;
-		bool_t		nd_alert_overlay_force;
-		int		nd_alert_timeout;		/* seconds */
-		char		nd_alert_overlay_font[MAX_PATH]; /* file name */
-		int		nd_alert_overlay_font_size; /* pixel value */
-
-		int		on_rwy_warn_initial;	/* seconds */
-		int		on_rwy_warn_repeat;	/* seconds */
-		int		on_rwy_warn_max_n;	/* count */
-
-		double		gpa_limit_mult;		/* multiplier */
-		double		gpa_limit_max;		/* degrees */
-
-		char		GPWS_priority_dataref[128];
-		char		GPWS_inop_dataref[128];
-
-		bool_t		us_runway_numbers;
-
-		bool_t		say_deep_landing;	/* Say 'DEEP landing' */
-		int		long_land_lim_abs;	/* meters */
-		double		long_land_lim_fract;	/* fraction, 0-1 */
-
-		bool_t		openal_shared;
-		bool_t		debug_graphical;
-		bool_t		debug;
-	} config;
+	xraas_config_t	config;
 
 	bool_t		input_faulted;	/* when adc_collect failed */
 	double		inited_time;	/* when we started up in sim time */
@@ -177,8 +190,6 @@ typedef struct xraas_state {
 	char		TATL_source[8];
 
 	bool_t		view_is_ext;
-	double		last_elev;			/* in meters */
-	double		last_gs;			/* in m/s */
 	uint64_t	last_units_call;		/* microclock time */
 
 	list_t		*cur_arpts;
@@ -200,6 +211,7 @@ bool_t xraas_is_on(void);
 bool_t view_is_external(void);
 bool_t GPWS_has_priority(void);
 vect2_t acf_vel_vector(double time_fact);
+char *xraas_cache_path(const char *name);
 
 const airport_t *find_nearest_curarpt(void);
 
@@ -15,9 +15,13 @@
  * Copyright 2017 Saso Kiselkov. All rights reserved.
  */
 
+#include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+#include <acfutils/assert.h>
+#include <acfutils/crc64.h>
 #include <acfutils/helpers.h>
 #include <acfutils/log.h>
 #include <acfutils/wav.h>
@@ -57,77 +61,85 @@ const char *const monitor_conf_keys[NUM_MONITORS] = {
 	"late_rotation_mon"		/* LATE_ROTATION_MON */
 };
 
+const char *const config_layer_names[NUM_CONFIG_LAYERS] = {
+	"default",	/* CONFIG_LAYER_DEFAULT */
+	"global",	/* CONFIG_LAYER_GLOBAL */
+	"aircraft",	/* CONFIG_LAYER_ACF */
+	"livery"	/* CONFIG_LAYER_LIVERY */
+};
+
 static void
-reset_config(xraas_state_t *state)
+reset_config(xraas_config_t *config, debug_config_t *dbg)
 {
-	memset(&state->config, 0, sizeof (state->config));
+	memset(config, 0, sizeof (*config));
 
 	/*
 	 * No need to set B_FALSE/zero values here, since the config has
 	 * already been bzero'ed.
 	 */
-	state->config.enabled = B_TRUE;
-	state->config.min_engines = 2;
-	state->config.min_mtow = 5700;
-	state->config.auto_disable_notify = B_TRUE;
-	state->config.startup_notify = B_TRUE;
-	state->config.use_imperial = B_TRUE;
-	state->config.voice_female = B_TRUE;
-	state->config.voice_volume = 1.0;
-	state->config.min_takeoff_dist = 1000;
-	state->config.min_landing_dist = 800;
-	state->config.min_rotation_dist = 400;
-	state->config.min_rotation_angle = 3;
-	state->config.stop_dist_cutoff = 1600;
-	state->config.min_landing_flap = 0.5;
-	state->config.min_takeoff_flap = 0.1;
-	state->config.max_takeoff_flap = 0.75;
-	state->config.on_rwy_warn_initial = 60;
-	state->config.on_rwy_warn_repeat = 120;
-	state->config.on_rwy_warn_max_n = 3;
-	state->config.gpa_limit_mult = 2;
-	state->config.gpa_limit_max = 8;
-	state->config.disable_ext_view = B_TRUE;
-	state->config.speak_units = B_TRUE;
-	state->config.long_land_lim_abs = 610;	/* 2000 feet */
-	state->config.long_land_lim_fract = 0.25;
-	state->config.nd_alert_filter = ND_ALERT_ROUTINE;
+	config->enabled = B_TRUE;
+	config->min_engines = 2;
+	config->min_mtow = 5700;
+	config->auto_disable_notify = B_TRUE;
+	config->startup_notify = B_TRUE;
+	config->use_imperial = B_TRUE;
+	config->voice_female = B_TRUE;
+	config->voice_volume = 1.0;
+	config->min_takeoff_dist = 1000;
+	config->min_landing_dist = 800;
+	config->min_rotation_dist = 400;
+	config->min_rotation_angle = 3;
+	config->stop_dist_cutoff = 1600;
+	config->min_landing_flap = 0.5;
+	config->min_takeoff_flap = 0.1;
+	config->max_takeoff_flap = 0.75;
+	config->on_rwy_warn_initial = 60;
+	config->on_rwy_warn_repeat = 120;
+	config->on_rwy_warn_max_n = 3;
+	config->gpa_limit_mult = 2;
+	config->gpa_limit_max = 8;
+	config->disable_ext_view = B_TRUE;
+	config->speak_units = B_TRUE;
+	config->long_land_lim_abs = 610;	/* 2000 feet */
+	config->long_land_lim_fract = 0.25;
+	config->nd_alert_filter = ND_ALERT_ROUTINE;
 #if	ACF_TYPE != FF_A320_ACF_TYPE
-	state->config.nd_alerts_enabled = B_TRUE;
-	state->config.nd_alert_overlay_enabled = B_TRUE;
+	config->nd_alerts_enabled = B_TRUE;
+	config->nd_alert_overlay_enabled = B_TRUE;
 #endif	/* ACF_TYPE != FF_A320_ACF_TYPE */
-	state->config.nd_alert_timeout = 7;
-	strlcpy(state->config.nd_alert_overlay_font,
+	config->nd_alert_timeout = 7;
+	config->raw_trace_size = 64;
+	strlcpy(config->nd_alert_overlay_font,
 	    ND_alert_overlay_default_font,
-	    sizeof (state->config.nd_alert_overlay_font));
-	state->config.nd_alert_overlay_font_size =
+	    sizeof (config->nd_alert_overlay_font));
+	config->nd_alert_overlay_font_size =
 	    ND_alert_overlay_default_font_size;
 
 	for (int i = 0; i < NUM_MONITORS; i++) {
-		state->config.monitors[i] = B_TRUE;
+		config->monitors[i] = B_TRUE;
 #if	ACF_TYPE == FF_A320_ACF_TYPE
 		if (i == ON_RWY_FLAP_MON)
-			state->config.monitors[i] = B_FALSE;
+			config->monitors[i] = B_FALSE;
 #endif	/* ACF_TYPE == FF_A320_ACF_TYPE */
 	}
 
 	/* The QFE monitor is the exception - off by default */
-	state->config.monitors[ALTM_QFE_MON] = B_FALSE;
+	config->monitors[ALTM_QFE_MON] = B_FALSE;
 
-	memset(&xraas_debug_config, 0, sizeof (xraas_debug_config));
+	memset(dbg, 0, sizeof (*dbg));
 
-	strlcpy(state->config.GPWS_priority_dataref,
+	strlcpy(config->GPWS_priority_dataref,
 	    "sim/cockpit2/annunciators/GPWS",
-	    sizeof (state->config.GPWS_priority_dataref));
-	strlcpy(state->config.GPWS_inop_dataref,
+	    sizeof (config->GPWS_priority_dataref));
+	strlcpy(config->GPWS_inop_dataref,
 	    "sim/cockpit/warnings/annunciators/GPWS",
-	    sizeof (state->config.GPWS_inop_dataref));
+	    sizeof (config->GPWS_inop_dataref));
 
 
 #if	ACF_TYPE == FF_A320_ACF_TYPE
 	/* Tuned defaults for the A320 */
-	state->config.min_landing_dist = 1100;
-	state->config.min_takeoff_dist = 1500;
+	config->min_landing_dist = 1100;
+	config->min_takeoff_dist = 1500;
 #endif	/* FF_A320_ACF_TYPE */
 }
 
@@ -137,21 +149,68 @@ reset_state(xraas_state_t *state)
 	state->on_rwy_timer = -1;
 	state->TATL_field_elev = TATL_FIELD_ELEV_UNSET;
 	state->TATL_transition = -1;
-	reset_config(state);
+}
+
+/*
+ * Records that config key `key' was supplied by config layer `layer'.
+ */
+static void
+set_origin(config_origin_t *origin, const char *key, config_layer_t layer)
+{
+	uint32_t i;
+
+	ASSERT3U(strlen(key), <, CONFIG_KEY_LEN);
+	for (i = 0; i < origin->n_keys; i++) {
+		if (strcmp(origin->keys[i].key, key) == 0)
+			break;
+	}
+	if (i == origin->n_keys) {
+		VERIFY3U(origin->n_keys, <, CONFIG_MAX_KEYS);
+		strlcpy(origin->keys[i].key, key, CONFIG_KEY_LEN);
+		origin->n_keys++;
+	}
+	origin->keys[i].layer = layer;
+}
+
+/*
+ * Returns the config layer which supplied config key `key'.
+ */
+config_layer_t
+config_origin_layer(const config_origin_t *origin, const char *key)
+{
+	for (uint32_t i = 0; i < origin->n_keys; i++) {
+		if (strcmp(origin->keys[i].key, key) == 0)
+			return (origin->keys[i].layer);
+	}
+	return (CONFIG_LAYER_DEFAULT);
+}
+
+/*
+ * Logs which config layer supplied each config key (debug_config = 1).
+ */
+void
+config_origin_log(const config_origin_t *origin)
+{
+	for (uint32_t i = 0; i < origin->n_keys; i++) {
+		dbg_log(config, 1, "%s: from %s config", origin->keys[i].key,
+		    config_layer_names[origin->keys[i].layer]);
+	}
 }
 
 static void
-process_conf(xraas_state_t *state, conf_t *conf)
+process_conf(xraas_config_t *config, debug_config_t *dbg,
+    config_origin_t *origin, config_layer_t layer, conf_t *conf)
 {
 	const char *str;
 
 #define	CONF_GET(type, varname) \
 	do { \
 		/* first try the new name, then the old one */ \
-		if (!conf_get_ ## type(conf, #varname, \
-		    &state->config.varname)) \
-			(void) conf_get_ ## type(conf, "raas_" #varname, \
-			    &state->config.varname); \
+		if (conf_get_ ## type(conf, #varname, \
+		    &config->varname) || \
+		    conf_get_ ## type(conf, "raas_" #varname, \
+		    &config->varname)) \
+			set_origin(origin, #varname, layer); \
 	} while (0)
 	CONF_GET(b, enabled);
 	CONF_GET(b, allow_helos);
@@ -192,9 +251,15 @@ process_conf(xraas_state_t *state, conf_t *conf)
 	CONF_GET(b, nd_alert_overlay_force);
 	CONF_GET(i, nd_alert_timeout);
 	CONF_GET(b, debug_graphical);
+	CONF_GET(b, debug_async_log);
+	CONF_GET(b, journal);
+	CONF_GET(b, raw_trace);
+	CONF_GET(i, raw_trace_size);
+	CONF_GET(b, adc_rec);
 	if (conf_get_str(conf, "nd_alert_overlay_font", &str)) {
-		strlcpy(state->config.nd_alert_overlay_font, str,
-		    sizeof (state->config.nd_alert_overlay_font));
+		strlcpy(config->nd_alert_overlay_font, str,
+		    sizeof (config->nd_alert_overlay_font));
+		set_origin(origin, "nd_alert_overlay_font", layer);
 	}
 	CONF_GET(i, nd_alert_overlay_font_size);
 #undef	CONF_GET
@@ -205,29 +270,46 @@ process_conf(xraas_state_t *state, conf_t *conf)
 			continue;
 #endif	/* ACF_TYPE == FF_A320_ACF_TYPE */
 		if (conf_get_b(conf, monitor_conf_keys[i],
-		    &state->config.monitors[i])) {
+		    &config->monitors[i])) {
 			int l = strlen(monitor_conf_keys[i]) + 6;
 			char buf[l];
 			snprintf(buf, l, "raas_%s", monitor_conf_keys[i]);
 			(void) conf_get_b(conf, buf,
-			    &state->config.monitors[i]);
+			    &config->monitors[i]);
+			set_origin(origin, monitor_conf_keys[i], layer);
 		}
 	}
 
-	if (conf_get_b(conf, "openal_shared", &state->config.openal_shared))
-		snd_sys_set_shared(state->config.openal_shared);
-	else
-		snd_sys_set_shared(B_FALSE);
+	if (conf_get_b(conf, "openal_shared", &config->openal_shared))
+		set_origin(origin, "openal_shared", layer);
 
-	if (conf_get_str(conf, "gpws_prio_dr", &str))
-		strlcpy(state->config.GPWS_priority_dataref, str,
-		    sizeof (state->config.GPWS_priority_dataref));
-	if (conf_get_str(conf, "gpws_inop_dr", &str))
-		strlcpy(state->config.GPWS_inop_dataref, str,
-		    sizeof (state->config.GPWS_inop_dataref));
+	if (conf_get_str(conf, "gpws_prio_dr", &str)) {
+		strlcpy(config->GPWS_priority_dataref, str,
+		    sizeof (config->GPWS_priority_dataref));
+		set_origin(origin, "gpws_prio_dr", layer);
+	}
+	if (conf_get_str(conf, "gpws_inop_dr", &str)) {
+		strlcpy(config->GPWS_inop_dataref, str,
+		    sizeof (config->GPWS_inop_dataref));
+		set_origin(origin, "gpws_inop_dr", layer);
+	}
+
+	if (conf_get_str(conf, "adc_backend", &str)) {
+		strlcpy(config->adc_backend, str,
+		    sizeof (config->adc_backend));
+		set_origin(origin, "adc_backend", layer);
+	}
+	if (conf_get_str(conf, "adc_replay_file", &str)) {
+		strlcpy(config->adc_replay_file, str,
+		    sizeof (config->adc_replay_file));
+		set_origin(origin, "adc_replay_file", layer);
+	}
 
 #define	CONF_GET_DEBUG(value) \
-	conf_get_i(conf, "debug_" #value, &xraas_debug_config.value)
+	do { \
+		if (conf_get_i(conf, "debug_" #value, &dbg->value)) \
+			set_origin(origin, "debug_" #value, layer); \
+	} while (0)
 	CONF_GET_DEBUG(all);
 	CONF_GET_DEBUG(altimeter);
 	CONF_GET_DEBUG(ann_state);
@@ -245,37 +327,34 @@ process_conf(xraas_state_t *state, conf_t *conf)
 	CONF_GET_DEBUG(wav);
 	CONF_GET_DEBUG(adc);
 	CONF_GET_DEBUG(ff_a320);
+	CONF_GET_DEBUG(journal);
 #undef	CONF_GET_DEBUG
 }
 
 /*
- * Loads a config file at path `cfgname' if it exists. If the file doesn't
- * exist, this function just returns true. If the config file contains errors,
- * this function shows an init message and returns false, otherwise it returns
- * true.
+ * Parses the config file in directory `dirname' into `config' & `dbg', if
+ * the file exists, and records the keys it sets as coming from `layer'.
+ * Returns false and the line number in `errline' if the file contains a
+ * syntax error.
  */
 static bool_t
-load_config(xraas_state_t *state, const char *dirname)
+parse_config(xraas_config_t *config, debug_config_t *dbg,
+    config_origin_t *origin, config_layer_t layer, const char *dirname,
+    int *errline)
 {
 	char *cfgname = mkpathname(dirname, "X-RAAS.cfg", NULL);
 	FILE *cfg_f = fopen(cfgname, "r");
 
 	if (cfg_f != NULL) {
 		conf_t *conf;
-		int errline;
 
 		dbg_log(config, 1, "loading config file: %s", cfgname);
-		if ((conf = conf_read(cfg_f, &errline)) == NULL) {
-			log_init_msg(B_TRUE, INIT_ERR_MSG_TIMEOUT, "5",
-			    "Configuration", "X-RAAS startup error: syntax "
-			    "error on line %d in config file:\n%s\n"
-			    "Please correct this and then hit Plugins "
-			    "-> Admin, Disable & Enable X-RAAS.", errline,
-			    cfgname);
+		if ((conf = conf_read(cfg_f, errline)) == NULL) {
 			fclose(cfg_f);
+			free(cfgname);
 			return (B_FALSE);
 		}
-		process_conf(state, conf);
+		process_conf(config, dbg, origin, layer, conf);
 		conf_free(conf);
 		fclose(cfg_f);
 	}
@@ -283,21 +362,254 @@ load_config(xraas_state_t *state, const char *dirname)
 	return (B_TRUE);
 }
 
+/*
+ * Fills `dirs' with the directories from which the config files are
+ * loaded, in the order in which they are applied, and returns how many
+ * there are.
+ */
+size_t
+config_dirs(const char *dirs[NUM_CONFIG_DIRS])
+{
+	size_t n = 0;
+
+	/* order is important here, first load the global one */
+#ifndef	XRAAS_IS_EMBEDDED
+	dirs[n++] = xraas_prefsdir;
+#endif	/* !XRAAS_IS_EMBEDDED */
+	dirs[n++] = xraas_acf_dirpath;
+	dirs[n++] = xraas_acf_livpath;
+
+	return (n);
+}
+
+/*
+ * Fingerprints the contents of the config file in directory `dir', so
+ * that we can tell when it has changed.
+ */
+void
+config_fingerprint(const char *dir, config_fprint_t *fp)
+{
+	char *path = mkpathname(dir, "X-RAAS.cfg", NULL);
+	FILE *f = fopen(path, "rb");
+
+	fp->exists = B_FALSE;
+	fp->crc = 0;
+	if (f != NULL) {
+		long len;
+		char *buf;
+
+		fp->exists = B_TRUE;
+		if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) >= 0 &&
+		    fseek(f, 0, SEEK_SET) == 0) {
+			buf = malloc(len + 1);
+			fp->crc = crc64(buf, fread(buf, 1, len, f));
+			free(buf);
+		}
+		fclose(f);
+	}
+	free(path);
+}
+
+/*
+ * Builds a configuration from the defaults and the config files in `dirs'
+ * (as returned by config_dirs) and records which layer supplied each
+ * value in `origin'. Only touches `config', `dbg' & `origin', so it can
+ * run off the main thread. On a syntax error, returns false
+ * and the index of the offending directory & line number in `errdir' and
+ * `errline'.
+ */
+bool_t
+config_parse(const char *const dirs[], size_t n_dirs, xraas_config_t *config,
+    debug_config_t *dbg, config_origin_t *origin, size_t *errdir,
+    int *errline)
+{
+	reset_config(config, dbg);
+	memset(origin, 0, sizeof (*origin));
+	for (size_t i = 0; i < n_dirs; i++) {
+		/* the last directory is always the livery */
+		config_layer_t layer = NUM_CONFIG_LAYERS - n_dirs + i;
+
+		if (!parse_config(config, dbg, origin, layer, dirs[i],
+		    errline)) {
+			*errdir = i;
+			return (B_FALSE);
+		}
+	}
+	return (B_TRUE);
+}
+
+/*
+ * Checks that the values in `config' make sense. If they don't, returns
+ * false and a description of the first offending value in `reason'.
+ */
+bool_t
+config_validate(const xraas_config_t *config, char *reason, size_t cap)
+{
+#define	CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			snprintf(reason, cap, "%s", #cond); \
+			return (B_FALSE); \
+		} \
+	} while (0)
+	CHECK(config->min_engines >= 0);
+	CHECK(config->min_mtow >= 0);
+	CHECK(config->voice_volume >= 0 && config->voice_volume <= 1);
+	CHECK(config->min_takeoff_dist >= 0);
+	CHECK(config->min_landing_dist >= 0);
+	CHECK(config->min_rotation_dist >= 0);
+	CHECK(config->min_rotation_angle >= 0);
+	CHECK(config->stop_dist_cutoff >= 0);
+	CHECK(config->min_landing_flap >= 0 && config->min_landing_flap <= 1);
+	CHECK(config->min_takeoff_flap >= 0 && config->min_takeoff_flap <= 1);
+	CHECK(config->max_takeoff_flap >= 0 && config->max_takeoff_flap <= 1);
+	CHECK(config->min_takeoff_flap <= config->max_takeoff_flap);
+	CHECK(config->nd_alert_filter >= ND_ALERT_ROUTINE &&
+	    config->nd_alert_filter <= ND_ALERT_CAUTION);
+	CHECK(config->nd_alert_timeout >= 0);
+	CHECK(config->nd_alert_overlay_font_size > 0);
+	CHECK(config->on_rwy_warn_initial >= 0);
+	CHECK(config->on_rwy_warn_repeat >= 0);
+	CHECK(config->on_rwy_warn_max_n >= 0);
+	CHECK(config->gpa_limit_mult > 0);
+	CHECK(config->gpa_limit_max > 0);
+	CHECK(config->long_land_lim_abs >= 0);
+	CHECK(config->long_land_lim_fract >= 0 &&
+	    config->long_land_lim_fract <= 1);
+	CHECK(config->raw_trace_size > 0);
+#undef	CHECK
+	return (B_TRUE);
+}
+
+#define	FIELD(name) \
+	offsetof(xraas_config_t, name), sizeof (((xraas_config_t *)0)->name)
+
+/*
+ * Config fields which are only picked up when the subsystem using them is
+ * initialized. The others are read by the monitors every time they run,
+ * so they take effect as soon as they are changed.
+ */
+static const struct {
+	size_t		off;
+	size_t		size;
+	unsigned	reinit;		/* CONFIG_REINIT_* */
+} reinit_fields[] = {
+	{ FIELD(enabled), CONFIG_REINIT_ALL },
+	{ FIELD(min_engines), CONFIG_REINIT_ALL },
+	{ FIELD(min_mtow), CONFIG_REINIT_ALL },
+	{ FIELD(allow_helos), CONFIG_REINIT_ALL },
+	{ FIELD(GPWS_priority_dataref), CONFIG_REINIT_ALL },
+	{ FIELD(GPWS_inop_dataref), CONFIG_REINIT_ALL },
+	{ FIELD(adc_backend), CONFIG_REINIT_ALL },
+	{ FIELD(adc_replay_file), CONFIG_REINIT_ALL },
+	{ FIELD(adc_rec), CONFIG_REINIT_ALL },
+	{ FIELD(journal), CONFIG_REINIT_ALL },
+	{ FIELD(raw_trace), CONFIG_REINIT_ALL },
+	{ FIELD(raw_trace_size), CONFIG_REINIT_ALL },
+	{ FIELD(debug_async_log), CONFIG_REINIT_ALL },
+	{ FIELD(use_tts), CONFIG_REINIT_SND },
+	{ FIELD(voice_female), CONFIG_REINIT_SND },
+	{ FIELD(voice_volume), CONFIG_REINIT_SND },
+	{ FIELD(openal_shared), CONFIG_REINIT_SND },
+	{ FIELD(nd_alerts_enabled), CONFIG_REINIT_ND_ALERTS },
+	{ FIELD(nd_alert_overlay_enabled), CONFIG_REINIT_ND_ALERTS },
+	{ FIELD(nd_alert_overlay_font), CONFIG_REINIT_ND_ALERTS },
+	{ FIELD(nd_alert_overlay_font_size), CONFIG_REINIT_ND_ALERTS },
+	{ FIELD(debug_graphical), CONFIG_REINIT_DBG_GUI }
+};
+
+#undef	FIELD
+
+/*
+ * Returns the CONFIG_REINIT_* flags of the subsystems which need to be
+ * re-initialized to switch from config `old_cfg' to `new_cfg'.
+ */
+unsigned
+config_reinit_flags(const xraas_config_t *old_cfg,
+    const xraas_config_t *new_cfg)
+{
+	unsigned reinit = 0;
+
+	for (size_t i = 0; i < ARRAY_NUM_ELEM(reinit_fields); i++) {
+		if (memcmp((const char *)old_cfg + reinit_fields[i].off,
+		    (const char *)new_cfg + reinit_fields[i].off,
+		    reinit_fields[i].size) != 0)
+			reinit |= reinit_fields[i].reinit;
+	}
+
+	return (reinit);
+}
+
+/*
+ * Returns a hash of the configuration which affects X-RAAS' behavior,
+ * i.e. all of it except for where the air data comes from, whether it
+ * is being recorded, traced or journaled, and the debugging aids. Used
+ * to tell if an air data recording (see adc_rec.c) was made with the
+ * configuration we are running with. Expects crc64_init to have been
+ * called already.
+ */
+uint64_t
+config_hash(const xraas_state_t *state)
+{
+	xraas_config_t config;
+
+	/*
+	 * memcpy, so the (zeroed) padding is copied too. The config holds
+	 * no pointers, so hashing the raw bytes is stable across runs.
+	 */
+	memcpy(&config, &state->config, sizeof (config));
+	memset(config.adc_backend, 0, sizeof (config.adc_backend));
+	memset(config.adc_replay_file, 0, sizeof (config.adc_replay_file));
+	config.adc_rec = B_FALSE;
+	config.raw_trace = B_FALSE;
+	config.raw_trace_size = 0;
+	config.journal = B_FALSE;
+	config.debug_graphical = B_FALSE;
+	config.debug_async_log = B_FALSE;
+
+	return (crc64(&config, sizeof (config)));
+}
+
 /*
  * Loads the global and aircraft-specific X-RAAS config files.
  */
 bool_t
 load_configs(xraas_state_t *state)
 {
+	const char *dirs[NUM_CONFIG_DIRS];
+	size_t n_dirs = config_dirs(dirs), errdir;
+	config_origin_t *origin = malloc(sizeof (*origin));
+	char reason[256];
+	int errline;
+
 	reset_state(state);
-	/* order is important here, first load the global one */
-#ifndef	XRAAS_IS_EMBEDDED
-	if (!load_config(state, xraas_prefsdir))
-		return (B_FALSE);
-#endif	/* !XRAAS_IS_EMBEDDED */
-	if (!load_config(state, xraas_acf_dirpath))
+	if (!config_parse(dirs, n_dirs, &state->config, &xraas_debug_config,
+	    origin, &errdir, &errline)) {
+		char *cfgname = mkpathname(dirs[errdir], "X-RAAS.cfg", NULL);
+
+		log_init_msg(B_TRUE, INIT_ERR_MSG_TIMEOUT, "5",
+		    "Configuration", "X-RAAS startup error: syntax "
+		    "error on line %d in config file:\n%s\n"
+		    "Please correct this and save the file, X-RAAS "
+		    "will then start automatically.", errline,
+		    cfgname);
+		free(cfgname);
+		free(origin);
 		return (B_FALSE);
-	if (!load_config(state, xraas_acf_livpath))
+	}
+	if (!config_validate(&state->config, reason, sizeof (reason))) {
+		log_init_msg(B_TRUE, INIT_ERR_MSG_TIMEOUT, "5",
+		    "Configuration", "X-RAAS startup error: invalid "
+		    "config value, the following must hold: %s\n"
+		    "Please correct this and save the file, X-RAAS "
+		    "will then start automatically.", reason);
+		free(origin);
 		return (B_FALSE);
+	}
+	snd_sys_set_shared(state->config.openal_shared);
+
+	config_origin_log(origin);
+	free(origin);
+
 	return (B_TRUE);
 }
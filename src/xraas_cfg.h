@@ -18,15 +18,78 @@
 #ifndef	_XRAAS_CFG_H_
 #define	_XRAAS_CFG_H_
 
+#include <stdint.h>
+
 #include <acfutils/conf.h>
+
+#include "dbg_log.h"
 #include "xraas2.h"
 
 #ifdef	__cplusplus
 extern "C" {
 #endif
 
+#ifdef	XRAAS_IS_EMBEDDED
+#define	NUM_CONFIG_DIRS	2
+#else	/* !XRAAS_IS_EMBEDDED */
+#define	NUM_CONFIG_DIRS	3
+#endif	/* !XRAAS_IS_EMBEDDED */
+
+/* What needs to be re-initialized when the config changes */
+typedef enum {
+	CONFIG_REINIT_SND =		1 << 0,	/* snd_sys */
+	CONFIG_REINIT_ND_ALERTS =	1 << 1,	/* ND_alerts */
+	CONFIG_REINIT_DBG_GUI =		1 << 2,	/* dbg_gui */
+	CONFIG_REINIT_ALL =		1 << 3	/* xraas_fini & xraas_init */
+} config_reinit_t;
+
+/* Where a config value came from, in the order the layers are applied */
+typedef enum {
+	CONFIG_LAYER_DEFAULT,
+	CONFIG_LAYER_GLOBAL,
+	CONFIG_LAYER_ACF,
+	CONFIG_LAYER_LIVERY,
+	NUM_CONFIG_LAYERS
+} config_layer_t;
+
+#define	CONFIG_KEY_LEN		32
+#define	CONFIG_MAX_KEYS		128
+
+/*
+ * The layer which supplied each config key set by any of the config
+ * files. Keys which aren't listed have their default value.
+ */
+typedef struct {
+	uint32_t	n_keys;
+	struct {
+		char	key[CONFIG_KEY_LEN];
+		uint8_t	layer;		/* config_layer_t */
+	} keys[CONFIG_MAX_KEYS];
+} config_origin_t;
+
+typedef struct {
+	bool_t		exists;
+	uint64_t	crc;		/* of the file's contents */
+} config_fprint_t;
+
 extern const char *const monitor_conf_keys[NUM_MONITORS];
+extern const char *const config_layer_names[NUM_CONFIG_LAYERS];
 bool_t load_configs(xraas_state_t *state);
+size_t config_dirs(const char *dirs[NUM_CONFIG_DIRS]);
+void config_fingerprint(const char *dir, config_fprint_t *fp);
+bool_t config_parse(const char *const dirs[], size_t n_dirs,
+    xraas_config_t *config, debug_config_t *dbg, config_origin_t *origin,
+    size_t *errdir, int *errline);
+config_layer_t config_origin_layer(const config_origin_t *origin,
+    const char *key);
+void config_origin_log(const config_origin_t *origin);
+bool_t config_validate(const xraas_config_t *config, char *reason,
+    size_t cap);
+unsigned config_reinit_flags(const xraas_config_t *old_cfg,
+    const xraas_config_t *new_cfg);
+uint64_t config_hash(const xraas_state_t *state);
+void xraas_config_apply(const xraas_config_t *config,
+    const debug_config_t *dbg, const config_origin_t *origin);
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,170 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+/*
+ * dbg_log compile-time level cap benchmark. Runs a pass shaped like the
+ * per-flight-loop hot paths (adc_collect, then a rwy_key_tbl_set-style
+ * lookup & update for each nearby runway), with the same kinds of
+ * dbg_log call sites, and reports the time per pass (best of NUM_ROUNDS
+ * rounds). Once with all levels compiled in and gated only at runtime by
+ * the debug_* config keys (all 0, as in a normal install), and once with
+ * the same call sites capped at compile time (DBG_LOG_MAX_<class> = 0),
+ * so they're compiled out. Neither variant ever generates any debug
+ * output, so this measures just the cost of the runtime checks.
+ *
+ * Usage: dbg_bench [iterations]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+#include <acfutils/time.h>
+
+/*
+ * The capped variant uses debug classes which the hot paths don't, so
+ * the two variants can be built from the same code in one file.
+ */
+#define	DBG_LOG_MAX_snd		0
+#define	DBG_LOG_MAX_wav		0
+#define	DBG_LOG_MAX_tile	0
+
+#include "../src/dbg_log.h"
+
+#define	DEFAULT_ITERATIONS	1000000
+#define	NUM_ROUNDS		5
+#define	NUM_RWYS		16
+
+debug_config_t xraas_debug_config;
+
+typedef struct {
+	char	key[16];
+	int	value;
+} rwy_ent_t;
+
+static struct {
+	double	lat, lon, elev, hdg, gs, cas, rad_alt, baro_alt, pitch;
+} adc;
+static rwy_ent_t rwys[NUM_RWYS];
+static unsigned pass_nr = 0;
+
+/*
+ * Stands in for the calls into X-Plane & the rest of X-RAAS the real
+ * hot paths make, so the compiler has to reload the debug config after
+ * them, just like in the plugin.
+ */
+static void (*volatile touch)(double *) = NULL;
+
+static void
+touch_impl(double *val)
+{
+	*val += 1e-9;
+}
+
+#define	PASS_FUNC(name, adc_class, rwy_class, ann_class) \
+static void \
+name(void) \
+{ \
+	touch(&adc.elev); \
+	dbg_log(adc_class, 2, "collect; lat: %f lon: %f elev: %f " \
+	    "hdg: %f gs: %f cas: %f rad_alt: %f baro_alt: %f pitch: %f", \
+	    adc.lat, adc.lon, adc.elev, adc.hdg, adc.gs, adc.cas, \
+	    adc.rad_alt, adc.baro_alt, adc.pitch); \
+	for (int i = 0; i < NUM_RWYS; i++) { \
+		rwy_ent_t *ent = &rwys[i]; \
+		double dist = fabs(adc.lat - i) + fabs(adc.lon + i); \
+		int value = (dist < NUM_RWYS / 2) ^ (pass_nr & 1); \
+\
+		touch(&dist); \
+		dbg_log(ann_class, 2, "%s dist %.0f", ent->key, dist); \
+		if (ent->value != value) { \
+			dbg_log(rwy_class, 1, "tbl[%s] = %d", ent->key, \
+			    value); \
+			ent->value = value; \
+		} \
+	} \
+	pass_nr++; \
+}
+
+PASS_FUNC(pass_runtime, adc, rwy_key, ann_state)
+PASS_FUNC(pass_capped, snd, wav, tile)
+
+void
+dbg_log_impl(const char *filename, int line, const char *fmt, ...)
+{
+	UNUSED(filename);
+	UNUSED(line);
+	UNUSED(fmt);
+	abort();
+}
+
+static double
+bench(void (*pass_func)(void), int iterations)
+{
+	uint64_t start, end;
+
+	/* warm up */
+	for (int i = 0; i < iterations / 10; i++)
+		pass_func();
+	start = microclock();
+	for (int i = 0; i < iterations; i++)
+		pass_func();
+	end = microclock();
+
+	return ((end - start) * 1000.0 / iterations);
+}
+
+int
+main(int argc, char **argv)
+{
+	int iterations = DEFAULT_ITERATIONS;
+	double runtime_ns, capped_ns;
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+		return (1);
+	}
+	if (argc == 2 && (iterations = atoi(argv[1])) <= 0) {
+		fprintf(stderr, "Invalid iteration count %s\n", argv[1]);
+		return (1);
+	}
+
+	touch = touch_impl;
+	for (int i = 0; i < NUM_RWYS; i++)
+		snprintf(rwys[i].key, sizeof (rwys[i].key), "KXYZ/%02d", i);
+
+	/*
+	 * Alternate the variants over a few rounds & keep the best round of
+	 * each, so neither one benefits from a warmer cache or a quieter
+	 * machine.
+	 */
+	runtime_ns = capped_ns = INFINITY;
+	for (int i = 0; i < NUM_ROUNDS; i++) {
+		runtime_ns = MIN(runtime_ns, bench(pass_runtime, iterations));
+		capped_ns = MIN(capped_ns, bench(pass_capped, iterations));
+	}
+
+	printf("%d dbg_log sites run per pass\n", 1 + 2 * NUM_RWYS);
+	printf("runtime check only       %8.1f ns/pass\n", runtime_ns);
+	printf("compiled out             %8.1f ns/pass  (%.2fx)\n", capped_ns,
+	    runtime_ns / capped_ns);
+
+	return (0);
+}
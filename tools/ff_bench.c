@@ -0,0 +1,251 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+/*
+ * FlightFactor A320 shared value access benchmark. Replays the shared
+ * value accesses of one full ff_a320_update() pass in airdata.c against a
+ * mock SharedValuesInterface and reports the average time per pass, once
+ * the way airdata.c used to do it (querying and checking the value type
+ * on every access) and once through handles bound & type-checked up front
+ * (the way it does it now). The mock provider keeps its values in a flat
+ * array, so this measures the call overhead, not the A320's own lookups.
+ *
+ * Usage: ff_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+#include <acfutils/time.h>
+
+#include <FF_A320/SharedValue.h>
+
+#define	DEFAULT_ITERATIONS	1000000
+
+typedef enum {
+	OP_GETS32,
+	OP_GETF32,
+	OP_SETS32
+} op_t;
+
+/* The accesses of an ff_a320_update() pass, in order. */
+static const struct {
+	const char	*name;
+	unsigned int	type;
+	op_t		op;
+} pass[] = {
+    { "Aircraft.Navigation.GPWC.Powered", Value_Type_sint32, OP_GETS32 },
+    { "Aircraft.Navigation.GPWC.Fault", Value_Type_sint32, OP_GETS32 },
+    { "Aircraft.Navigation.GPWC.FaultEx", Value_Type_sint32, OP_GETS32 },
+    { "Aircraft.Navigation.GPWC.Inhibit", Value_Type_sint32, OP_GETS32 },
+    { "Aircraft.Navigation.GPWC.InhibitEx", Value_Type_sint32, OP_GETS32 },
+    { "Aircraft.Navigation.GPWC.InhibitFlaps", Value_Type_sint32,
+	OP_GETS32 },
+    { "Aircraft.Navigation.GPWC.Alert", Value_Type_sint32, OP_GETS32 },
+    { "Aircraft.Navigation.GPWC.AltitudeBaro", Value_Type_float32,
+	OP_GETF32 },
+    { "Aircraft.Navigation.GPWC.Altitude", Value_Type_float32, OP_GETF32 },
+    { "Aircraft.Navigation.GPWC.Height", Value_Type_float32, OP_GETF32 },
+    { "Aircraft.Navigation.GPWC.Heading", Value_Type_float32, OP_GETF32 },
+    { "Aircraft.Navigation.GPWC.AirSpeed", Value_Type_float32, OP_GETF32 },
+    { "Aircraft.Navigation.GPWC.Speed", Value_Type_float32, OP_GETF32 },
+    { "Aircraft.Navigation.GPWC.TransitionAltitude", Value_Type_float32,
+	OP_GETF32 },
+    { "Aircraft.Navigation.GPWC.TransitionLevel", Value_Type_float32,
+	OP_GETF32 },
+    { "Aircraft.TakeoffConfig", Value_Type_sint32, OP_GETS32 },
+    { "Aircraft.LandingConfig", Value_Type_sint32, OP_GETS32 },
+    { "Aircraft.Navigation.GPWC.ApproachSpeed", Value_Type_float32,
+	OP_GETF32 },
+    { "Aircraft.Navigation.GPWC.LocalizerValid", Value_Type_sint32,
+	OP_GETS32 },
+    { "Aircraft.Navigation.GPWC.GlideSlopeValid", Value_Type_sint32,
+	OP_GETS32 },
+    { "Aircraft.Navigation.GPWC.Localizer", Value_Type_float32, OP_GETF32 },
+    { "Aircraft.Navigation.GPWC.GlideSlope", Value_Type_float32,
+	OP_GETF32 },
+    { "Aircraft.Navigation.GPWC.AdvisoryLevel", Value_Type_sint32,
+	OP_SETS32 }
+};
+#define	NUM_VALS	ARRAY_NUM_ELEM(pass)
+
+/* mock shared value provider */
+static union {
+	int32_t	s32;
+	float	f32;
+} values[NUM_VALS];
+
+static SharedValuesInterface svi;
+
+static __attribute__((noinline)) int __stdcall
+mock_id_by_name(const char *name)
+{
+	for (size_t i = 0; i < NUM_VALS; i++) {
+		if (strcmp(pass[i].name, name) == 0)
+			return (i);
+	}
+	return (-1);
+}
+
+static __attribute__((noinline)) unsigned int __stdcall
+mock_type(int id)
+{
+	return (pass[id].type);
+}
+
+static __attribute__((noinline)) void __stdcall
+mock_get(int id, void *dst)
+{
+	memcpy(dst, &values[id], sizeof (values[id]));
+}
+
+static __attribute__((noinline)) void __stdcall
+mock_set(int id, const void *src)
+{
+	memcpy(&values[id], src, sizeof (values[id]));
+}
+
+static int ids[NUM_VALS];
+static volatile double sink;
+
+/*
+ * Type-checked access on every call, as in the old ff_a320_gets32() etc.
+ */
+static void
+pass_checked(void)
+{
+	double sum = 0;
+
+	for (size_t i = 0; i < NUM_VALS; i++) {
+		int id = ids[i];
+		unsigned int type = svi.ValueType(id);
+		int32_t s32;
+		float f32;
+
+		switch (pass[i].op) {
+		case OP_GETS32:
+			VERIFY(type >= Value_Type_sint8 &&
+			    type <= Value_Type_uint32);
+			svi.ValueGet(id, &s32);
+			sum += s32;
+			break;
+		case OP_GETF32:
+			VERIFY(type == Value_Type_float32);
+			svi.ValueGet(id, &f32);
+			sum += f32;
+			break;
+		case OP_SETS32:
+			VERIFY(type >= Value_Type_sint8 &&
+			    type <= Value_Type_uint32);
+			s32 = 1;
+			svi.ValueSet(id, &s32);
+			break;
+		}
+	}
+	sink = sum;
+}
+
+/*
+ * Access through handles which were type-checked at bind time.
+ */
+static void
+pass_bound(void)
+{
+	double sum = 0;
+
+	for (size_t i = 0; i < NUM_VALS; i++) {
+		int32_t s32;
+		float f32;
+
+		switch (pass[i].op) {
+		case OP_GETS32:
+			svi.ValueGet(ids[i], &s32);
+			sum += s32;
+			break;
+		case OP_GETF32:
+			svi.ValueGet(ids[i], &f32);
+			sum += f32;
+			break;
+		case OP_SETS32:
+			s32 = 1;
+			svi.ValueSet(ids[i], &s32);
+			break;
+		}
+	}
+	sink = sum;
+}
+
+static double
+bench(void (*pass_func)(void), int iterations)
+{
+	uint64_t start, end;
+
+	/* warm up */
+	for (int i = 0; i < iterations / 10; i++)
+		pass_func();
+	start = microclock();
+	for (int i = 0; i < iterations; i++)
+		pass_func();
+	end = microclock();
+
+	return ((end - start) * 1000.0 / iterations);
+}
+
+static void
+log_dbg_string(const char *str)
+{
+	fputs(str, stderr);
+}
+
+int
+main(int argc, char **argv)
+{
+	int iterations = DEFAULT_ITERATIONS;
+	double checked_ns, bound_ns;
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+		return (1);
+	}
+	if (argc == 2 && (iterations = atoi(argv[1])) <= 0) {
+		fprintf(stderr, "Invalid iteration count %s\n", argv[1]);
+		return (1);
+	}
+
+	log_init(log_dbg_string, "ff_bench");
+
+	svi.ValueIdByName = mock_id_by_name;
+	svi.ValueType = mock_type;
+	svi.ValueGet = mock_get;
+	svi.ValueSet = mock_set;
+	for (size_t i = 0; i < NUM_VALS; i++)
+		ids[i] = svi.ValueIdByName(pass[i].name);
+
+	checked_ns = bench(pass_checked, iterations);
+	bound_ns = bench(pass_bound, iterations);
+
+	printf("%d accesses per ff_a320_update() pass\n", (int)NUM_VALS);
+	printf("type-checked per access  %8.1f ns/pass\n", checked_ns);
+	printf("bound handles            %8.1f ns/pass  (%.2fx)\n", bound_ns,
+	    checked_ns / bound_ns);
+
+	return (0);
+}
@@ -0,0 +1,184 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+/*
+ * Event journal decoder. Prints the records of an X-RAAS event journal
+ * (Output/X-RAAS/journal/<date>.xrj, see src/journal.c) one per line:
+ *
+ *	<sim time> <event> <details>
+ *
+ * Usage: journal_dump <journal file>
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/journal_fmt.h"
+#include "../api/c/XRAAS_ND_msg_decode.h"
+
+#define	MAX_NAMES	256
+
+static char phrases[MAX_NAMES][JOURNAL_NAME_LEN + 1];
+static char tbls[MAX_NAMES][JOURNAL_NAME_LEN + 1];
+
+static const char *
+name_lookup(char names[MAX_NAMES][JOURNAL_NAME_LEN + 1], unsigned id)
+{
+	if (id >= MAX_NAMES || names[id][0] == 0)
+		return ("?");
+	return (names[id]);
+}
+
+static void
+print_msgs(const journal_rec_t *rec, unsigned first, unsigned n_msgs)
+{
+	for (unsigned i = first; i < n_msgs &&
+	    i - first < JOURNAL_REC_MSGS; i++)
+		printf(" %s", name_lookup(phrases, rec->u.ev.msgs[i - first]));
+}
+
+static void
+print_rec(const journal_rec_t *rec, unsigned *cont_msg, unsigned *cont_n)
+{
+	char rwy[JOURNAL_RWY_LEN + 1];
+	char nd_msg[16];
+	int color;
+
+	memcpy(rwy, rec->u.ev.rwy, JOURNAL_RWY_LEN);
+	rwy[JOURNAL_RWY_LEN] = 0;
+
+	if (rec->type == JE_NAME) {
+		char (*names)[JOURNAL_NAME_LEN + 1] =
+		    (rec->value == JOURNAL_NAME_TBL ? tbls : phrases);
+
+		if (rec->aux < MAX_NAMES) {
+			memcpy(names[rec->aux], rec->u.name, JOURNAL_NAME_LEN);
+			names[rec->aux][JOURNAL_NAME_LEN] = 0;
+		}
+		return;
+	}
+
+	printf("%6" PRIu32 ".%03" PRIu32 " ", rec->sim_time / 1000,
+	    rec->sim_time % 1000);
+
+	switch (rec->type) {
+	case JE_MSG:
+		printf("msg      prio %d%s%s%s [%s]:", rec->aux &
+		    JOURNAL_MSG_PRIO_MASK,
+		    (rec->aux & JOURNAL_MSG_SUPPRESSED) ? " suppressed" : "",
+		    (rec->aux & JOURNAL_MSG_MODIFIED) ? " modified" : "",
+		    (rec->aux & JOURNAL_MSG_TTS) ? " tts" : "", rwy);
+		print_msgs(rec, 0, rec->n_msgs);
+		*cont_msg = JOURNAL_REC_MSGS;
+		*cont_n = rec->n_msgs;
+		break;
+	case JE_MSG_CONT:
+		printf("msg      (cont):");
+		print_msgs(rec, *cont_msg, *cont_n);
+		*cont_msg += JOURNAL_REC_MSGS;
+		break;
+	case JE_ND_ALERT:
+		if (XRAAS_ND_msg_decode(rec->value, nd_msg, &color))
+			printf("nd_alert [%s]: %s (%s)", rwy, nd_msg,
+			    color == XRAAS_ND_ALERT_AMBER ? "amber" : "green");
+		else
+			printf("nd_alert [%s]: invalid 0x%x", rwy,
+			    (unsigned)rec->value);
+		break;
+	case JE_FLT_STATE:
+		printf("flt_state%s%s%s",
+		    (rec->value & JOURNAL_FLT_DEPARTED) ? " departed" : "",
+		    (rec->value & JOURNAL_FLT_ARRIVING) ? " arriving" : "",
+		    (rec->value & JOURNAL_FLT_LANDING) ? " landing" : "");
+		break;
+	case JE_RWY_KEY_SET:
+		printf("rwy_key  %s[%s] = %d", name_lookup(tbls, rec->aux),
+		    rwy, (int)rec->value);
+		break;
+	case JE_RWY_KEY_REMOVE:
+		if (rwy[0] == 0)
+			printf("rwy_key  %s emptied",
+			    name_lookup(tbls, rec->aux));
+		else
+			printf("rwy_key  %s[%s] = nil",
+			    name_lookup(tbls, rec->aux), rwy);
+		break;
+	case JE_TATL:
+		printf("tatl     %s %d (%s)", rec->aux == 0 ?
+		    "below TL" : "above TA", (int)rec->value, rwy);
+		break;
+	case JE_BUDGET:
+		printf("budget   %d records/hour exhausted, rest of hour "
+		    "dropped", (int)rec->value);
+		break;
+	default:
+		printf("unknown type %d", rec->type);
+		break;
+	}
+	printf("\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	FILE *fp;
+	journal_hdr_t hdr;
+	journal_rec_t rec;
+	time_t start;
+	char icao[sizeof (hdr.acf_icao) + 1];
+	unsigned n_recs = 0, cont_msg = 0, cont_n = 0;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <journal file>\n", argv[0]);
+		return (1);
+	}
+	if ((fp = fopen(argv[1], "rb")) == NULL) {
+		perror(argv[1]);
+		return (1);
+	}
+	if (fread(&hdr, sizeof (hdr), 1, fp) != 1 ||
+	    hdr.magic != JOURNAL_MAGIC) {
+		fprintf(stderr, "%s: not an X-RAAS journal, or written on "
+		    "a machine with a different byte order\n", argv[1]);
+		fclose(fp);
+		return (1);
+	}
+	if (hdr.version != JOURNAL_VERSION ||
+	    hdr.rec_size != sizeof (journal_rec_t)) {
+		fprintf(stderr, "%s: unsupported journal version %d "
+		    "(record size %d)\n", argv[1], hdr.version, hdr.rec_size);
+		fclose(fp);
+		return (1);
+	}
+
+	memcpy(icao, hdr.acf_icao, sizeof (hdr.acf_icao));
+	icao[sizeof (hdr.acf_icao)] = 0;
+	start = hdr.start_time;
+	printf("# aircraft: %s  started: %s", icao, ctime(&start));
+
+	while (fread(&rec, sizeof (rec), 1, fp) == 1) {
+		print_rec(&rec, &cont_msg, &cont_n);
+		n_recs++;
+	}
+	printf("# %u records\n", n_recs);
+	fclose(fp);
+
+	return (0);
+}
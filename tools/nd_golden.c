@@ -0,0 +1,444 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+/*
+ * Golden image check & benchmark for the ND alert overlay and init
+ * message textures. This renders, entirely on the CPU, every decodable
+ * ND alert without a runway length field (plus a sample of alerts with
+ * one) and a few representative init messages through the same
+ * render_text_box() path that nd_alert.c and init_msg.c use. Each image
+ * is timed and, if a golden image for it exists in the golden directory,
+ * compared against it pixel by pixel.
+ *
+ * Usage: nd_golden [-u] [-n iterations] [-t tolerance] [-o outdir]
+ *	<X-RAAS data dir> <golden dir>
+ *	-u: (re)write the golden images instead of comparing against them
+ *	-n: number of timed renders per image (default 20)
+ *	-t: maximum per-channel difference to tolerate (default 0)
+ *	-o: also write every rendered image into `outdir'
+ *
+ * Images are stored as RGBA PAM (netpbm P7) files. The exit status is
+ * non-zero if any golden image is missing or doesn't match. The golden
+ * images depend on the FreeType version in use, so after upgrading the
+ * bundled FreeType, inspect the -o output and re-run with -u.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+#include <acfutils/time.h>
+
+#include "../api/c/XRAAS_ND_msg_decode.h"
+#include "../src/text_rendering.h"
+
+#define	DEFAULT_ITERATIONS	20
+
+/* Must match the defaults in nd_alert.c */
+#define	ND_FONT		"ShareTechMono/ShareTechMono-Regular.ttf"
+#define	ND_FONT_SIZE		28
+#define	ND_BG_ALPHA		0.67
+#define	ND_MARGIN		10
+#define	ND_MSG_APP		8
+#define	ND_MSG_ON		9
+#define	ND_AMBER_FLAG		0x40
+#define	ND_NUM_RWY_IDS		38
+
+/* Must match the defaults in init_msg.c */
+#define	INIT_MSG_FONT		"Aileron/Aileron-Regular.otf"
+#define	INIT_MSG_FONT_SIZE	21
+#define	INIT_MSG_BG_ALPHA	0.67
+#define	INIT_MSG_MARGIN		10
+
+/*
+ * The alerts which have golden images. These are the same values as
+ * exercised by the decoder sample in api/c/test_sample.c.
+ */
+static const int golden_alerts[] = {
+	0x00000041, 0x00000042, 0x00000043, 0x00000044, 0x00000045,
+	0x00000046, 0x00000047, 0x00002308, 0x00006308, 0x00002508,
+	0x00142348, 0x00086348, 0x00000049, 0x00002309, 0x00006309,
+	0x00002509, 0x0014E349, 0x0008A349, 0x0000004A, 0x0000004B
+};
+
+/* Runway length values to sample, out of the 1..255 possible ones. */
+static const int rwy_lens[] = { 1, 8, 20, 99, 255 };
+
+static const struct {
+	const char	*name;
+	const char	*text;
+} init_msgs[] = {
+	{ "init_ok", "X-RAAS(2.0): Runway Awareness OK; Feet." },
+	{ "init_snd_err", "Cannot play sound, OpenAL error.\n"
+	    "See Log.txt for more information." }
+};
+
+static struct {
+	bool_t		update;
+	int		iterations;
+	int		tolerance;
+	const char	*outdir;
+	const char	*goldendir;
+
+	int		n_rendered;
+	int		n_compared;
+	int		n_failed;
+	double		total_us;
+} opts = { B_FALSE, DEFAULT_ITERATIONS, 0, NULL, NULL, 0, 0, 0, 0 };
+
+static void
+log_dbg_string(const char *str)
+{
+	fputs(str, stderr);
+}
+
+static bool_t
+write_pam(const char *path, const uint8_t *buf, int w, int h)
+{
+	FILE *fp = fopen(path, "wb");
+	bool_t res;
+
+	if (fp == NULL) {
+		perror(path);
+		return (B_FALSE);
+	}
+	fprintf(fp, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\n"
+	    "TUPLTYPE RGB_ALPHA\nENDHDR\n", w, h);
+	res = (fwrite(buf, 4, w * h, fp) == (size_t)(w * h));
+	if (!res)
+		fprintf(stderr, "%s: write error\n", path);
+	fclose(fp);
+
+	return (res);
+}
+
+/*
+ * Reads an RGBA PAM file as written by write_pam. Returns NULL if the file
+ * doesn't exist or isn't in the expected format.
+ */
+static uint8_t *
+read_pam(const char *path, int *w, int *h)
+{
+	FILE *fp = fopen(path, "rb");
+	char line[64];
+	int depth = 0, maxval = 0;
+	uint8_t *buf;
+
+	if (fp == NULL)
+		return (NULL);
+	*w = 0;
+	*h = 0;
+	if (fgets(line, sizeof (line), fp) == NULL ||
+	    strcmp(line, "P7\n") != 0)
+		goto errout;
+	while (fgets(line, sizeof (line), fp) != NULL &&
+	    strcmp(line, "ENDHDR\n") != 0) {
+		if (sscanf(line, "WIDTH %d", w) != 1 &&
+		    sscanf(line, "HEIGHT %d", h) != 1 &&
+		    sscanf(line, "DEPTH %d", &depth) != 1 &&
+		    sscanf(line, "MAXVAL %d", &maxval) != 1 &&
+		    strcmp(line, "TUPLTYPE RGB_ALPHA\n") != 0)
+			goto errout;
+	}
+	if (*w <= 0 || *h <= 0 || depth != 4 || maxval != 255)
+		goto errout;
+	buf = malloc(*w * *h * 4);
+	if (fread(buf, 4, *w * *h, fp) != (size_t)(*w * *h)) {
+		free(buf);
+		goto errout;
+	}
+	fclose(fp);
+
+	return (buf);
+errout:
+	fprintf(stderr, "%s: not an RGBA PAM file\n", path);
+	fclose(fp);
+	return (NULL);
+}
+
+/*
+ * Compares a rendered image against its golden image. Returns the number
+ * of pixels which differ by more than the tolerance, or -1 if the golden
+ * image is missing or has different dimensions.
+ */
+static int
+compare_golden(const char *path, const uint8_t *buf, int w, int h)
+{
+	int gw, gh, n_diff = 0;
+	uint8_t *golden = read_pam(path, &gw, &gh);
+
+	if (golden == NULL)
+		return (-1);
+	if (gw != w || gh != h) {
+		free(golden);
+		return (-1);
+	}
+	for (int i = 0; i < w * h; i++) {
+		for (int c = 0; c < 4; c++) {
+			if (abs(golden[i * 4 + c] - buf[i * 4 + c]) >
+			    opts.tolerance) {
+				n_diff++;
+				break;
+			}
+		}
+	}
+	free(golden);
+
+	return (n_diff);
+}
+
+/*
+ * Renders, times and checks a single text box. If `golden' is set, the
+ * image is compared against (or with -u, written as) the golden image
+ * `name'.pam in the golden directory.
+ */
+static void
+check_text_box(const char *name, const char *text, FT_Face face,
+    int font_size, int margin, double bg_alpha, uint8_t r, uint8_t g,
+    uint8_t b, bool_t golden)
+{
+	int w, h;
+	uint8_t *buf;
+	uint64_t start;
+	double us;
+	char filename[64];
+	const char *status = "";
+
+	if (!get_text_box_size(text, face, font_size, margin, &w, &h)) {
+		printf("%-16s  measuring failed\n", name);
+		opts.n_failed++;
+		return;
+	}
+	buf = malloc(w * h * 4);
+
+	/* first render warms up the glyph cache & isn't timed */
+	VERIFY(render_text_box(text, face, font_size, margin, bg_alpha,
+	    r, g, b, buf, w, h, 0, 0, w, h));
+	start = microclock();
+	for (int i = 0; i < opts.iterations; i++) {
+		VERIFY(render_text_box(text, face, font_size, margin, bg_alpha,
+		    r, g, b, buf, w, h, 0, 0, w, h));
+	}
+	us = (microclock() - start) / (double)opts.iterations;
+	opts.n_rendered++;
+	opts.total_us += us;
+
+	snprintf(filename, sizeof (filename), "%s.pam", name);
+	if (opts.outdir != NULL) {
+		char *path = mkpathname(opts.outdir, filename, NULL);
+		(void) write_pam(path, buf, w, h);
+		free(path);
+	}
+	if (golden) {
+		char *path = mkpathname(opts.goldendir, filename, NULL);
+
+		if (opts.update) {
+			if (write_pam(path, buf, w, h)) {
+				status = "written";
+			} else {
+				status = "WRITE FAILED";
+				opts.n_failed++;
+			}
+		} else {
+			int n_diff = compare_golden(path, buf, w, h);
+
+			opts.n_compared++;
+			if (n_diff == 0) {
+				status = "ok";
+			} else {
+				status = (n_diff < 0 ? "MISSING/SIZE" :
+				    "MISMATCH");
+				opts.n_failed++;
+			}
+		}
+		free(path);
+	}
+	printf("%-16s  %4d x %-4d  %8.1f us  %s\n", name, w, h, us, status);
+
+	free(buf);
+}
+
+static void
+check_nd_alert(FT_Face face, int value, bool_t golden)
+{
+	char msg[16], name[16];
+	int color;
+
+	VERIFY(XRAAS_ND_msg_decode(value, msg, &color) != 0);
+	snprintf(name, sizeof (name), "nd_%08x", value);
+	if (color == XRAAS_ND_ALERT_GREEN)
+		check_text_box(name, msg, face, ND_FONT_SIZE, ND_MARGIN,
+		    ND_BG_ALPHA, 0, 255, 0, golden);
+	else
+		check_text_box(name, msg, face, ND_FONT_SIZE, ND_MARGIN,
+		    ND_BG_ALPHA, 255, 255, 0, golden);
+}
+
+static bool_t
+is_golden_alert(int value)
+{
+	for (size_t i = 0; i < ARRAY_NUM_ELEM(golden_alerts); i++) {
+		if (golden_alerts[i] == value)
+			return (B_TRUE);
+	}
+	return (B_FALSE);
+}
+
+/*
+ * Runs through every decodable ND alert value, except that the runway
+ * length field is only sampled. The encoding is described in
+ * api/c/XRAAS_ND_msg_decode.c.
+ */
+static void
+check_nd_alerts(FT_Face face)
+{
+	char msg[16];
+	int color;
+
+	for (int amber = 0; amber <= ND_AMBER_FLAG; amber += ND_AMBER_FLAG) {
+		for (int type = 1; type < ND_AMBER_FLAG; type++) {
+			int value = type | amber;
+
+			if (XRAAS_ND_msg_decode(value, msg, &color) == 0)
+				continue;
+			if (type != ND_MSG_APP && type != ND_MSG_ON) {
+				check_nd_alert(face, value,
+				    is_golden_alert(value));
+				continue;
+			}
+			for (int rwy = 0; rwy < ND_NUM_RWY_IDS; rwy++) {
+				for (int sfx = 0; sfx < 4; sfx++) {
+					int v = value | (rwy << 8) |
+					    (sfx << 14);
+
+					/* suffixes only apply to runways */
+					if ((rwy == 0 ||
+					    rwy == ND_NUM_RWY_IDS - 1) &&
+					    sfx != 0)
+						continue;
+					check_nd_alert(face, v,
+					    is_golden_alert(v));
+				}
+			}
+		}
+	}
+	for (size_t i = 0; i < ARRAY_NUM_ELEM(rwy_lens); i++) {
+		check_nd_alert(face, 0x00006308 | (rwy_lens[i] << 16),
+		    B_FALSE);
+	}
+	/* golden alerts not covered above (i.e. those with a length) */
+	for (size_t i = 0; i < ARRAY_NUM_ELEM(golden_alerts); i++) {
+		if ((golden_alerts[i] >> 16) != 0)
+			check_nd_alert(face, golden_alerts[i], B_TRUE);
+	}
+}
+
+static bool_t
+load_face(FT_Library ft, const char *datadir, const char *font,
+    FT_Face *face)
+{
+	char *path = mkpathname(datadir, "fonts", font, NULL);
+	FT_Error err;
+
+	if ((err = FT_New_Face(ft, path, 0, face)) != 0) {
+		fprintf(stderr, "Error loading font %s: %s\n", path,
+		    ft_err2str(err));
+		free(path);
+		return (B_FALSE);
+	}
+	free(path);
+	return (B_TRUE);
+}
+
+int
+main(int argc, char **argv)
+{
+	FT_Library ft;
+	FT_Face nd_face, init_face;
+	FT_Error err;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "un:t:o:")) != -1) {
+		switch (opt) {
+		case 'u':
+			opts.update = B_TRUE;
+			break;
+		case 'n':
+			opts.iterations = atoi(optarg);
+			break;
+		case 't':
+			opts.tolerance = atoi(optarg);
+			break;
+		case 'o':
+			opts.outdir = optarg;
+			break;
+		default:
+			goto usage;
+		}
+	}
+	if (argc - optind != 2 || opts.iterations <= 0 || opts.tolerance < 0)
+		goto usage;
+	opts.goldendir = argv[optind + 1];
+
+	log_init(log_dbg_string, "nd_golden");
+
+	if ((err = FT_Init_FreeType(&ft)) != 0) {
+		fprintf(stderr, "Error initializing FreeType: %s\n",
+		    ft_err2str(err));
+		return (1);
+	}
+	if (!load_face(ft, argv[optind], ND_FONT, &nd_face)) {
+		VERIFY(FT_Done_FreeType(ft) == 0);
+		return (1);
+	}
+	if (!load_face(ft, argv[optind], INIT_MSG_FONT, &init_face)) {
+		VERIFY(FT_Done_Face(nd_face) == 0);
+		VERIFY(FT_Done_FreeType(ft) == 0);
+		return (1);
+	}
+
+	check_nd_alerts(nd_face);
+	for (size_t i = 0; i < ARRAY_NUM_ELEM(init_msgs); i++) {
+		check_text_box(init_msgs[i].name, init_msgs[i].text,
+		    init_face, INIT_MSG_FONT_SIZE, INIT_MSG_MARGIN,
+		    INIT_MSG_BG_ALPHA, 255, 255, 255, B_TRUE);
+	}
+
+	printf("%d images rendered, %.1f us average, %.1f ms total\n",
+	    opts.n_rendered, opts.total_us / opts.n_rendered,
+	    opts.total_us / 1000);
+	if (!opts.update) {
+		printf("%d of %d golden images match\n",
+		    opts.n_compared - opts.n_failed, opts.n_compared);
+	}
+
+	text_cache_flush(nd_face);
+	text_cache_flush(init_face);
+	VERIFY(FT_Done_Face(nd_face) == 0);
+	VERIFY(FT_Done_Face(init_face) == 0);
+	VERIFY(FT_Done_FreeType(ft) == 0);
+
+	return (opts.n_failed == 0 ? 0 : 1);
+usage:
+	fprintf(stderr, "Usage: %s [-u] [-n iterations] [-t tolerance] "
+	    "[-o outdir] <X-RAAS data dir> <golden dir>\n", argv[0]);
+	return (1);
+}
@@ -0,0 +1,156 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+/*
+ * Raw trace renderer. Prints the records of an X-RAAS raw trace file
+ * (Output/X-RAAS/raw_trace/<date>.xrt, see src/raw_trace.c) in order,
+ * formatted the same way as the dbg_log messages they stand in for:
+ *
+ *	<sim time> X-RAAS[<file>:<line>]: [<class>/<level>] <message>
+ *
+ * Usage: raw_trace_dump <trace file>
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/raw_trace_fmt.h"
+
+static int
+rec_compar(const void *a, const void *b)
+{
+	const raw_trace_rec_t *ra = a, *rb = b;
+
+	if (ra->seq < rb->seq)
+		return (-1);
+	if (ra->seq > rb->seq)
+		return (1);
+	return (0);
+}
+
+static void
+print_rec(const raw_trace_rec_t *rec)
+{
+	const raw_trace_adc_t *adc = &rec->u.adc;
+	char tbl[RAW_TRACE_TBL_LEN + 1], key[RAW_TRACE_KEY_LEN + 1];
+
+	memcpy(tbl, rec->u.rwy_key.tbl, RAW_TRACE_TBL_LEN);
+	tbl[RAW_TRACE_TBL_LEN] = 0;
+	memcpy(key, rec->u.rwy_key.key, RAW_TRACE_KEY_LEN);
+	key[RAW_TRACE_KEY_LEN] = 0;
+
+	printf("%10.3f ", rec->sim_time);
+	switch (rec->type) {
+	case RT_ADC_COLLECT:
+		printf("X-RAAS[airdata.c:%d]: [adc/2] collect; " ADC_PRINTF_FMT
+		    "\n", rec->line, ADC_PRINTF_ARGS(adc));
+		break;
+	case RT_FF_A320_UPDATE:
+		printf("X-RAAS[airdata.c:%d]: [ff_a320/4] update; "
+		    ADC_PRINTF_FMT "\n", rec->line, ADC_PRINTF_ARGS(adc));
+		break;
+	case RT_RWY_KEY_CREATE:
+		printf("X-RAAS[rwy_key_tbl.c:%d]: [rwy_key/2] create(%s)\n",
+		    rec->line, tbl);
+		break;
+	case RT_RWY_KEY_DESTROY:
+		printf("X-RAAS[rwy_key_tbl.c:%d]: [rwy_key/2] destroy(%s)\n",
+		    rec->line, tbl);
+		break;
+	case RT_RWY_KEY_EMPTY:
+		printf("X-RAAS[rwy_key_tbl.c:%d]: [rwy_key/2] empty(%s)\n",
+		    rec->line, tbl);
+		break;
+	case RT_RWY_KEY_SET:
+		printf("X-RAAS[rwy_key_tbl.c:%d]: [rwy_key/1] %s[%s] = %d\n",
+		    rec->line, tbl, key, (int)rec->u.rwy_key.value);
+		break;
+	case RT_RWY_KEY_REMOVE:
+		printf("X-RAAS[rwy_key_tbl.c:%d]: [rwy_key/1] %s[%s] = nil\n",
+		    rec->line, tbl, key);
+		break;
+	default:
+		printf("unknown record type %d\n", rec->type);
+		break;
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	FILE *fp;
+	raw_trace_hdr_t hdr;
+	raw_trace_rec_t *recs;
+	size_t n_valid = 0;
+	time_t start;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+		return (1);
+	}
+	if ((fp = fopen(argv[1], "rb")) == NULL) {
+		perror(argv[1]);
+		return (1);
+	}
+	if (fread(&hdr, sizeof (hdr), 1, fp) != 1 ||
+	    hdr.magic != RAW_TRACE_MAGIC) {
+		fprintf(stderr, "%s: not an X-RAAS raw trace, or written on "
+		    "a machine with a different byte order\n", argv[1]);
+		fclose(fp);
+		return (1);
+	}
+	if (hdr.version != RAW_TRACE_VERSION ||
+	    hdr.rec_size != sizeof (raw_trace_rec_t)) {
+		fprintf(stderr, "%s: unsupported raw trace version %d "
+		    "(record size %d)\n", argv[1], hdr.version, hdr.rec_size);
+		fclose(fp);
+		return (1);
+	}
+
+	recs = malloc((size_t)hdr.n_recs * sizeof (*recs));
+	if (recs == NULL) {
+		perror("malloc");
+		fclose(fp);
+		return (1);
+	}
+	for (uint32_t i = 0; i < hdr.n_recs; i++) {
+		if (fread(&recs[n_valid], sizeof (*recs), 1, fp) != 1)
+			break;
+		/* skip unused slots & records torn by a crash */
+		if (recs[n_valid].seq != 0 &&
+		    recs[n_valid].seq <= hdr.next_seq)
+			n_valid++;
+	}
+	fclose(fp);
+	qsort(recs, n_valid, sizeof (*recs), rec_compar);
+
+	start = hdr.start_time;
+	printf("# started: %s", ctime(&start));
+	if (n_valid != 0 && recs[0].seq != 1) {
+		printf("# oldest %" PRIu64 " records were overwritten\n",
+		    recs[0].seq - 1);
+	}
+	for (size_t i = 0; i < n_valid; i++)
+		print_rec(&recs[i]);
+	printf("# %lu records\n", (unsigned long)n_valid);
+	free(recs);
+
+	return (0);
+}
@@ -0,0 +1,146 @@
+/*
+ * CDDL HEADER START
+ *
+ * This file and its contents are supplied under the terms of the
+ * Common Development and Distribution License ("CDDL"), version 1.0.
+ * You may only use this file in accordance with the terms of version
+ * 1.0 of the CDDL.
+ *
+ * A full copy of the text of the CDDL should have accompanied this
+ * source.  A copy of the CDDL is also available via the Internet at
+ * http://www.illumos.org/license/CDDL.
+ *
+ * CDDL HEADER END
+ *
+ * Copyright 2017 Saso Kiselkov. All rights reserved.
+ */
+
+/*
+ * Text rendering benchmark. Renders the longest message we display via
+ * log_init_msg() into an RGBA texture buffer at several font sizes, the
+ * same way init_msg.c does it (background fill + render_text_block), and
+ * reports the average time per render. The glyph cache is warmed up
+ * before timing, so this measures the blending & blitting cost.
+ *
+ * Usage: text_bench <font file> [iterations]
+ * Use data/fonts/Aileron/Aileron-Regular.otf to match init_msg.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <acfutils/assert.h>
+#include <acfutils/helpers.h>
+#include <acfutils/log.h>
+#include <acfutils/time.h>
+
+#include "../src/text_rendering.h"
+
+#define	DEFAULT_ITERATIONS	200
+#define	MARGIN_SIZE		10
+
+/* The embedded-version-installed-globally warning from xraas2.c */
+static const char *bench_text =
+    "X-RAAS(2.0) CAUTION: it seems you have installed an "
+    "embeddable version of X-RAAS into X-Plane's global "
+    "Resources/plugins folder.\n"
+    "The embeddable version is meant to be embedded into an "
+    "aircraft model by its developer.\n"
+    "If you would like to use X-RAAS as a stand-alone plugin, "
+    "download the stand-alone version.\n"
+    "If you are an aircraft developer, please move the "
+    "X-RAAS plugin into your aircraft's \"plugins\" folder.";
+
+static const int font_sizes[] = { 14, 21, 28, 42, 64 };
+
+static void
+log_dbg_string(const char *str)
+{
+	fputs(str, stderr);
+}
+
+static void
+bench_size(FT_Face face, int font_size, int iterations)
+{
+	int text_w, text_h, tex_w, tex_h;
+	uint8_t *buf;
+	uint64_t start, end;
+	double us;
+
+	if (!get_text_block_size(bench_text, face, font_size, &text_w,
+	    &text_h)) {
+		fprintf(stderr, "Error measuring text at size %d\n", font_size);
+		return;
+	}
+	tex_w = text_w + 2 * MARGIN_SIZE;
+	tex_h = text_h + 2 * MARGIN_SIZE;
+	buf = calloc(tex_w * tex_h * 4, 1);
+
+	/* warm up the glyph cache */
+	VERIFY(render_text_block(bench_text, face, font_size, MARGIN_SIZE,
+	    MARGIN_SIZE + font_size, 255, 255, 255, buf, tex_w, tex_h));
+
+	start = microclock();
+	for (int i = 0; i < iterations; i++) {
+		for (int j = 0; j < tex_w * tex_h; j++) {
+			buf[j * 4 + 0] = 0;
+			buf[j * 4 + 1] = 0;
+			buf[j * 4 + 2] = 0;
+			buf[j * 4 + 3] = (uint8_t)(255 * 0.67);
+		}
+		VERIFY(render_text_block(bench_text, face, font_size,
+		    MARGIN_SIZE, MARGIN_SIZE + font_size, 255, 255, 255, buf,
+		    tex_w, tex_h));
+	}
+	end = microclock();
+
+	us = (end - start) / (double)iterations;
+	printf("%3d px  %5d x %-4d  %10.1f us/render  %8.1f Mpx/s\n",
+	    font_size, tex_w, tex_h, us, (tex_w * tex_h) / us);
+
+	free(buf);
+}
+
+int
+main(int argc, char **argv)
+{
+	FT_Library ft;
+	FT_Face face;
+	FT_Error err;
+	int iterations = DEFAULT_ITERATIONS;
+
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: %s <font file> [iterations]\n",
+		    argv[0]);
+		return (1);
+	}
+	if (argc == 3 && (iterations = atoi(argv[2])) <= 0) {
+		fprintf(stderr, "Invalid iteration count %s\n", argv[2]);
+		return (1);
+	}
+
+	log_init(log_dbg_string, "text_bench");
+
+	if ((err = FT_Init_FreeType(&ft)) != 0) {
+		fprintf(stderr, "Error initializing FreeType: %s\n",
+		    ft_err2str(err));
+		return (1);
+	}
+	if ((err = FT_New_Face(ft, argv[1], 0, &face)) != 0) {
+		fprintf(stderr, "Error loading font %s: %s\n", argv[1],
+		    ft_err2str(err));
+		VERIFY(FT_Done_FreeType(ft) == 0);
+		return (1);
+	}
+
+	for (size_t i = 0; i < sizeof (font_sizes) / sizeof (font_sizes[0]);
+	    i++)
+		bench_size(face, font_sizes[i], iterations);
+
+	text_cache_flush(face);
+	VERIFY(FT_Done_Face(face) == 0);
+	VERIFY(FT_Done_FreeType(ft) == 0);
+
+	return (0);
+}